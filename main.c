@@ -1,11 +1,10 @@
 /**
- * RLP Serializer
+ * RLP Serializer - Command Line Tool
  * https://github.com/afkamalipour/simple-rlp
  *
- * This library implements the RLP Encoding scheme used by Ethereum.
- * The specifications referred to are available at the URL below. 
- * Spec: https://github.com/ethereum/wiki/wiki/%5BEnglish%5D-RLP
- * 
+ * The rlp tool: encode, decode, validate, hash, count, split, concat, sort and canon
+ * files of concatenated RLP records. Input is mapped into memory, records are processed in
+ * batches across threads and output is streamed out in record order.
  */
 
 /**
@@ -31,95 +30,971 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+
 #include "rlp_serializer.h"
+#include "rlp_canon.h"
+#include "rlp_keccak.h"
+#include "rlp_sink.h"
+#include "rlp_sort.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
-/*
-00000000
-47868c0000000000
-0000c350
-e242e54155b1abc71fc118065270cecaaf8b77683b9aca
-*/
-// Example of Ethereum txn using library
-uint8_t _nonce[] = {0x00, 0x00, 0x00, 0x00};
-RlpElement_t nonce = {
-  .buff = _nonce,
-  .len = sizeof(_nonce),
-  .type = RLP_TYPE_INT32
-};
-uint8_t _gasPrice[] = {0x0f, 0x42, 0x40};
-RlpElement_t gasPrice = {
-  .buff = _gasPrice,
-  .len = 4,
-  .type = RLP_TYPE_INT32
-};
-uint8_t _gasLimit[] = {0x3b, 0x9a, 0xca, 0x00};
-RlpElement_t gasLimit = {
-  .buff = _gasLimit,
-  .len = 4,
-  .type = RLP_TYPE_INT32
-};
-uint8_t _addressTo[] = {0xe0, 0xde, 0xfb, 0x92, 0x14, 0x5f, 0xef, 0x3c, 0x3a, 0x94, 0x56, 0x37, 0x70, 0x5f, 0xaf, 0xd3, 0xaa, 0x74, 0xa2, 0x41};
-RlpElement_t addressTo = {
-  .buff = _addressTo,
-  .len = sizeof(_addressTo),
-  .type = RLP_TYPE_BYTE_ARRAY
-};
-uint8_t _value[] = {0xde, 0x0b, 0x6b, 0x3a, 0x76, 0x40, 0x00, 0x00};
-RlpElement_t value = {
-  .buff = _value,
-  .len = sizeof(_value),
-  .type = RLP_TYPE_BYTE_ARRAY
-};
-uint8_t _data[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
-RlpElement_t data = {
-  .buff = _data,
-  .len = sizeof(_data),
-  .type = RLP_TYPE_BYTE_ARRAY
-};
-uint8_t _v[] = {0x01};
-RlpElement_t v = {
-  .buff = NULL,
-  .len = 0,
-  .type = RLP_TYPE_BYTE_ARRAY
-};
-RlpElement_t r = {
-  .buff = NULL,
-  .len = 0,
-  .type = RLP_TYPE_BYTE_ARRAY
-};
-RlpElement_t s = {
-  .buff = NULL,
-  .len = 0,
-  .type = RLP_TYPE_BYTE_ARRAY
+/* -------------------------------------------------------------------------- */
+/*                             Internal Constants                             */
+/* -------------------------------------------------------------------------- */
+
+#define CLI_BATCH_RECORDS   65536       // records scanned before the workers take them
+#define CLI_MAX_THREADS     64
+#define CLI_MAX_DEPTH       256         // nesting accepted by validate and decode
+#define CLI_OUT_BUFF        (1 << 20)
+#define CLI_SPLIT_RECORDS   1000000
+#define CLI_SORT_MEMORY     (1024ull << 20)
+
+static const char cliHexDigits[] = "0123456789abcdef";
+
+static const char cliUsage[] =
+  "usage: rlp <command> [options] [file]\n"
+  "commands:\n"
+  "  encode     JSON values (hex strings with -x) to RLP records\n"
+  "  decode     RLP records to JSON, or hex with -X, one line per record\n"
+  "  validate   check that every record is canonical RLP\n"
+  "  hash       Keccak-256 of every record, one line per record\n"
+  "  count      number of records\n"
+  "  split      rlp split -n N file PREFIX writes PREFIX.00000, PREFIX.00001, ...\n"
+  "  concat     rlp concat -o out file... checks each file and concatenates them\n"
+  "  sort       rlp sort -k PATH file sorts records by the key at PATH, e.g. 0 or 3.1\n"
+  "  canon      rewrite non-minimal headers from lenient producers in canonical form\n"
+  "options:\n"
+  "  -j, --threads N   worker threads, all cores by default\n"
+  "  -x, --hex-in      input is one hex string per line\n"
+  "  -X, --hex         write hex lines instead of JSON or binary\n"
+  "  -n, --records N   records per file for split\n"
+  "  -o, --output F    write to F instead of stdout\n"
+  "  -s, --stats       report records/s and MB/s on stderr\n"
+  "  -k, --key PATH    child indexes down to the sort key, separated by dots\n"
+  "  -N, --numeric     sort keys as integers instead of bytes\n"
+  "  -m, --memory MB   memory for in-memory runs, 1024 by default\n"
+  "  -T, --tmpdir DIR  directory for spilled runs, /tmp by default\n"
+  "JSON: arrays are lists, \"0x..\" strings are bytes, other strings are UTF-8,\n"
+  "and non-negative integers are trimmed big endian.\n"
+  "Input is a file of concatenated records, mapped into memory; - or nothing reads stdin.\n";
+
+typedef struct cliOpts {
+  int          threads;
+  bool         stats;
+  bool         hexIn;
+  bool         hexOut;
+  size_t       splitRecords;
+  uint32_t     keyPath[RLP_SORT_MAX_DEPTH];
+  size_t       keyDepth;
+  bool         numeric;
+  size_t       sortMemory;
+  const char   *tmpDir;
+  const char   *output;
+} CliOpts_t;
+
+typedef struct cliBuf {
+  uint8_t      *data;
+  size_t       len;
+  size_t       cap;
+} CliBuf_t;
+
+typedef struct cliInput {
+  const uint8_t *data;
+  size_t       len;
+  size_t       mappedLen;   // 0 when data is heap memory
+} CliInput_t;
+
+typedef struct cliWorker CliWorker_t;
+typedef int (*CliRecordFn_t)(CliWorker_t *w, const uint8_t *rec, size_t len);
+
+struct cliWorker {
+  pthread_t      thread;
+  CliRecordFn_t  fn;
+  const uint8_t  *base;
+  const size_t   *offs;     // record boundaries of the batch
+  size_t         first;     // records [first, last) of the batch
+  size_t         last;
+  CliBuf_t       out;       // this slice's output, written after the batch in order
+  int            err;
+  size_t         errRecord;
+  bool           joinable;
 };
 
-// Gather
-RlpElement_t const *const ethTxn[] = {&nonce, &gasPrice, &gasLimit, &addressTo, &value, &data, &v, &r, &s};
-
-
-static void debug_hexstring(const void *const address, size_t nBytes)
-{
-     uint8_t *a = ((uint8_t*)(address));
-     unsigned long int b = ((volatile unsigned long int)(nBytes));
-     if ((NULL == a) || (b <= 0)) return;
-     for (unsigned long int i = 1; i <= b; i++) {
-       if(a[i-1] < 0x10)
-          printf("0%x",a[i-1]);
-        else
-          printf("%x",a[i-1]);
-     }
-}
-
-int main() {
-  uint8_t rlpTx[2048] = {0};
-  int outputLen = 0;
-  outputLen = rlp_encode_list(rlpTx, sizeof(rlpTx)/sizeof(rlpTx[0]), ethTxn, sizeof(ethTxn)/sizeof(ethTxn[0]));
-  if(outputLen < 0)
-    printf("error, return code: %d\r\n", outputLen);
-  else {
-    printf("RLP encoded eth txn [%d B]:\r\n", outputLen);
-    debug_hexstring(rlpTx, outputLen);
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+static double cli_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static const char *cli_strerror(int err) {
+  switch(err) {
+  case ERR_RLP_EINVAL:   return "invalid RLP";
+  case ERR_RLP_ENODATA:  return "truncated record";
+  case ERR_RLP_EMSGSIZE: return "nested too deep or too large";
+  case ERR_RLP_ENOMEM:   return "out of memory";
+  case ERR_RLP_EIO:      return "write failed";
+  default:               return "error";
+  }
+}
+
+// Makes room for n more bytes
+static uint8_t *cli_buf_reserve(CliBuf_t *b, size_t n) {
+  if(b->cap - b->len < n || b->data == NULL) {
+    size_t cap = b->cap ? b->cap : 4096;
+    while(cap - b->len < n)
+      cap *= 2;
+    uint8_t *data = realloc(b->data, cap);
+    if(data == NULL)
+      return NULL;
+    b->data = data;
+    b->cap = cap;
+  }
+  return b->data + b->len;
+}
+
+static int cli_write_all(int fd, const void *data, size_t len) {
+  const uint8_t *p = data;
+  while(len) {
+    ssize_t ret = write(fd, p, len);
+    if(ret < 0 && errno == EINTR)
+      continue;
+    if(ret <= 0)
+      return ERR_RLP_EIO;
+    p += ret;
+    len -= ret;
+  }
+  return ERR_RLP_OK;
+}
+
+static int cli_open_output(const char *path) {
+  if(path == NULL || strcmp(path, "-") == 0)
+    return STDOUT_FILENO;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    fprintf(stderr, "rlp: %s: %s\n", path, strerror(errno));
+  return fd;
+}
+
+static int cli_hex_value(int c) {
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  if(c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Decodes hex digits (an optional 0x prefix is skipped) and appends the bytes to out
+static bool cli_hex_decode(const uint8_t *s, size_t len, CliBuf_t *out) {
+  if(len >= 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+    s += 2;
+    len -= 2;
   }
+  if(len % 2)
+    return false;
+  uint8_t *p = cli_buf_reserve(out, len / 2);
+  if(p == NULL)
+    return false;
+  for(size_t i = 0; i < len; i += 2) {
+    int hi = cli_hex_value(s[i]), lo = cli_hex_value(s[i + 1]);
+    if(hi < 0 || lo < 0)
+      return false;
+    *p++ = (uint8_t) (hi << 4 | lo);
+  }
+  out->len += len / 2;
+  return true;
+}
+
+static void cli_hex_encode(const uint8_t *data, size_t len, uint8_t *out) {
+  for(size_t i = 0; i < len; i++) {
+    out[2 * i] = cliHexDigits[data[i] >> 4];
+    out[2 * i + 1] = cliHexDigits[data[i] & 0xf];
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Input                                   */
+/* -------------------------------------------------------------------------- */
+
+// Maps a file read only; pipes and stdin are read into memory instead
+static int cli_input_open(CliInput_t *in, const char *path) {
+  memset(in, 0, sizeof(*in));
+  int fd = path == NULL || strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "rlp: %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  if(S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p != MAP_FAILED) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      in->data = p;
+      in->len = in->mappedLen = st.st_size;
+      if(fd != STDIN_FILENO)
+        close(fd);
+      return 0;
+    }
+  }
+  CliBuf_t b = {0};
+  for(;;) {
+    uint8_t *p = cli_buf_reserve(&b, 1 << 20);
+    ssize_t ret = p ? read(fd, p, b.cap - b.len) : -1;
+    if(ret < 0 && errno == EINTR)
+      continue;
+    if(ret < 0) {
+      fprintf(stderr, "rlp: %s: %s\n", path ? path : "stdin", strerror(errno));
+      free(b.data);
+      return -1;
+    }
+    if(ret == 0)
+      break;
+    b.len += ret;
+  }
+  if(fd != STDIN_FILENO)
+    close(fd);
+  in->data = b.data;
+  in->len = b.len;
+  return 0;
+}
+
+static void cli_input_close(CliInput_t *in) {
+  if(in->mappedLen)
+    munmap((void *) in->data, in->mappedLen);
+  else
+    free((void *) in->data);
+}
+
+// Replaces hex text, one record per line, by the binary records
+static int cli_input_unhex(CliInput_t *in) {
+  CliBuf_t b = {0};
+  const uint8_t *p = in->data, *end = in->data + in->len;
+  for(size_t line = 1; p < end; line++) {
+    const uint8_t *eol = memchr(p, '\n', end - p);
+    const uint8_t *s = p, *e = eol ? eol : end;
+    while(s < e && (*s == ' ' || *s == '\t'))
+      s++;
+    while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'))
+      e--;
+    if(e > s && !cli_hex_decode(s, e - s, &b)) {
+      fprintf(stderr, "rlp: line %zu: not a hex string\n", line);
+      free(b.data);
+      return -1;
+    }
+    p = eol ? eol + 1 : end;
+  }
+  cli_input_close(in);
+  in->data = b.data;
+  in->len = b.len;
+  in->mappedLen = 0;
   return 0;
-}
\ No newline at end of file
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Records                                  */
+/* -------------------------------------------------------------------------- */
+
+// Checks every nested item, not just the record header
+static int cli_validate_record(const uint8_t *rec, size_t len) {
+  RlpItem_t item;
+  RlpCursor_t stack[CLI_MAX_DEPTH];
+  int err = rlp_decode_item(rec, len, &item);
+  if(err < 0 || !item.isList)
+    return err < 0 ? err : ERR_RLP_OK;
+  size_t depth = 1;
+  rlp_cursor_init(&stack[0], &item);
+  while(depth) {
+    err = rlp_cursor_next(&stack[depth - 1], &item);
+    if(err < 0)
+      return err;
+    if(err == 0)
+      depth--;
+    else if(item.isList) {
+      if(depth == CLI_MAX_DEPTH)
+        return ERR_RLP_EMSGSIZE;
+      rlp_cursor_init(&stack[depth++], &item);
+    }
+  }
+  return ERR_RLP_OK;
+}
+
+static int cli_json_item(CliBuf_t *out, const RlpItem_t *item, size_t depth) {
+  if(!item->isList) {
+    uint8_t *p = cli_buf_reserve(out, 2 * item->payloadLen + 4);
+    if(p == NULL)
+      return ERR_RLP_ENOMEM;
+    memcpy(p, "\"0x", 3);
+    cli_hex_encode(item->payload, item->payloadLen, p + 3);
+    p[3 + 2 * item->payloadLen] = '"';
+    out->len += 2 * item->payloadLen + 4;
+    return ERR_RLP_OK;
+  }
+  if(depth == CLI_MAX_DEPTH)
+    return ERR_RLP_EMSGSIZE;
+  RlpCursor_t cur;
+  RlpItem_t child;
+  int err = rlp_cursor_init(&cur, item);
+  for(bool first = true; err >= 0; first = false) {
+    if(cli_buf_reserve(out, 1) == NULL)
+      return ERR_RLP_ENOMEM;
+    out->data[out->len++] = first ? '[' : ',';
+    if((err = rlp_cursor_next(&cur, &child)) <= 0)
+      break;
+    err = cli_json_item(out, &child, depth + 1);
+  }
+  if(err < 0)
+    return err;
+  if(out->data[out->len - 1] == ',')
+    out->len--;
+  if(cli_buf_reserve(out, 1) == NULL)
+    return ERR_RLP_ENOMEM;
+  out->data[out->len++] = ']';
+  return ERR_RLP_OK;
+}
+
+static int cli_record_validate(CliWorker_t *w, const uint8_t *rec, size_t len) {
+  (void) w;
+  return cli_validate_record(rec, len);
+}
+
+static int cli_record_json(CliWorker_t *w, const uint8_t *rec, size_t len) {
+  RlpItem_t item;
+  int err = rlp_decode_item(rec, len, &item);
+  if(err >= 0)
+    err = cli_json_item(&w->out, &item, 0);
+  if(err >= 0 && cli_buf_reserve(&w->out, 1) == NULL)
+    err = ERR_RLP_ENOMEM;
+  if(err < 0)
+    return err;
+  w->out.data[w->out.len++] = '\n';
+  return ERR_RLP_OK;
+}
+
+static int cli_record_hex(CliWorker_t *w, const uint8_t *rec, size_t len) {
+  uint8_t *p = cli_buf_reserve(&w->out, 2 * len + 1);
+  if(p == NULL)
+    return ERR_RLP_ENOMEM;
+  cli_hex_encode(rec, len, p);
+  p[2 * len] = '\n';
+  w->out.len += 2 * len + 1;
+  return ERR_RLP_OK;
+}
+
+static int cli_record_copy(CliWorker_t *w, const uint8_t *rec, size_t len) {
+  int err = cli_validate_record(rec, len);
+  if(err < 0)
+    return err;
+  uint8_t *p = cli_buf_reserve(&w->out, len);
+  if(p == NULL)
+    return ERR_RLP_ENOMEM;
+  memcpy(p, rec, len);
+  w->out.len += len;
+  return ERR_RLP_OK;
+}
+
+static int cli_record_hash(CliWorker_t *w, const uint8_t *rec, size_t len) {
+  uint8_t hash[RLP_KECCAK256_LEN];
+  uint8_t *p = cli_buf_reserve(&w->out, 2 * RLP_KECCAK256_LEN + 1);
+  if(p == NULL)
+    return ERR_RLP_ENOMEM;
+  rlp_keccak256(rec, len, hash);
+  cli_hex_encode(hash, sizeof(hash), p);
+  p[2 * RLP_KECCAK256_LEN] = '\n';
+  w->out.len += 2 * RLP_KECCAK256_LEN + 1;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Batches                                  */
+/* -------------------------------------------------------------------------- */
+
+static void *cli_worker_run(void *arg) {
+  CliWorker_t *w = arg;
+  for(size_t i = w->first; i < w->last; i++) {
+    size_t outLen = w->out.len;
+    int err = w->fn(w, w->base + w->offs[i], w->offs[i + 1] - w->offs[i]);
+    if(err < 0) {
+      // Drop what the bad record wrote so far, only whole records reach the output
+      w->out.len = outLen;
+      w->err = err;
+      w->errRecord = i;
+      break;
+    }
+  }
+  return NULL;
+}
+
+// Scans record boundaries in batches on this thread, has the workers process each batch
+// in parallel and writes their output in record order. *records is the number of records
+// scanned. Returns 0, or 1 after reporting the first bad record.
+static int cli_run(const CliInput_t *in, CliRecordFn_t fn, int threads, int outFd, size_t *records) {
+  static CliWorker_t workers[CLI_MAX_THREADS];
+  size_t *offs = malloc((CLI_BATCH_RECORDS + 1) * sizeof(*offs));
+  if(offs == NULL)
+    return 1;
+  size_t off = 0, total = 0;
+  int status = 0;
+  while(off < in->len && status == 0) {
+    size_t cnt = 0;
+    offs[0] = off;
+    while(cnt < CLI_BATCH_RECORDS && off < in->len) {
+      RlpItem_t item;
+      int ret = rlp_decode_item(in->data + off, in->len - off, &item);
+      if(ret < 0) {
+        fprintf(stderr, "rlp: record %zu at offset %zu: %s\n", total + cnt, off, cli_strerror(ret));
+        status = 1;
+        break;
+      }
+      off += ret;
+      offs[++cnt] = off;
+    }
+
+    // Without a record function (count) the scan is all there is to do
+    int n = fn == NULL ? 0 : cnt < (size_t) threads ? (cnt ? (int) cnt : 1) : threads;
+    for(int t = 0; t < n; t++) {
+      CliWorker_t *w = &workers[t];
+      w->fn = fn;
+      w->base = in->data;
+      w->offs = offs;
+      w->first = cnt * t / n;
+      w->last = cnt * (t + 1) / n;
+      w->out.len = 0;
+      w->err = 0;
+      w->joinable = t && pthread_create(&w->thread, NULL, cli_worker_run, w) == 0;
+      if(t && !w->joinable)
+        cli_worker_run(w);
+    }
+    if(n)
+      cli_worker_run(&workers[0]);
+    for(int t = 1; t < n; t++)
+      if(workers[t].joinable)
+        pthread_join(workers[t].thread, NULL);
+
+    for(int t = 0; t < n; t++) {
+      CliWorker_t *w = &workers[t];
+      if(outFd >= 0 && w->out.len && status == 0 && cli_write_all(outFd, w->out.data, w->out.len) < 0) {
+        fprintf(stderr, "rlp: write failed: %s\n", strerror(errno));
+        status = 1;
+      }
+      if(w->err < 0 && status == 0) {
+        fprintf(stderr, "rlp: record %zu at offset %zu: %s\n", total + w->errRecord, offs[w->errRecord], cli_strerror(w->err));
+        status = 1;
+      }
+    }
+    total += cnt;
+  }
+  *records = total;
+  for(int t = 0; t < CLI_MAX_THREADS; t++) {
+    free(workers[t].out.data);
+    workers[t].out = (CliBuf_t){0};
+  }
+  free(offs);
+  return status;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Encode                                  */
+/* -------------------------------------------------------------------------- */
+
+typedef struct cliJson {
+  const uint8_t *p;
+  const uint8_t *end;
+  CliBuf_t      out;       // the current record
+  CliBuf_t      str;       // the current string, reused
+} CliJson_t;
+
+static void cli_json_ws(CliJson_t *j) {
+  while(j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r'))
+    j->p++;
+}
+
+static bool cli_json_utf8(CliBuf_t *b, uint32_t c) {
+  uint8_t *p = cli_buf_reserve(b, 4);
+  if(p == NULL)
+    return false;
+  if(c < 0x80)
+    p[0] = (uint8_t) c, b->len += 1;
+  else if(c < 0x800)
+    p[0] = 0xc0 | c >> 6, p[1] = 0x80 | (c & 0x3f), b->len += 2;
+  else if(c < 0x10000)
+    p[0] = 0xe0 | c >> 12, p[1] = 0x80 | ((c >> 6) & 0x3f), p[2] = 0x80 | (c & 0x3f), b->len += 3;
+  else
+    p[0] = 0xf0 | c >> 18, p[1] = 0x80 | ((c >> 12) & 0x3f), p[2] = 0x80 | ((c >> 6) & 0x3f), p[3] = 0x80 | (c & 0x3f), b->len += 4;
+  return true;
+}
+
+static bool cli_json_hex4(CliJson_t *j, uint32_t *c) {
+  if(j->end - j->p < 4)
+    return false;
+  *c = 0;
+  for(int i = 0; i < 4; i++) {
+    int v = cli_hex_value(*j->p++);
+    if(v < 0)
+      return false;
+    *c = *c << 4 | v;
+  }
+  return true;
+}
+
+// Reads a string body after the opening quote into raw
+static bool cli_json_string(CliJson_t *j, CliBuf_t *raw) {
+  while(j->p < j->end && *j->p != '"') {
+    const uint8_t *run = j->p;
+    while(j->p < j->end && *j->p != '"' && *j->p != '\\')
+      j->p++;
+    if(j->p > run) {
+      if(cli_buf_reserve(raw, j->p - run) == NULL)
+        return false;
+      memcpy(raw->data + raw->len, run, j->p - run);
+      raw->len += j->p - run;
+      continue;
+    }
+    if(++j->p == j->end)
+      return false;
+    uint8_t c;
+    uint32_t u;
+    switch(c = *j->p++) {
+    case 'b': u = '\b'; break;
+    case 'f': u = '\f'; break;
+    case 'n': u = '\n'; break;
+    case 'r': u = '\r'; break;
+    case 't': u = '\t'; break;
+    case '"': case '\\': case '/': u = c; break;
+    case 'u':
+      if(!cli_json_hex4(j, &u))
+        return false;
+      if(u >= 0xd800 && u < 0xdc00) {
+        uint32_t lo;
+        if(j->end - j->p < 2 || j->p[0] != '\\' || j->p[1] != 'u')
+          return false;
+        j->p += 2;
+        if(!cli_json_hex4(j, &lo) || lo < 0xdc00 || lo >= 0xe000)
+          return false;
+        u = 0x10000 + ((u - 0xd800) << 10) + (lo - 0xdc00);
+      }
+      break;
+    default:
+      return false;
+    }
+    if(!cli_json_utf8(raw, u))
+      return false;
+  }
+  if(j->p == j->end)
+    return false;
+  j->p++;
+  return true;
+}
+
+static bool cli_json_bytes(CliBuf_t *out, const uint8_t *data, size_t len) {
+  uint8_t *p = cli_buf_reserve(out, len + 9);
+  if(p == NULL)
+    return false;
+  RlpElement_t e = RLP_ELEMENT_BYTEARRAY(data, len);
+  int ret = rlp_encode_element(p, len + 9, &e);
+  if(ret < 0)
+    return false;
+  out->len += ret;
+  return true;
+}
+
+// Encodes one JSON value. Lists are written behind room for the longest header and moved
+// down once their payload length is known.
+static bool cli_json_value(CliJson_t *j, size_t depth) {
+  cli_json_ws(j);
+  if(j->p == j->end || depth == CLI_MAX_DEPTH)
+    return false;
+  if(*j->p == '[') {
+    j->p++;
+    size_t start = j->out.len;
+    if(cli_buf_reserve(&j->out, 9) == NULL)
+      return false;
+    j->out.len += 9;
+    cli_json_ws(j);
+    if(j->p < j->end && *j->p == ']')
+      j->p++;
+    else {
+      for(;;) {
+        if(!cli_json_value(j, depth + 1))
+          return false;
+        cli_json_ws(j);
+        if(j->p == j->end)
+          return false;
+        uint8_t c = *j->p++;
+        if(c == ']')
+          break;
+        if(c != ',')
+          return false;
+      }
+    }
+    size_t payloadLen = j->out.len - start - 9;
+    size_t hdrLen = rlp_header_len(payloadLen);
+    memmove(j->out.data + start + hdrLen, j->out.data + start + 9, payloadLen);
+    rlp_encode_header(j->out.data + start, hdrLen, payloadLen, true);
+    j->out.len = start + hdrLen + payloadLen;
+    return true;
+  }
+  if(*j->p == '"') {
+    j->p++;
+    CliBuf_t *str = &j->str;
+    str->len = 0;
+    if(!cli_json_string(j, str))
+      return false;
+    // "0x.." is hex, decoded in place, anything else is the string's own bytes
+    if(str->len >= 2 && str->data[0] == '0' && (str->data[1] == 'x' || str->data[1] == 'X')) {
+      if(str->len % 2)
+        return false;
+      for(size_t i = 2; i < str->len; i += 2) {
+        int hi = cli_hex_value(str->data[i]), lo = cli_hex_value(str->data[i + 1]);
+        if(hi < 0 || lo < 0)
+          return false;
+        str->data[i / 2 - 1] = (uint8_t) (hi << 4 | lo);
+      }
+      str->len = str->len / 2 - 1;
+    }
+    return cli_json_bytes(&j->out, str->data, str->len);
+  }
+  if(*j->p >= '0' && *j->p <= '9') {
+    uint64_t v = 0;
+    while(j->p < j->end && *j->p >= '0' && *j->p <= '9') {
+      uint64_t d = *j->p++ - '0';
+      if(v > (UINT64_MAX - d) / 10)
+        return false; // larger values go in as "0x.." strings
+      v = v * 10 + d;
+    }
+    if(j->p < j->end && (*j->p == '.' || *j->p == 'e' || *j->p == 'E'))
+      return false;
+    uint8_t *p = cli_buf_reserve(&j->out, 9);
+    if(p == NULL)
+      return false;
+    j->out.len += rlp_encode_uint64(p, 9, v);
+    return true;
+  }
+  return false;
+}
+
+static int cli_encode(const CliInput_t *in, const CliOpts_t *opts, int outFd, size_t *records) {
+  static uint8_t sinkBuff[CLI_OUT_BUFF];
+  RlpFdSink_t sink;
+  rlp_fd_sink_init(&sink, outFd, sinkBuff, sizeof(sinkBuff));
+  CliJson_t j = { .p = in->data, .end = in->data + in->len };
+  int status = 0;
+  size_t cnt = 0;
+  for(;; cnt++) {
+    cli_json_ws(&j);
+    if(j.p == j.end)
+      break;
+    const uint8_t *start = j.p;
+    j.out.len = 0;
+    if(!cli_json_value(&j, 0)) {
+      fprintf(stderr, "rlp: value %zu at offset %zu: not valid JSON for RLP\n", cnt, (size_t) (start - in->data));
+      status = 1;
+      break;
+    }
+    int err;
+    if(opts->hexOut) {
+      uint8_t *p = rlp_sink_reserve(&sink.sink, 2 * j.out.len + 1);
+      if(p == NULL) {
+        // Larger than the window, write the line through a staging buffer
+        CliWorker_t w = {0};
+        err = cli_record_hex(&w, j.out.data, j.out.len);
+        if(err >= 0)
+          err = rlp_sink_write(&sink.sink, w.out.data, w.out.len);
+        free(w.out.data);
+      } else {
+        cli_hex_encode(j.out.data, j.out.len, p);
+        p[2 * j.out.len] = '\n';
+        rlp_sink_commit(&sink.sink, 2 * j.out.len + 1);
+        err = ERR_RLP_OK;
+      }
+    } else
+      err = rlp_sink_write(&sink.sink, j.out.data, j.out.len);
+    if(err < 0) {
+      fprintf(stderr, "rlp: write failed\n");
+      status = 1;
+      break;
+    }
+  }
+  if(rlp_sink_close(&sink.sink) < 0 && status == 0) {
+    fprintf(stderr, "rlp: write failed\n");
+    status = 1;
+  }
+  free(j.out.data);
+  free(j.str.data);
+  *records = cnt;
+  return status;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Split / Concat                              */
+/* -------------------------------------------------------------------------- */
+
+static int cli_split(const CliInput_t *in, size_t perFile, const char *prefix, size_t *records) {
+  size_t off = 0, cnt = 0;
+  for(unsigned file = 0; off < in->len; file++) {
+    size_t start = off;
+    for(size_t n = 0; n < perFile && off < in->len; n++, cnt++) {
+      RlpItem_t item;
+      int ret = rlp_decode_item(in->data + off, in->len - off, &item);
+      if(ret < 0) {
+        fprintf(stderr, "rlp: record %zu at offset %zu: %s\n", cnt, off, cli_strerror(ret));
+        *records = cnt;
+        return 1;
+      }
+      off += ret;
+    }
+    char path[4096];
+    snprintf(path, sizeof(path), "%s.%05u", prefix, file);
+    int fd = cli_open_output(path);
+    if(fd < 0)
+      return 1;
+    int err = cli_write_all(fd, in->data + start, off - start);
+    if(close(fd) < 0 || err < 0) {
+      fprintf(stderr, "rlp: %s: write failed\n", path);
+      return 1;
+    }
+  }
+  *records = cnt;
+  return 0;
+}
+
+// Each file is scanned in full before any of it is written
+static int cli_concat(char **paths, int pathsCnt, const CliOpts_t *opts, int outFd, size_t *records, size_t *bytes) {
+  *records = *bytes = 0;
+  for(int i = 0; i < pathsCnt; i++) {
+    CliInput_t in;
+    if(cli_input_open(&in, paths[i]) < 0 || (opts->hexIn && cli_input_unhex(&in) < 0))
+      return 1;
+    size_t off = 0;
+    while(off < in.len) {
+      RlpItem_t item;
+      int ret = rlp_decode_item(in.data + off, in.len - off, &item);
+      if(ret < 0) {
+        fprintf(stderr, "rlp: %s: record at offset %zu: %s\n", paths[i], off, cli_strerror(ret));
+        cli_input_close(&in);
+        return 1;
+      }
+      off += ret;
+      (*records)++;
+    }
+    int err = cli_write_all(outFd, in.data, in.len);
+    *bytes += in.len;
+    cli_input_close(&in);
+    if(err < 0) {
+      fprintf(stderr, "rlp: write failed\n");
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Parses a dotted list of child indexes such as "3.1"
+static bool cli_parse_path(const char *arg, CliOpts_t *opts) {
+  opts->keyDepth = 0;
+  for(const char *p = arg; *p; ) {
+    char *end;
+    unsigned long v = strtoul(p, &end, 10);
+    if(end == p || v > UINT32_MAX || opts->keyDepth == RLP_SORT_MAX_DEPTH || (*end && *end != '.'))
+      return false;
+    opts->keyPath[opts->keyDepth++] = (uint32_t) v;
+    p = *end ? end + 1 : end;
+  }
+  return opts->keyDepth > 0;
+}
+
+static int cli_sort(const CliInput_t *in, const CliOpts_t *opts, int outFd, size_t *records) {
+  static uint8_t sinkBuff[CLI_OUT_BUFF];
+  RlpSorter_t sorter;
+  int err = rlp_sort_open(&sorter, opts->keyPath, opts->keyDepth, opts->sortMemory, opts->threads,
+                          opts->tmpDir, opts->numeric ? RLP_SORT_NUMERIC : 0);
+  if(err < 0) {
+    fprintf(stderr, "rlp: sort: %s\n", cli_strerror(err));
+    return 1;
+  }
+  size_t off = 0, cnt = 0;
+  while(off < in->len) {
+    RlpItem_t item;
+    int ret = rlp_decode_item(in->data + off, in->len - off, &item);
+    if(ret < 0 || (err = rlp_sort_add(&sorter, in->data + off, ret)) < 0) {
+      fprintf(stderr, "rlp: record %zu at offset %zu: %s\n", cnt, off,
+              ret < 0 ? cli_strerror(ret) : err == ERR_RLP_ENOENT ? "no key at path"
+              : err == ERR_RLP_EBADARG ? "key at path is not a string" : cli_strerror(err));
+      rlp_sort_close(&sorter);
+      *records = cnt;
+      return 1;
+    }
+    off += ret;
+    cnt++;
+  }
+  RlpFdSink_t sink;
+  rlp_fd_sink_init(&sink, outFd, sinkBuff, sizeof(sinkBuff));
+  err = rlp_sort_finish(&sorter, &sink.sink);
+  rlp_sort_close(&sorter);
+  if(err < 0)
+    fprintf(stderr, "rlp: sort: %s\n", cli_strerror(err));
+  *records = cnt;
+  return err < 0;
+}
+
+static int cli_canon(const CliInput_t *in, const CliOpts_t *opts, int outFd, size_t *records) {
+  static uint8_t sinkBuff[CLI_OUT_BUFF];
+  RlpFdSink_t sink;
+  RlpCanon_t canon;
+  rlp_fd_sink_init(&sink, outFd, sinkBuff, sizeof(sinkBuff));
+  rlp_canon_init(&canon);
+  int err = rlp_canon_sink(&canon, in->data, in->len, &sink.sink);
+  if(err == ERR_RLP_OK)
+    err = rlp_sink_flush(&sink.sink);
+  if(err < 0)
+    fprintf(stderr, "rlp: canon: record %zu: %s\n", canon.recordsCnt, cli_strerror(err));
+  else if(opts->stats)
+    fprintf(stderr, "%zu headers rewritten\n", canon.rewrittenCnt);
+  *records = canon.recordsCnt;
+  rlp_canon_free(&canon);
+  return err < 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+  static const struct option longOpts[] = {
+    {"threads", required_argument, NULL, 'j'},
+    {"hex-in",  no_argument,       NULL, 'x'},
+    {"hex",     no_argument,       NULL, 'X'},
+    {"records", required_argument, NULL, 'n'},
+    {"output",  required_argument, NULL, 'o'},
+    {"stats",   no_argument,       NULL, 's'},
+    {"key",     required_argument, NULL, 'k'},
+    {"numeric", no_argument,       NULL, 'N'},
+    {"memory",  required_argument, NULL, 'm'},
+    {"tmpdir",  required_argument, NULL, 'T'},
+    {"help",    no_argument,       NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  CliOpts_t opts = {
+    .threads = cores < 1 ? 1 : cores > CLI_MAX_THREADS ? CLI_MAX_THREADS : (int) cores,
+    .splitRecords = CLI_SPLIT_RECORDS,
+    .sortMemory = CLI_SORT_MEMORY,
+  };
+  if(argc < 2 || argv[1][0] == '-') {
+    fputs(cliUsage, argc < 2 ? stderr : stdout);
+    return argc < 2 ? 2 : 0;
+  }
+  const char *cmd = argv[1];
+  optind = 2;
+  int c;
+  while((c = getopt_long(argc, argv, "j:xXn:o:sk:Nm:T:h", longOpts, NULL)) != -1) {
+    switch(c) {
+    case 'j': opts.threads = atoi(optarg); break;
+    case 'x': opts.hexIn = true; break;
+    case 'X': opts.hexOut = true; break;
+    case 'n': opts.splitRecords = strtoull(optarg, NULL, 10); break;
+    case 'o': opts.output = optarg; break;
+    case 's': opts.stats = true; break;
+    case 'k':
+      if(!cli_parse_path(optarg, &opts)) {
+        fputs(cliUsage, stderr);
+        return 2;
+      }
+      break;
+    case 'N': opts.numeric = true; break;
+    case 'm': opts.sortMemory = strtoull(optarg, NULL, 10) << 20; break;
+    case 'T': opts.tmpDir = optarg; break;
+    case 'h': fputs(cliUsage, stdout); return 0;
+    default:  fputs(cliUsage, stderr); return 2;
+    }
+  }
+  if(opts.threads < 1 || opts.threads > CLI_MAX_THREADS || opts.splitRecords == 0) {
+    fputs(cliUsage, stderr);
+    return 2;
+  }
+
+  double t0 = cli_now();
+  size_t records = 0, bytes = 0;
+  int status;
+  if(strcmp(cmd, "concat") == 0) {
+    int outFd = cli_open_output(opts.output);
+    if(outFd < 0)
+      return 1;
+    status = cli_concat(argv + optind, argc - optind, &opts, outFd, &records, &bytes);
+    if(outFd != STDOUT_FILENO && close(outFd) < 0)
+      status = 1;
+  } else {
+    bool isSplit = strcmp(cmd, "split") == 0, isEncode = strcmp(cmd, "encode") == 0;
+    bool isSort = strcmp(cmd, "sort") == 0, isCanon = strcmp(cmd, "canon") == 0;
+    if(argc - optind > (isSplit ? 2 : 1) || (isSplit && argc - optind != 2)) {
+      fputs(cliUsage, stderr);
+      return 2;
+    }
+    CliRecordFn_t fn = NULL;
+    if(strcmp(cmd, "decode") == 0)
+      fn = opts.hexOut ? cli_record_hex : cli_record_json;
+    else if(strcmp(cmd, "validate") == 0)
+      fn = cli_record_validate;
+    else if(strcmp(cmd, "hash") == 0)
+      fn = cli_record_hash;
+    else if(isEncode && opts.hexIn)
+      fn = opts.hexOut ? cli_record_hex : cli_record_copy; // hex records are already encoded
+    else if(!isSplit && !isEncode && !isSort && !isCanon && strcmp(cmd, "count") != 0) {
+      fprintf(stderr, "rlp: unknown command '%s'\n", cmd);
+      fputs(cliUsage, stderr);
+      return 2;
+    }
+    if(isSort && opts.keyDepth == 0) {
+      fputs(cliUsage, stderr);
+      return 2;
+    }
+
+    CliInput_t in;
+    if(cli_input_open(&in, optind < argc ? argv[optind] : NULL) < 0)
+      return 1;
+    if(opts.hexIn && cli_input_unhex(&in) < 0)
+      return 1;
+    bytes = in.len;
+    bool hasOutput = isEncode || isSort || isCanon || (fn && fn != cli_record_validate);
+    int outFd = hasOutput ? cli_open_output(opts.output) : -1;
+    if(hasOutput && outFd < 0)
+      return 1;
+
+    if(isSplit)
+      status = cli_split(&in, opts.splitRecords, argv[optind + 1], &records);
+    else if(isSort)
+      status = cli_sort(&in, &opts, outFd, &records);
+    else if(isCanon)
+      status = cli_canon(&in, &opts, outFd, &records);
+    else if(isEncode && fn == NULL)
+      status = cli_encode(&in, &opts, outFd, &records);
+    else {
+      // count only scans the record headers
+      status = cli_run(&in, fn, opts.threads, outFd, &records);
+      if(fn == NULL && status == 0)
+        printf("%zu\n", records);
+    }
+    if(outFd > STDOUT_FILENO && close(outFd) < 0)
+      status = 1;
+    cli_input_close(&in);
+  }
+
+  if(opts.stats) {
+    double s = cli_now() - t0;
+    fprintf(stderr, "%zu records, %zu bytes in %.3f s: %.0f records/s, %.1f MB/s\n",
+            records, bytes, s, s > 0 ? records / s : 0.0, s > 0 ? bytes / s / 1e6 : 0.0);
+  }
+  return status;
+}
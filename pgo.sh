@@ -0,0 +1,82 @@
+#!/bin/sh
+# RLP Serializer - Profile-guided build comparison
+# https://github.com/afkamalipour/simple-rlp
+#
+# Builds rlp_workload three times: plain -O2, instrumented, and -O2 with the profile
+# from a training run of the instrumented build. Then times the plain and profiled
+# builds on a different seed than the one they were trained on.
+# Usage: [CC=gcc|clang] [CFLAGS=...] ./pgo.sh [build dir] [rounds]
+
+set -e
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2}
+SRC=$(cd "$(dirname "$0")" && pwd)
+DIR=${1:-pgo-build}
+ROUNDS=${2:-50}
+TRAIN_SEED=0x9e3779b97f4a7c15
+MEASURE_SEED=0x2545f4914f6cdd1d
+RUNS=5
+
+mkdir -p "$DIR"
+cd "$DIR"
+rm -f ./*.o ./*.gcda ./*.profraw ./*.profdata
+
+# Objects keep the same names in every build, so GCC finds its .gcda files by name
+build() {
+  out=$1
+  shift
+  $CC $CFLAGS "$@" -I"$SRC" -c "$SRC/rlp_serializer.c" -o rlp_serializer.o
+  $CC $CFLAGS "$@" -I"$SRC" -c "$SRC/rlp_workload.c" -o rlp_workload.o
+  $CC $CFLAGS "$@" rlp_serializer.o rlp_workload.o -o "$out"
+}
+
+case $($CC --version | head -n 1) in
+  *clang*)
+    GEN=-fprofile-instr-generate
+    USE=-fprofile-instr-use=rlp.profdata
+    ;;
+  *)
+    GEN=-fprofile-generate
+    USE="-fprofile-use -Wno-missing-profile"
+    ;;
+esac
+
+echo "building plain"
+build rlp_workload_plain
+echo "building instrumented"
+build rlp_workload_instr $GEN
+echo "training"
+LLVM_PROFILE_FILE=rlp.profraw ./rlp_workload_instr 20 $TRAIN_SEED > /dev/null
+if [ -f rlp.profraw ]; then
+  ${LLVM_PROFDATA:-llvm-profdata} merge -o rlp.profdata rlp.profraw
+fi
+echo "building profiled"
+# shellcheck disable=SC2086
+build rlp_workload_pgo $USE
+
+# Best of $RUNS for each phase: prints "encode decode checksum"
+measure() {
+  best_enc=
+  best_dec=
+  for _ in $(seq $RUNS); do
+    out=$(./"$1" "$ROUNDS" $MEASURE_SEED)
+    enc=$(echo "$out" | awk '/^encode:/ { print $2 }')
+    dec=$(echo "$out" | awk '/^decode:/ { print $2 }')
+    sum=$(echo "$out" | awk '/^checksum:/ { print $2 }')
+    best_enc=$(echo "$enc $best_enc" | awk '{ print ($2 == "" || $1 < $2) ? $1 : $2 }')
+    best_dec=$(echo "$dec $best_dec" | awk '{ print ($2 == "" || $1 < $2) ? $1 : $2 }')
+  done
+  echo "$best_enc $best_dec $sum"
+}
+
+set -- $(measure rlp_workload_plain) $(measure rlp_workload_pgo)
+if [ "$3" != "$6" ]; then
+  echo "checksums differ: $3 vs $6" >&2
+  exit 1
+fi
+echo
+echo "$CC $CFLAGS, best of $RUNS runs of $ROUNDS rounds, ns/item"
+printf "%-8s %10s %10s %8s\n" "" plain pgo gain
+echo "$1 $4" | awk '{ printf "%-8s %10.1f %10.1f %7.1f%%\n", "encode", $1, $2, 100 * ($1 - $2) / $1 }'
+echo "$2 $5" | awk '{ printf "%-8s %10.1f %10.1f %7.1f%%\n", "decode", $1, $2, 100 * ($1 - $2) / $1 }'
@@ -0,0 +1,183 @@
+/**
+ * RLP Serializer - Arenas and Buffer Pools
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Huge page backed mappings, bump arenas and fixed size buffer pools.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rlp_arena.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+#define RLP_PAGE_SIZE 4096
+
+static inline size_t rlp_align_up(size_t v, size_t align) {
+  return (v + align - 1) & ~(align - 1);
+}
+
+static void *rlp_mmap_anon(size_t len, int extraFlags) {
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+// Transparent huge pages only apply to 2 MB aligned ranges: over-map, then trim both ends
+static void *rlp_mmap_thp(size_t len) {
+#if defined(MADV_HUGEPAGE)
+  uint8_t *raw = rlp_mmap_anon(len + RLP_HUGEPAGE_SIZE, 0);
+  if(raw == NULL)
+    return NULL;
+  uint8_t *base = (uint8_t *) rlp_align_up((uintptr_t) raw, RLP_HUGEPAGE_SIZE);
+  if(base != raw)
+    munmap(raw, base - raw);
+  munmap(base + len, (raw + len + RLP_HUGEPAGE_SIZE) - (base + len));
+  if(madvise(base, len, MADV_HUGEPAGE) == 0)
+    return base;
+  munmap(base, len);
+#endif
+  (void) len;
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_mem_map(RlpMapping_t *m, size_t len, unsigned flags)
+{
+  if(m == NULL || len == 0)
+    return ERR_RLP_EBADARG;
+  m->base = NULL;
+  if(flags & RLP_MEM_HUGEPAGES) {
+    m->len = rlp_align_up(len, RLP_HUGEPAGE_SIZE);
+#if defined(MAP_HUGETLB)
+    // Reserved huge pages are faulted in by MAP_POPULATE like any other mapping
+    m->base = rlp_mmap_anon(m->len, MAP_HUGETLB | ((flags & RLP_MEM_PREFAULT) ? MAP_POPULATE : 0));
+    m->backing = RLP_MEM_BACKING_HUGETLB;
+#endif
+    if(m->base == NULL) {
+      m->base = rlp_mmap_thp(m->len);
+      m->backing = RLP_MEM_BACKING_THP;
+      // MAP_POPULATE would have faulted small pages before the madvise, touch instead
+      if(m->base != NULL && (flags & RLP_MEM_PREFAULT)) {
+        volatile uint8_t *page = m->base;
+        for(size_t off = 0; off < m->len; off += RLP_PAGE_SIZE)
+          page[off] = 0;
+      }
+    }
+  }
+  if(m->base == NULL) {
+    m->len = rlp_align_up(len, RLP_PAGE_SIZE);
+    m->base = rlp_mmap_anon(m->len, (flags & RLP_MEM_PREFAULT) ? MAP_POPULATE : 0);
+    m->backing = RLP_MEM_BACKING_PAGES;
+  }
+  return m->base ? ERR_RLP_OK : ERR_RLP_ENOMEM;
+}
+
+void rlp_mem_unmap(RlpMapping_t *m)
+{
+  if(m->base)
+    munmap(m->base, m->len);
+  m->base = NULL;
+  m->len = 0;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_arena_init(RlpArena_t *a, size_t cap, unsigned flags)
+{
+  if(a == NULL)
+    return ERR_RLP_EBADARG;
+  a->used = 0;
+  return rlp_mem_map(&a->map, cap, flags);
+}
+
+void *rlp_arena_alloc(RlpArena_t *a, size_t n, size_t align)
+{
+  if(align == 0)
+    align = 1;
+  size_t off = rlp_align_up(a->used, align);
+  if(off > a->map.len || a->map.len - off < n)
+    return NULL;
+  a->used = off + n;
+  return (uint8_t *) a->map.base + off;
+}
+
+void rlp_arena_free(RlpArena_t *a)
+{
+  rlp_mem_unmap(&a->map);
+  a->used = 0;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_buf_pool_init(RlpBufPool_t *p, size_t bufSz, size_t bufsCnt, unsigned flags)
+{
+  if(p == NULL || bufSz == 0 || bufsCnt == 0)
+    return ERR_RLP_EBADARG;
+  p->bufSz = rlp_align_up(bufSz, 64);
+  p->freeHead = NULL;
+  p->freeCnt = 0;
+  int ret = rlp_arena_init(&p->arena, p->bufSz * bufsCnt, flags);
+  if(ret < 0)
+    return ret;
+  // Thread the free list back to front so buffers are handed out in address order
+  for(size_t i = bufsCnt; i > 0; i--)
+    rlp_buf_pool_put(p, (uint8_t *) p->arena.map.base + (i - 1) * p->bufSz);
+  p->arena.used = p->bufSz * bufsCnt;
+  return ERR_RLP_OK;
+}
+
+void *rlp_buf_pool_get(RlpBufPool_t *p)
+{
+  void *buff = p->freeHead;
+  if(buff) {
+    memcpy(&p->freeHead, buff, sizeof(void *));
+    p->freeCnt--;
+  }
+  return buff;
+}
+
+void rlp_buf_pool_put(RlpBufPool_t *p, void *buff)
+{
+  memcpy(buff, &p->freeHead, sizeof(void *));
+  p->freeHead = buff;
+  p->freeCnt++;
+}
+
+void rlp_buf_pool_free(RlpBufPool_t *p)
+{
+  rlp_arena_free(&p->arena);
+  p->freeHead = NULL;
+  p->freeCnt = 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * RLP Serializer - Arenas and Buffer Pools
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Large, long lived encode buffers. Memory can be backed by 2 MB pages to cut TLB
+ * misses (MAP_HUGETLB, falling back to transparent huge pages, falling back to
+ * normal pages) and can be pre-faulted so the first block does not pay for page faults.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_ARENA_H_
+#define __RLP_ARENA_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Flags
+#define RLP_MEM_HUGEPAGES    0x1   // back the memory with 2 MB pages when the system allows it
+#define RLP_MEM_PREFAULT     0x2   // fault every page in at init time
+
+#define RLP_HUGEPAGE_SIZE    (2 * 1024 * 1024)
+
+// What the memory actually ended up backed by
+typedef enum {
+  RLP_MEM_BACKING_PAGES,       // normal pages
+  RLP_MEM_BACKING_THP,         // madvise(MADV_HUGEPAGE), huge pages are up to the kernel
+  RLP_MEM_BACKING_HUGETLB,     // MAP_HUGETLB, reserved huge pages
+} RlpMemBacking_t;
+
+typedef struct rlpMapping {
+  void             *base;
+  size_t           len;
+  RlpMemBacking_t  backing;
+} RlpMapping_t;
+
+// Bump allocator over one mapping, freed all at once
+typedef struct rlpArena {
+  RlpMapping_t     map;
+  size_t           used;
+} RlpArena_t;
+
+// Fixed size buffers carved from an arena, recycled through an intrusive free list
+typedef struct rlpBufPool {
+  RlpArena_t       arena;
+  size_t           bufSz;
+  void             *freeHead;
+  size_t           freeCnt;
+} RlpBufPool_t;
+
+
+// Maps at least len bytes (page aligned, zero filled) according to flags
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_mem_map(RlpMapping_t *m, size_t len, unsigned flags);
+void rlp_mem_unmap(RlpMapping_t *m);
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_arena_init(RlpArena_t *a, size_t cap, unsigned flags);
+
+// align must be a power of two. Returns NULL once the arena is exhausted.
+void *rlp_arena_alloc(RlpArena_t *a, size_t n, size_t align);
+
+static inline void rlp_arena_reset(RlpArena_t *a) {
+  a->used = 0;
+}
+
+void rlp_arena_free(RlpArena_t *a);
+
+// bufSz is rounded up to a multiple of 64 bytes; all bufsCnt buffers are carved out up front
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_buf_pool_init(RlpBufPool_t *p, size_t bufSz, size_t bufsCnt, unsigned flags);
+
+// Returns NULL when every buffer is in use
+void *rlp_buf_pool_get(RlpBufPool_t *p);
+void rlp_buf_pool_put(RlpBufPool_t *p, void *buff);
+void rlp_buf_pool_free(RlpBufPool_t *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * RLP Serializer - Canonicalizer
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Header by header canonicalization of concatenated records: one walk per record
+ * collects the headers to replace, then the record is written as copied spans and
+ * replacement headers.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_canon.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct rlpCanonFrame {
+  size_t   off;          // header offset of an open list
+  size_t   end;          // input offset just past its payload
+  size_t   payloadLen;
+  size_t   shrink;       // bytes its payload loses to edits below it
+  size_t   firstEdit;    // edits made inside it start here
+  uint8_t  hdrLen;
+} RlpCanonFrame_t;
+
+typedef int (*RlpCanonPut_t)(void *ctx, const void *data, size_t len);
+
+/* -------------------------------------------------------------------------- */
+/*                                   Walking                                  */
+/* -------------------------------------------------------------------------- */
+
+// Reads a header without insisting on minimal form
+// Returns ERR_RLP_OK, or ERR_RLP_ENODATA if the item runs past avail
+static int rlp_canon_header(const uint8_t *p, size_t avail, bool *isList, size_t *hdrLen, size_t *payloadLen) {
+  uint8_t b = p[0];
+  *isList = b >= 0xc0;
+  if(b < 0x80) {
+    *hdrLen = 0;
+    *payloadLen = 1;
+  } else if(b <= 0xb7 || (b >= 0xc0 && b <= 0xf7)) {
+    *hdrLen = 1;
+    *payloadLen = b - (*isList ? 0xc0 : 0x80);
+  } else {
+    size_t lenLen = b - (*isList ? 0xf7 : 0xb7);
+    if(lenLen >= avail)
+      return ERR_RLP_ENODATA;
+    uint64_t len = 0;
+    for(size_t i = 1; i <= lenLen; i++)
+      len = len << 8 | p[i];
+    *hdrLen = 1 + lenLen;
+    if(len > avail - *hdrLen)
+      return ERR_RLP_ENODATA;
+    *payloadLen = (size_t) len;
+  }
+  return *hdrLen + *payloadLen > avail ? ERR_RLP_ENODATA : ERR_RLP_OK;
+}
+
+// Inserts an edit at position at, keeping the list in input order
+static int rlp_canon_add(RlpCanon_t *c, size_t at, size_t off, size_t oldLen, const uint8_t *hdr, size_t newLen) {
+  if(c->editsCnt == c->editsCap) {
+    size_t cap = c->editsCap ? c->editsCap * 2 : 64;
+    RlpCanonEdit_t *edits = realloc(c->edits, cap * sizeof(*edits));
+    if(!edits)
+      return ERR_RLP_ENOMEM;
+    c->edits = edits;
+    c->editsCap = cap;
+  }
+  RlpCanonEdit_t *e = &c->edits[at];
+  memmove(e + 1, e, (c->editsCnt - at) * sizeof(*e));
+  c->editsCnt++;
+  e->off = off;
+  e->oldLen = (uint8_t) oldLen;
+  e->newLen = (uint8_t) newLen;
+  memcpy(e->hdr, hdr, newLen);
+  return ERR_RLP_OK;
+}
+
+// Walks the record at *pos, leaving its edits in c->edits and *pos just past it. A list's
+// edit is only known once its children are done; it is slotted in ahead of theirs, which
+// costs a move of the edits below it, and only on lists that change.
+static int rlp_canon_walk(RlpCanon_t *c, const uint8_t *in, size_t inLen, size_t *pos) {
+  RlpCanonFrame_t stack[RLP_CANON_MAX_DEPTH];
+  size_t depth = 0, p = *pos;
+  uint8_t hdr[9];
+  int err;
+
+  c->editsCnt = 0;
+  do {
+    size_t end = depth ? stack[depth - 1].end : inLen;
+    bool isList;
+    size_t hdrLen, payloadLen;
+    err = rlp_canon_header(in + p, end - p, &isList, &hdrLen, &payloadLen);
+    if(err < 0)
+      return depth ? ERR_RLP_EINVAL : err;
+
+    if(isList) {
+      if(depth == RLP_CANON_MAX_DEPTH)
+        return ERR_RLP_EMSGSIZE;
+      RlpCanonFrame_t *f = &stack[depth++];
+      f->off = p;
+      f->end = p + hdrLen + payloadLen;
+      f->payloadLen = payloadLen;
+      f->shrink = 0;
+      f->firstEdit = c->editsCnt;
+      f->hdrLen = (uint8_t) hdrLen;
+      p += hdrLen;
+    } else {
+      // A single byte below 0x80 is its own encoding
+      size_t newLen = payloadLen == 1 && in[p + hdrLen] < 0x80 ? 0 : (size_t) rlp_encode_header(hdr, sizeof(hdr), payloadLen, false);
+      if(newLen != hdrLen || memcmp(hdr, in + p, newLen)) {
+        if((err = rlp_canon_add(c, c->editsCnt, p, hdrLen, hdr, newLen)) < 0)
+          return err;
+        if(depth)
+          stack[depth - 1].shrink += hdrLen - newLen;
+      }
+      p += hdrLen + payloadLen;
+    }
+
+    // Close every list that ends here, innermost first
+    while(depth && p == stack[depth - 1].end) {
+      RlpCanonFrame_t *f = &stack[--depth];
+      size_t newLen = (size_t) rlp_encode_header(hdr, sizeof(hdr), f->payloadLen - f->shrink, true);
+      if(!f->shrink && newLen == f->hdrLen && !memcmp(hdr, in + f->off, newLen))
+        continue;
+      if((err = rlp_canon_add(c, f->firstEdit, f->off, f->hdrLen, hdr, newLen)) < 0)
+        return err;
+      if(depth)
+        stack[depth - 1].shrink += f->shrink + f->hdrLen - newLen;
+    }
+  } while(depth);
+
+  *pos = p;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Writing                                  */
+/* -------------------------------------------------------------------------- */
+
+// Input before *cursor has been written; records without edits leave it where it is
+static int rlp_canon_run(RlpCanon_t *c, const uint8_t *in, size_t inLen, RlpCanonPut_t put, void *ctx) {
+  size_t pos = 0, cursor = 0;
+  int err;
+  while(pos < inLen) {
+    if((err = rlp_canon_walk(c, in, inLen, &pos)) < 0)
+      return err;
+    c->recordsCnt++;
+    for(size_t i = 0; i < c->editsCnt; i++) {
+      const RlpCanonEdit_t *e = &c->edits[i];
+      if((err = put(ctx, in + cursor, e->off - cursor)) < 0 || (err = put(ctx, e->hdr, e->newLen)) < 0)
+        return err;
+      cursor = e->off + e->oldLen;
+    }
+    c->rewrittenCnt += c->editsCnt;
+  }
+  err = put(ctx, in + cursor, inLen - cursor);
+  return err < 0 ? err : ERR_RLP_OK;
+}
+
+static int rlp_canon_put_sink(void *ctx, const void *data, size_t len) {
+  return len ? rlp_sink_write((RlpSink_t *) ctx, data, len) : 0;
+}
+
+typedef struct rlpCanonBuff {
+  uint8_t  *out;
+  size_t   len;
+  size_t   cap;
+} RlpCanonBuff_t;
+
+// memmove, out may trail the input it is reading from
+static int rlp_canon_put_buff(void *ctx, const void *data, size_t len) {
+  RlpCanonBuff_t *b = (RlpCanonBuff_t *) ctx;
+  if(len > b->cap - b->len)
+    return ERR_RLP_ENOMEM;
+  if(b->out + b->len != data)
+    memmove(b->out + b->len, data, len);
+  b->len += len;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+void rlp_canon_init(RlpCanon_t *c)
+{
+  memset(c, 0, sizeof(*c));
+}
+
+void rlp_canon_free(RlpCanon_t *c)
+{
+  free(c->edits);
+  memset(c, 0, sizeof(*c));
+}
+
+int rlp_canon_sink(RlpCanon_t *c, const void *in, size_t inLen, RlpSink_t *out)
+{
+  if(!c || !out || (!in && inLen))
+    return ERR_RLP_EBADARG;
+  return rlp_canon_run(c, (const uint8_t *) in, inLen, rlp_canon_put_sink, out);
+}
+
+int rlp_canon(RlpCanon_t *c, const void *in, size_t inLen, void *out, size_t outCap)
+{
+  if(!c || (!in && inLen) || !out || inLen > INT32_MAX)
+    return ERR_RLP_EBADARG;
+  RlpCanonBuff_t b = { (uint8_t *) out, 0, outCap };
+  int err = rlp_canon_run(c, (const uint8_t *) in, inLen, rlp_canon_put_buff, &b);
+  return err < 0 ? err : (int) b.len;
+}
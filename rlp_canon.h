@@ -0,0 +1,88 @@
+/**
+ * RLP Serializer - Canonicalizer
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Rewrites RLP from lenient producers into canonical form. Headers are checked as
+ * they stream by; only the ones that are not minimal, and the list headers enclosing
+ * them, are rewritten. Everything else is copied through in as few spans as possible.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_CANON_H_
+#define __RLP_CANON_H_
+
+#include "rlp_serializer.h"
+#include "rlp_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deepest list nesting accepted, deeper input fails with ERR_RLP_EMSGSIZE
+#define RLP_CANON_MAX_DEPTH 64
+
+// Fixed up forms: a long header for a payload of up to 55 bytes, a length with leading
+// zero bytes, and a single byte below 0x80 wrapped in a string header. Integers with
+// leading zero bytes are left alone, nothing in the encoding tells them apart from strings.
+// Anything else that is not valid RLP, a truncated item or a child running past its list,
+// is an error as usual.
+
+typedef struct rlpCanonEdit {
+  size_t   off;        // input offset of the header being replaced
+  uint8_t  oldLen;
+  uint8_t  newLen;     // 0 drops the header of a single byte string
+  uint8_t  hdr[9];
+} RlpCanonEdit_t;
+
+// Holds the edits of the record in flight, reused across calls so clean input allocates nothing
+typedef struct rlpCanon {
+  RlpCanonEdit_t  *edits;
+  size_t          editsCnt;
+  size_t          editsCap;
+  size_t          recordsCnt;   // records seen, over every call
+  size_t          rewrittenCnt; // headers rewritten, over every call
+} RlpCanon_t;
+
+void rlp_canon_init(RlpCanon_t *c);
+
+void rlp_canon_free(RlpCanon_t *c);
+
+// Writes in, any number of records back to back, to out in canonical form. A record is
+// walked once to find its edits, then written as the spans between them; records that
+// need none are not touched and join the span that follows, so clean input is one write.
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_canon_sink(RlpCanon_t *c, const void *in, size_t inLen, RlpSink_t *out);
+
+// As rlp_canon_sink() into a buffer. The canonical form is never longer than the input
+// and never gets ahead of it, so out may be in itself.
+// Returns length of output in bytes, or a negative error value
+int rlp_canon(RlpCanon_t *c, const void *in, size_t inLen, void *out, size_t outCap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
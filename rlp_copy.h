@@ -0,0 +1,100 @@
+/**
+ * RLP Serializer - Payload Copies
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Internal header shared by the encoders, not part of the public API.
+ * Picks the copy strategy for payload bytes by size.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_COPY_H_
+#define __RLP_COPY_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Storage class of library globals; each translation unit has its own in RLP_STATIC builds
+#if defined(RLP_STATIC)
+#define RLP_GLOBAL static
+#else
+#define RLP_GLOBAL extern
+#endif
+
+// Payloads at or above this size are copied with non-temporal stores, see rlp_set_stream_copy_threshold()
+RLP_GLOBAL size_t rlpStreamCopyThreshold;
+
+// Copies through non-temporal stores so the destination does not displace the cache
+RLP_API void rlp_copy_stream(void *dst, const void *src, size_t n);
+
+// Largest payload handled by rlp_copy_small()
+#define RLP_SMALL_COPY_MAX 64
+
+// Fixed size memcpy() compiles to a single unaligned load or store
+#define RLP_COPY_FIXED(d, s, n) do { \
+    uint8_t tmp_[n];                 \
+    memcpy(tmp_, (s), n);            \
+    memcpy((d), tmp_, n);            \
+  } while(0)
+
+// Copies 0..64 bytes without a call into libc. Every size class is covered by two
+// fixed width moves, one from each end, which overlap in the middle; only bytes
+// [0, n) of dst are ever written so no slack is needed after the output.
+// Classes: 1-3, 4-7, 8-15, 16-31, 32-64.
+static inline void rlp_copy_small(void *dst, const void *src, size_t n) {
+  uint8_t *d = (uint8_t *) dst;
+  const uint8_t *s = (const uint8_t *) src;
+  if(n >= 16) {
+    if(n >= 32) {
+      RLP_COPY_FIXED(d, s, 32);
+      RLP_COPY_FIXED(d + n - 32, s + n - 32, 32);
+    } else {
+      RLP_COPY_FIXED(d, s, 16);
+      RLP_COPY_FIXED(d + n - 16, s + n - 16, 16);
+    }
+  } else if(n >= 8) {
+    RLP_COPY_FIXED(d, s, 8);
+    RLP_COPY_FIXED(d + n - 8, s + n - 8, 8);
+  } else if(n >= 4) {
+    RLP_COPY_FIXED(d, s, 4);
+    RLP_COPY_FIXED(d + n - 4, s + n - 4, 4);
+  } else if(n) {
+    d[0] = s[0];
+    d[n / 2] = s[n / 2];
+    d[n - 1] = s[n - 1];
+  }
+}
+
+static inline void rlp_copy_payload(void *dst, const void *src, size_t n) {
+  if(n <= RLP_SMALL_COPY_MAX)
+    rlp_copy_small(dst, src, n);
+  else if(n >= rlpStreamCopyThreshold)
+    rlp_copy_stream(dst, src, n);
+  else
+    memcpy(dst, src, n);
+}
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * RLP Serializer - Stream Copy Benchmark
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Encodes large byte strings while another thread keeps touching a hot working set,
+ * once with non-temporal payload copies off and once with them on, for a range of
+ * payload sizes. With a single CPU the two would only take turns, so the hot set is
+ * walked once after every copy instead. Reports the copy rate and the hot set's time per access; the size
+ * where streaming starts to pay is where RLP_STREAM_COPY_THRESHOLD should sit.
+ * Build: cc -O2 rlp_copy_bench.c rlp_serializer.c -lpthread
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_serializer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_AREA        (64u << 20)   // source and output areas cycled through by the encoder
+#define BENCH_BYTES       (256u << 20)  // encoded per measurement
+#define BENCH_LINE        64
+
+typedef struct {
+  size_t       *next;       // one pointer chase cycle through the hot set, a line per step
+  volatile int running;
+  volatile int stop;
+  uint64_t     steps;
+  double       ns;
+} BenchHot_t;
+
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Random cyclic order, so the hardware prefetcher cannot hide misses
+static size_t *bench_hot_init(size_t hotLen) {
+  size_t lines = hotLen / BENCH_LINE, stride = BENCH_LINE / sizeof(size_t);
+  size_t *next = aligned_alloc(BENCH_LINE, lines * BENCH_LINE);
+  size_t *order = malloc(lines * sizeof(*order));
+  if(!next || !order)
+    exit(1);
+  for(size_t i = 0; i < lines; i++)
+    order[i] = i;
+  for(size_t i = lines - 1; i > 0; i--) {
+    size_t j = rng() % (i + 1), t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for(size_t i = 0; i < lines; i++)
+    next[order[i] * stride] = order[(i + 1) % lines] * stride;
+  free(order);
+  return next;
+}
+
+static void *bench_hot_run(void *arg) {
+  BenchHot_t *h = (BenchHot_t *) arg;
+  size_t p = 0;
+  uint64_t steps = 0;
+  // Warm the set before the clock starts
+  do
+    p = h->next[p];
+  while(p != 0);
+  h->running = 1;
+  double t0 = now_ns();
+  while(!h->stop) {
+    for(int i = 0; i < 1024; i++)
+      p = h->next[p];
+    steps += 1024;
+  }
+  h->ns = now_ns() - t0;
+  h->steps = steps + (p == SIZE_MAX);
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+  double  gbs;
+  double  hotNs;     // per hot set access
+} BenchResult_t;
+
+// One pass over the hot set right after a copy: what the copy evicted is missed here
+static double bench_hot_pass(const size_t *next) {
+  double t0 = now_ns();
+  size_t p = 0;
+  do
+    p = next[p];
+  while(p != 0);
+  return now_ns() - t0;
+}
+
+static BenchResult_t bench_copy(uint8_t *src, uint8_t *dst, size_t payloadLen, size_t *hotNext, size_t hotLen,
+                                bool interleaved) {
+  BenchHot_t hot = { .next = hotNext };
+  pthread_t thread;
+  if(!interleaved) {
+    if(pthread_create(&thread, NULL, bench_hot_run, &hot) != 0)
+      exit(1);
+    while(!hot.running)
+      ;
+  }
+
+  size_t encodedLen = payloadLen + 9, slots = BENCH_AREA / encodedLen;
+  size_t copies = BENCH_BYTES / payloadLen;
+  double ns = 0, hotNs = 0;
+  for(size_t i = 0; i < copies; i++) {
+    size_t slot = i % slots;
+    RlpElement_t e = { .type = RLP_TYPE_BYTE_ARRAY, .len = payloadLen, .buff = src + slot * encodedLen };
+    double t0 = now_ns();
+    if(rlp_encode_element(dst + slot * encodedLen, encodedLen, &e) < 0)
+      exit(1);
+    ns += now_ns() - t0;
+    if(interleaved)
+      hotNs += bench_hot_pass(hotNext);
+  }
+
+  BenchResult_t r = { (double) copies * payloadLen / ns, hotNs / copies / (hotLen / BENCH_LINE) };
+  if(!interleaved) {
+    hot.stop = 1;
+    pthread_join(thread, NULL);
+    r.hotNs = hot.ns / hot.steps;
+  }
+  return r;
+}
+
+int main(int argc, char **argv) {
+  size_t hotLen = (argc > 1 ? strtoull(argv[1], NULL, 10) : 1024) << 10;
+  if(hotLen < BENCH_LINE) {
+    fprintf(stderr, "usage: %s [hot set KiB]\n", argv[0]);
+    return 1;
+  }
+
+  uint8_t *src = malloc(BENCH_AREA), *dst = malloc(BENCH_AREA);
+  if(!src || !dst)
+    return 1;
+  for(size_t i = 0; i < BENCH_AREA; i++)
+    src[i] = (uint8_t) rng();
+  memset(dst, 0, BENCH_AREA);
+  size_t *hotNext = bench_hot_init(hotLen);
+
+  // The hot set alone, as the baseline for the slowdown columns
+  bool interleaved = sysconf(_SC_NPROCESSORS_ONLN) < 2;
+  double baseNs = 0;
+  bench_hot_pass(hotNext);
+  for(int i = 0; i < 16; i++)
+    baseNs += bench_hot_pass(hotNext) / 16 / (hotLen / BENCH_LINE);
+
+  printf("hot set %zu KiB alone: %.2f ns/access, %s\n", hotLen >> 10, baseNs,
+         interleaved ? "walked after every copy (one CPU)" : "walked by a second thread");
+  printf("%10s | %-27s | %-27s\n", "", "memcpy", "non-temporal");
+  printf("%10s | %8s %8s %9s | %8s %8s %9s\n", "payload", "GB/s", "ns/acc", "hot", "GB/s", "ns/acc", "hot");
+  static const size_t sizes[] = { 16 << 10, 64 << 10, 256 << 10, 512 << 10, 1 << 20, 2 << 20, 4 << 20, 16 << 20 };
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    rlp_set_stream_copy_threshold(SIZE_MAX);
+    BenchResult_t off = bench_copy(src, dst, sizes[i], hotNext, hotLen, interleaved);
+    rlp_set_stream_copy_threshold(sizes[i]);
+    BenchResult_t on = bench_copy(src, dst, sizes[i], hotNext, hotLen, interleaved);
+    printf("%7zu KiB | %8.2f %8.2f %8.0f%% | %8.2f %8.2f %8.0f%%\n", sizes[i] >> 10,
+           off.gbs, off.hotNs, 100.0 * (off.hotNs / baseNs - 1), on.gbs, on.hotNs, 100.0 * (on.hotNs / baseNs - 1));
+  }
+  rlp_set_stream_copy_threshold(RLP_STREAM_COPY_THRESHOLD);
+
+  free(hotNext);
+  free(dst);
+  free(src);
+  return 0;
+}
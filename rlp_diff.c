@@ -0,0 +1,335 @@
+/**
+ * RLP Serializer - Structural Diff
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Lockstep diff of two encodings and in-place application of the edit script.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_diff.h"
+#include <string.h>
+
+typedef struct rlpEditAncestor {
+  size_t   off;          // header offset of an enclosing list
+  size_t   hdrLen;
+  size_t   payloadLen;
+  size_t   newHdrLen;
+  size_t   newPayloadLen;
+} RlpEditAncestor_t;
+
+typedef struct rlpDiff {
+  uint8_t  *out;
+  size_t   cap;
+  size_t   len;
+  size_t   depth;
+  uint32_t path[RLP_DIFF_MAX_DEPTH];
+} RlpDiff_t;
+
+static inline const uint8_t *rlp_item_start(const RlpItem_t *item) {
+  return item->payload + item->payloadLen - item->encodedLen;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Paths                                   */
+/* -------------------------------------------------------------------------- */
+
+// Positions cur on child idx of list; idx may equal the child count when allowEnd is set
+static int rlp_path_child(RlpCursor_t *cur, const RlpItem_t *list, uint32_t idx, bool allowEnd) {
+  if(!list->isList)
+    return ERR_RLP_ENOENT;
+  int err = rlp_cursor_init(cur, list);
+  if(err < 0)
+    return err;
+  RlpItem_t skip;
+  for(uint32_t i = 0; i < idx; i++) {
+    err = rlp_cursor_next(cur, &skip);
+    if(err <= 0)
+      return err < 0 ? err : ERR_RLP_ENOENT;
+  }
+  if(cur->pos == cur->end && !allowEnd)
+    return ERR_RLP_ENOENT;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Diffing                                  */
+/* -------------------------------------------------------------------------- */
+
+static size_t rlp_diff_path_payload_len(const RlpDiff_t *d) {
+  size_t len = 0;
+  for(size_t i = 0; i < d->depth; i++)
+    len += rlp_uint64_encoded_len(d->path[i]);
+  return len;
+}
+
+// Encoded size of an edit at the current path
+static size_t rlp_diff_edit_len(const RlpDiff_t *d, RlpEditOp_e op, const RlpItem_t *item) {
+  size_t pathLen = rlp_diff_path_payload_len(d);
+  size_t payloadLen = 1 + rlp_header_len(pathLen) + pathLen + (op == RLP_EDIT_DELETE ? 0 : item->encodedLen);
+  return rlp_header_len(payloadLen) + payloadLen;
+}
+
+static int rlp_diff_emit(RlpDiff_t *d, RlpEditOp_e op, const RlpItem_t *item) {
+  size_t pathLen = rlp_diff_path_payload_len(d);
+  size_t itemLen = op == RLP_EDIT_DELETE ? 0 : item->encodedLen;
+  size_t payloadLen = 1 + rlp_header_len(pathLen) + pathLen + itemLen;
+  if(rlp_header_len(payloadLen) + payloadLen > d->cap - d->len)
+    return ERR_RLP_EMSGSIZE;
+
+  uint8_t *p = d->out + d->len;
+  p += rlp_encode_header(p, d->cap - d->len, payloadLen, true);
+  *p++ = (uint8_t) op;
+  p += rlp_encode_header(p, rlp_header_len(pathLen), pathLen, true);
+  for(size_t i = 0; i < d->depth; i++)
+    p += rlp_encode_uint64(p, rlp_uint64_encoded_len(d->path[i]), d->path[i]);
+  if(itemLen)
+    memcpy(p, rlp_item_start(item), itemLen);
+  d->len = (size_t) (p + itemLen - d->out);
+  return ERR_RLP_OK;
+}
+
+static int rlp_diff_items(RlpDiff_t *d, const RlpItem_t *a, const RlpItem_t *b);
+
+// Child i of a against child i of b; extra children of b are inserted, extra children of a deleted
+static int rlp_diff_lists(RlpDiff_t *d, const RlpItem_t *a, const RlpItem_t *b) {
+  RlpCursor_t ca, cb;
+  int err = rlp_cursor_init(&ca, a);
+  if(err == ERR_RLP_OK)
+    err = rlp_cursor_init(&cb, b);
+  if(err < 0)
+    return err;
+
+  d->depth++;
+  for(uint32_t i = 0;; i++) {
+    RlpItem_t ia, ib;
+    int ra = rlp_cursor_next(&ca, &ia);
+    int rb = rlp_cursor_next(&cb, &ib);
+    if(ra < 0 || rb < 0) {
+      err = ra < 0 ? ra : rb;
+      break;
+    }
+    if(ra == 0 && rb == 0)
+      break;
+
+    d->path[d->depth - 1] = i;
+    if(ra && rb)
+      err = rlp_diff_items(d, &ia, &ib);
+    else if(rb)
+      err = rlp_diff_emit(d, RLP_EDIT_INSERT, &ib);
+    else {
+      // Every delete lands on index i, the rest of a shifts down behind it
+      d->path[d->depth - 1] = i--;
+      err = rlp_diff_emit(d, RLP_EDIT_DELETE, NULL);
+    }
+    if(err < 0)
+      break;
+  }
+  d->depth--;
+  return err;
+}
+
+static int rlp_diff_items(RlpDiff_t *d, const RlpItem_t *a, const RlpItem_t *b) {
+  if(a->encodedLen == b->encodedLen && memcmp(rlp_item_start(a), rlp_item_start(b), a->encodedLen) == 0)
+    return ERR_RLP_OK;
+  if(!a->isList || !b->isList || d->depth == RLP_DIFF_MAX_DEPTH)
+    return rlp_diff_emit(d, RLP_EDIT_REPLACE, b);
+
+  // Diff the children, but fall back to one replace when that is shorter or the children do not fit
+  size_t mark = d->len;
+  int err = rlp_diff_lists(d, a, b);
+  if(err < 0 && err != ERR_RLP_EMSGSIZE)
+    return err;
+  if(err == ERR_RLP_OK && d->len - mark <= rlp_diff_edit_len(d, RLP_EDIT_REPLACE, b))
+    return ERR_RLP_OK;
+  d->len = mark;
+  return rlp_diff_emit(d, RLP_EDIT_REPLACE, b);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_path_get(const void *rlpEncoded, size_t rlpEncodedLen, const uint32_t *path, size_t depth, RlpItem_t *item)
+{
+  if(rlpEncoded == NULL || item == NULL || (path == NULL && depth))
+    return ERR_RLP_EBADARG;
+  int err = rlp_decode_item(rlpEncoded, rlpEncodedLen, item);
+  if(err < 0)
+    return err;
+  for(size_t i = 0; i < depth; i++) {
+    RlpCursor_t cur;
+    err = rlp_path_child(&cur, item, path[i], false);
+    if(err == ERR_RLP_OK)
+      err = rlp_cursor_next(&cur, item);
+    if(err < 0)
+      return err;
+  }
+  return ERR_RLP_OK;
+}
+
+int rlp_diff(const void *a, size_t aLen, const void *b, size_t bLen, void *script, size_t scriptCap)
+{
+  if(a == NULL || b == NULL || (script == NULL && scriptCap))
+    return ERR_RLP_EBADARG;
+  RlpItem_t ia, ib;
+  int ret = rlp_decode_item(a, aLen, &ia);
+  if(ret >= 0 && (size_t) ret != aLen)
+    ret = ERR_RLP_EINVAL;
+  if(ret >= 0)
+    ret = rlp_decode_item(b, bLen, &ib);
+  if(ret >= 0 && (size_t) ret != bLen)
+    ret = ERR_RLP_EINVAL;
+  if(ret < 0)
+    return ret;
+
+  RlpDiff_t d = {.out = script, .cap = scriptCap > INT32_MAX ? INT32_MAX : scriptCap};
+  int err = rlp_diff_items(&d, &ia, &ib);
+  if(err < 0)
+    return err;
+  return (int) d.len;
+}
+
+int rlp_edit(void *rlpEncoded, size_t *len, size_t cap, const uint32_t *path, size_t depth,
+             RlpEditOp_e op, const void *item, size_t itemLen)
+{
+  if(rlpEncoded == NULL || len == NULL || *len > cap || (path == NULL && depth) || depth > RLP_DIFF_MAX_DEPTH)
+    return ERR_RLP_EBADARG;
+  if(op != RLP_EDIT_REPLACE && op != RLP_EDIT_INSERT && op != RLP_EDIT_DELETE)
+    return ERR_RLP_EBADARG;
+  if(depth == 0 && op != RLP_EDIT_REPLACE)
+    return ERR_RLP_EBADARG;
+  if(op == RLP_EDIT_DELETE)
+    itemLen = 0;
+  else {
+    RlpItem_t newItem;
+    int ret = item ? rlp_decode_item(item, itemLen, &newItem) : ERR_RLP_EBADARG;
+    if(ret >= 0 && (size_t) ret != itemLen)
+      ret = ERR_RLP_EINVAL;
+    if(ret < 0)
+      return ret;
+  }
+
+  // Find the target range and every list enclosing it
+  uint8_t *buff = rlpEncoded;
+  RlpEditAncestor_t anc[RLP_DIFF_MAX_DEPTH];
+  RlpItem_t cur;
+  int err = rlp_decode_item(buff, *len, &cur);
+  if(err < 0)
+    return err;
+  size_t off = 0;
+  for(size_t i = 0; i < depth; i++) {
+    anc[i].off = off;
+    anc[i].hdrLen = cur.encodedLen - cur.payloadLen;
+    anc[i].payloadLen = cur.payloadLen;
+    RlpCursor_t c;
+    bool last = i + 1 == depth;
+    err = rlp_path_child(&c, &cur, path[i], last && op == RLP_EDIT_INSERT);
+    if(err < 0)
+      return err;
+    off = (size_t) (c.pos - buff);
+    if(last && op == RLP_EDIT_INSERT)
+      cur.encodedLen = 0;
+    else if((err = rlp_cursor_next(&c, &cur)) < 0)
+      return err;
+  }
+  size_t targetLen = cur.encodedLen;
+
+  // Headers grow or shrink with the payload, so the final size is known before anything moves
+  size_t newLen = *len - targetLen + itemLen;
+  size_t removed = targetLen, added = itemLen;
+  for(size_t i = depth; i-- > 0;) {
+    anc[i].newPayloadLen = anc[i].payloadLen + added - removed;
+    anc[i].newHdrLen = rlp_header_len(anc[i].newPayloadLen);
+    newLen += anc[i].newHdrLen - anc[i].hdrLen;
+    removed = anc[i].hdrLen + anc[i].payloadLen;
+    added = anc[i].newHdrLen + anc[i].newPayloadLen;
+  }
+  if(newLen > cap)
+    return ERR_RLP_EMSGSIZE;
+
+  size_t curLen = *len;
+  memmove(buff + off + itemLen, buff + off + targetLen, curLen - off - targetLen);
+  if(itemLen)
+    memcpy(buff + off, item, itemLen);
+  curLen = curLen - targetLen + itemLen;
+  for(size_t i = depth; i-- > 0;) {
+    RlpEditAncestor_t *a = &anc[i];
+    if(a->newHdrLen != a->hdrLen) {
+      memmove(buff + a->off + a->newHdrLen, buff + a->off + a->hdrLen, curLen - a->off - a->hdrLen);
+      curLen = curLen - a->hdrLen + a->newHdrLen;
+    }
+    rlp_encode_header(buff + a->off, a->newHdrLen, a->newPayloadLen, true);
+  }
+  *len = curLen;
+  return ERR_RLP_OK;
+}
+
+int rlp_edit_apply(void *rlpEncoded, size_t *len, size_t cap, const void *script, size_t scriptLen)
+{
+  if(rlpEncoded == NULL || len == NULL || (script == NULL && scriptLen))
+    return ERR_RLP_EBADARG;
+  const uint8_t *pos = script, *end = pos + scriptLen;
+  while(pos < end) {
+    RlpItem_t edit, field, newItem = {0};
+    RlpCursor_t cur, pathCur;
+    uint64_t op;
+    uint32_t path[RLP_DIFF_MAX_DEPTH];
+    size_t depth = 0;
+
+    int err = rlp_decode_item(pos, (size_t) (end - pos), &edit);
+    if(err < 0)
+      return err;
+    pos += edit.encodedLen;
+    if(!edit.isList || rlp_cursor_init(&cur, &edit) < 0)
+      return ERR_RLP_EINVAL;
+    // Op
+    if((err = rlp_cursor_next(&cur, &field)) != 1 || rlp_decode_uint64(&field, &op) < 0)
+      return err < 0 ? err : ERR_RLP_EINVAL;
+    // Path
+    if((err = rlp_cursor_next(&cur, &field)) != 1 || !field.isList || rlp_cursor_init(&pathCur, &field) < 0)
+      return err < 0 ? err : ERR_RLP_EINVAL;
+    while((err = rlp_cursor_next(&pathCur, &field)) == 1) {
+      uint64_t idx;
+      if(depth == RLP_DIFF_MAX_DEPTH || rlp_decode_uint64(&field, &idx) < 0 || idx > UINT32_MAX)
+        return ERR_RLP_EINVAL;
+      path[depth++] = (uint32_t) idx;
+    }
+    if(err < 0)
+      return err;
+    // Item, absent for deletes
+    err = rlp_cursor_next(&cur, &newItem);
+    if(err < 0)
+      return err;
+    if((err == 0) != (op == RLP_EDIT_DELETE) || rlp_cursor_next(&cur, &field) != 0)
+      return ERR_RLP_EINVAL;
+
+    err = rlp_edit(rlpEncoded, len, cap, path, depth, (RlpEditOp_e) op,
+                   newItem.encodedLen ? rlp_item_start(&newItem) : NULL, newItem.encodedLen);
+    if(err < 0)
+      return err;
+  }
+  return ERR_RLP_OK;
+}
@@ -0,0 +1,82 @@
+/**
+ * RLP Serializer - Structural Diff
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Compares two encodings in lockstep. Subtrees whose bytes are equal are skipped
+ * with a memcmp and never decoded; what differs becomes an edit script that
+ * rlp_edit_apply() replays in place, so a delta can be shipped instead of the payload.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_DIFF_H_
+#define __RLP_DIFF_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deepest path an edit can address; lists nested deeper are replaced whole
+#define RLP_DIFF_MAX_DEPTH 32
+
+typedef enum {
+  RLP_EDIT_REPLACE = 1,   // item at path becomes the new item
+  RLP_EDIT_INSERT,        // new item goes before child path[depth-1], which may equal the child count to append
+  RLP_EDIT_DELETE,        // item at path is removed
+} RlpEditOp_e;
+
+// A path is the child index taken at each level, starting below the root item.
+// The empty path (depth 0) is the root itself.
+
+// Looks up the item at path
+// Returns ERR_RLP_OK, ERR_RLP_ENOENT if the path runs past a list or into a string, or a negative error value
+int rlp_path_get(const void *rlpEncoded, size_t rlpEncodedLen, const uint32_t *path, size_t depth, RlpItem_t *item);
+
+// Writes an edit script turning encoding a into encoding b, each a single item.
+// The script is a sequence of encoded edits [op, [path...], item], applied in order;
+// delete edits carry no item. Lists that differ are diffed child by child, unless
+// replacing them whole is shorter. An identical input gives an empty script.
+// Returns length of output in bytes, or a negative error value
+int rlp_diff(const void *a, size_t aLen, const void *b, size_t bLen, void *script, size_t scriptCap);
+
+// Applies one edit in place. The enclosing list headers are rewritten and the bytes after
+// the edit moved, *len is updated. item must be one encoded item, it is ignored for deletes.
+// Nothing is changed on error.
+// Returns ERR_RLP_OK, ERR_RLP_EMSGSIZE if the result would exceed cap, or a negative error value
+int rlp_edit(void *rlpEncoded, size_t *len, size_t cap, const uint32_t *path, size_t depth,
+             RlpEditOp_e op, const void *item, size_t itemLen);
+
+// Applies every edit of a script from rlp_diff() in place; the script must not overlap the buffer.
+// An error part way leaves the earlier edits applied.
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_edit_apply(void *rlpEncoded, size_t *len, size_t cap, const void *script, size_t scriptLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,270 @@
+/**
+ * RLP Serializer - C++ Streaming Encoder
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * C++20 coroutine that encodes a tree of elements and lists in fixed size chunks,
+ * on demand. It suspends whenever the chunk buffer fills, mid-element or
+ * mid-list, so memory stays at one chunk no matter how large the output is.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_ENCODE_STREAM_HPP_
+#define __RLP_ENCODE_STREAM_HPP_
+
+#include "rlp_serializer.hpp"
+
+#include <algorithm>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <iterator>
+
+namespace rlp {
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tree                                    */
+/* -------------------------------------------------------------------------- */
+
+// Something to encode: an element, a list of nodes or already encoded bytes.
+// Sizes are computed when a node is built, children first, so the stream never
+// has to walk a subtree twice to write a list header.
+class node {
+public:
+  enum class kind : std::uint8_t { element, list, raw };
+
+  static node element(const RlpElement_t &e) noexcept {
+    node n(kind::element);
+    n.element_ = &e;
+    n.encodedLen_ = rlp_element_encoded_len(&e);
+    return n;
+  }
+
+  // children must outlive the node
+  static node list(std::span<const node> children) noexcept {
+    node n(kind::list);
+    n.children_ = children;
+    std::size_t payloadLen = 0;
+    for(const node &c : children) {
+      if(c.encodedLen_ == 0)
+        return n; // invalid child, encodedLen_ stays 0
+      payloadLen += c.encodedLen_;
+    }
+    n.payloadLen_ = payloadLen;
+    n.encodedLen_ = rlp_header_len(payloadLen) + payloadLen;
+    return n;
+  }
+
+  static node raw(std::span<const std::uint8_t> encoded) noexcept {
+    node n(kind::raw);
+    n.raw_ = encoded;
+    n.encodedLen_ = encoded.size();
+    return n;
+  }
+
+  kind type() const noexcept { return kind_; }
+  // 0 for an invalid node
+  std::size_t encoded_len() const noexcept { return encodedLen_; }
+  std::size_t payload_len() const noexcept { return payloadLen_; }
+  const RlpElement_t *elem() const noexcept { return element_; }
+  std::span<const node> children() const noexcept { return children_; }
+  std::span<const std::uint8_t> raw_bytes() const noexcept { return raw_; }
+
+private:
+  explicit node(kind k) noexcept : kind_(k) {}
+
+  kind                          kind_;
+  const RlpElement_t            *element_ = nullptr;
+  std::span<const node>         children_;
+  std::span<const std::uint8_t> raw_;
+  std::size_t                   payloadLen_ = 0;
+  std::size_t                   encodedLen_ = 0;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                  Generator                                 */
+/* -------------------------------------------------------------------------- */
+
+// Generator of output chunks. A chunk stays valid until the next call to next(),
+// every chunk but the last one fills the whole chunk buffer.
+class encode_stream {
+public:
+  struct promise_type {
+    std::span<const std::uint8_t>  chunk;
+    error                          err = error::ok;
+
+    encode_stream get_return_object() noexcept {
+      return encode_stream(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(std::span<const std::uint8_t> c) noexcept {
+      chunk = c;
+      return {};
+    }
+    void return_value(error e) noexcept { err = e; }
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+
+  encode_stream(const encode_stream &) = delete;
+  encode_stream &operator=(const encode_stream &) = delete;
+  encode_stream(encode_stream &&other) noexcept : h_(std::exchange(other.h_, nullptr)) {}
+  encode_stream &operator=(encode_stream &&other) noexcept {
+    if(this != &other) {
+      if(h_)
+        h_.destroy();
+      h_ = std::exchange(other.h_, nullptr);
+    }
+    return *this;
+  }
+  ~encode_stream() {
+    if(h_)
+      h_.destroy();
+  }
+
+  // Produces the next chunk; false once the encoding is complete or failed
+  bool next() {
+    if(!h_ || h_.done())
+      return false;
+    h_.resume();
+    return !h_.done();
+  }
+
+  std::span<const std::uint8_t> chunk() const noexcept { return h_.promise().chunk; }
+  // error::ok after a complete run
+  error err() const noexcept { return h_.promise().err; }
+
+  class iterator {
+  public:
+    using value_type = std::span<const std::uint8_t>;
+    using difference_type = std::ptrdiff_t;
+    iterator() noexcept = default;
+    explicit iterator(encode_stream *s) noexcept : s_(s) {}
+    value_type operator*() const noexcept { return s_->chunk(); }
+    iterator &operator++() {
+      if(!s_->next())
+        s_ = nullptr;
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const noexcept { return s_ == nullptr; }
+  private:
+    encode_stream *s_ = nullptr;
+  };
+
+  iterator begin() {
+    return next() ? iterator(this) : iterator();
+  }
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+  explicit encode_stream(std::coroutine_handle<promise_type> h) noexcept : h_(h) {}
+  std::coroutine_handle<promise_type> h_;
+};
+
+// Deepest list nesting encode_chunks() accepts; bounds the coroutine frame
+#ifndef RLP_STREAM_MAX_DEPTH
+#define RLP_STREAM_MAX_DEPTH 32
+#endif
+
+namespace detail {
+// Copies what fits of pending into the chunk; true when the chunk is full
+inline bool stream_fill(std::span<std::uint8_t> buff, std::size_t &used,
+                        std::span<const std::uint8_t> &pending) noexcept {
+  std::size_t n = std::min(pending.size(), buff.size() - used);
+  std::memcpy(buff.data() + used, pending.data(), n);
+  used += n;
+  pending = pending.subspan(n);
+  return used == buff.size();
+}
+} // namespace detail
+
+// Encodes root in chunks of chunkBuffer.size() bytes; root, everything it
+// references and chunkBuffer must outlive the stream
+inline encode_stream encode_chunks(const node &root, std::span<std::uint8_t> chunkBuffer) {
+  if(root.encoded_len() == 0 || chunkBuffer.empty())
+    co_return error::bad_arg;
+
+  struct level {
+    const node  *it;
+    const node  *end;
+  } stack[RLP_STREAM_MAX_DEPTH];
+  std::size_t depth = 0;
+  std::size_t used = 0;
+  std::uint8_t hdr[1 + 9 + 128];   // header, or a whole integer element
+  std::span<const std::uint8_t> pending;
+
+  stack[depth++] = {&root, &root + 1};
+  while(depth) {
+    level &top = stack[depth - 1];
+    if(top.it == top.end) {
+      depth--;
+      continue;
+    }
+    const node &n = *top.it++;
+    switch(n.type()) {
+      case node::kind::list: {
+        if(depth == RLP_STREAM_MAX_DEPTH)
+          co_return error::msg_size;
+        pending = {hdr, static_cast<std::size_t>(rlp_encode_header(hdr, sizeof(hdr), n.payload_len(), true))};
+        std::span<const node> c = n.children();
+        stack[depth++] = {c.data(), c.data() + c.size()};
+        break;
+      }
+      case node::kind::raw:
+        pending = n.raw_bytes();
+        break;
+      case node::kind::element: {
+        const RlpElement_t &e = *n.elem();
+        if(RLP_TYPE_IS_INTEGER_TYPE(e.type) || n.encoded_len() <= sizeof(hdr)) {
+          int ret = rlp_encode_element(hdr, sizeof(hdr), &e);
+          if(ret < 0)
+            co_return static_cast<error>(ret);
+          pending = {hdr, static_cast<std::size_t>(ret)};
+          break;
+        }
+        // Large byte array: header now, payload streamed straight from the element
+        pending = {hdr, static_cast<std::size_t>(rlp_encode_header(hdr, sizeof(hdr), e.len, false))};
+        while(detail::stream_fill(chunkBuffer, used, pending)) {
+          co_yield std::span<const std::uint8_t>(chunkBuffer);
+          used = 0;
+        }
+        pending = {static_cast<const std::uint8_t *>(e.buff), e.len};
+        break;
+      }
+    }
+    while(detail::stream_fill(chunkBuffer, used, pending)) {
+      co_yield std::span<const std::uint8_t>(chunkBuffer);
+      used = 0;
+    }
+  }
+  if(used)
+    co_yield std::span<const std::uint8_t>(chunkBuffer.data(), used);
+  co_return error::ok;
+}
+
+} // namespace rlp
+
+#endif
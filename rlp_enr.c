@@ -0,0 +1,283 @@
+/**
+ * RLP Serializer - Node Records (EIP-778)
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Fixed buffer encoder and zero-copy decoder for Ethereum Node Records.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_enr.h"
+#include "rlp_copy.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+// Keys compare bytewise, a key sorts before any longer key it prefixes
+static inline int rlp_enr_keycmp(const uint8_t *a, size_t aLen, const uint8_t *b, size_t bLen) {
+  int cmp = memcmp(a, b, aLen < bLen ? aLen : bLen);
+  if(cmp != 0)
+    return cmp;
+  return (aLen > bLen) - (aLen < bLen);
+}
+
+static inline uint8_t *rlp_enr_body(RlpEnr_t *enr) {
+  return enr->buff + RLP_ENR_BODY_OFFSET;
+}
+
+// Keys in the encoder buffer were written by us, decoding them cannot fail
+static inline RlpItem_t rlp_enr_key_at(const RlpEnr_t *enr, size_t i) {
+  RlpItem_t key;
+  const uint8_t *body = enr->buff + RLP_ENR_BODY_OFFSET;
+  rlp_decode_item(body + enr->pairOffs[i], enr->bodyLen - enr->pairOffs[i], &key);
+  return key;
+}
+
+// Returns the insertion index for key, or ERR_RLP_EINVAL if it is already present
+static int rlp_enr_find_slot(const RlpEnr_t *enr, const uint8_t *key, size_t keyLen) {
+  size_t lo = 0, hi = enr->pairsCnt;
+  // Fast path: keys usually arrive in order
+  if(hi == 0) 
+    return 0;
+  RlpItem_t last = rlp_enr_key_at(enr, hi - 1);
+  int cmp = rlp_enr_keycmp(key, keyLen, last.payload, last.payloadLen);
+  if(cmp > 0)
+    return hi;
+  if(cmp == 0)
+    return ERR_RLP_EINVAL;
+  hi--;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    RlpItem_t k = rlp_enr_key_at(enr, mid);
+    cmp = rlp_enr_keycmp(key, keyLen, k.payload, k.payloadLen);
+    if(cmp == 0)
+      return ERR_RLP_EINVAL;
+    if(cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+// Makes room for a pair of pairLen bytes at slot and returns where it goes
+static uint8_t *rlp_enr_insert(RlpEnr_t *enr, size_t slot, size_t pairLen) {
+  uint8_t *body = rlp_enr_body(enr);
+  uint16_t off = (slot == enr->pairsCnt) ? enr->bodyLen : enr->pairOffs[slot];
+  memmove(body + off + pairLen, body + off, enr->bodyLen - off);
+  for(size_t i = enr->pairsCnt; i > slot; i--)
+    enr->pairOffs[i] = enr->pairOffs[i - 1] + pairLen;
+  enr->pairOffs[slot] = off;
+  enr->pairsCnt++;
+  enr->bodyLen += pairLen;
+  return body + off;
+}
+
+static int rlp_enr_add(RlpEnr_t *enr, const void *key, size_t keyLen,
+                       const RlpElement_t *const value, const void *encodedValue, size_t encodedValueLen) {
+  if(enr == NULL || key == NULL || keyLen == 0)
+    return ERR_RLP_EBADARG;
+  RlpElement_t keyElement = RLP_ELEMENT_BYTEARRAY(key, keyLen);
+  size_t keyEncodedLen = rlp_element_encoded_len(&keyElement);
+  size_t valEncodedLen = value ? rlp_element_encoded_len(value) : encodedValueLen;
+  if(valEncodedLen == 0)
+    return ERR_RLP_EBADARG;
+  size_t pairLen = keyEncodedLen + valEncodedLen;
+  if(enr->bodyLen + pairLen > RLP_ENR_MAX_LEN || enr->pairsCnt == RLP_ENR_MAX_PAIRS)
+    return ERR_RLP_EMSGSIZE;
+
+  int slot = rlp_enr_find_slot(enr, key, keyLen);
+  if(slot < 0)
+    return slot;
+  uint8_t *out = rlp_enr_insert(enr, slot, pairLen);
+  rlp_encode_element(out, keyEncodedLen, &keyElement);
+  if(value)
+    rlp_encode_element(out + keyEncodedLen, valEncodedLen, value);
+  else
+    rlp_copy_payload(out + keyEncodedLen, encodedValue, encodedValueLen);
+  enr->recordLen = 0; // any finished record is stale now
+  return ERR_RLP_OK;
+}
+
+static void rlp_enr_hash_content(const uint8_t *body, size_t bodyLen, uint8_t hash[RLP_KECCAK256_LEN]) {
+  uint8_t hdr[9];
+  int hdrLen = rlp_encode_header(hdr, sizeof(hdr), bodyLen, true);
+  RlpKeccak_t ctx;
+  rlp_keccak256_init(&ctx);
+  rlp_keccak256_update(&ctx, hdr, hdrLen);
+  rlp_keccak256_update(&ctx, body, bodyLen);
+  rlp_keccak256_final(&ctx, hash);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_init(RlpEnr_t *enr, uint64_t seq)
+{
+  if(enr == NULL)
+    return ERR_RLP_EBADARG;
+  int ret = rlp_encode_uint64(rlp_enr_body(enr), RLP_ENR_MAX_LEN, seq);
+  if(ret < 0)
+    return ret;
+  enr->bodyLen = ret;
+  enr->pairsCnt = 0;
+  enr->recordOff = 0;
+  enr->recordLen = 0;
+  return ERR_RLP_OK;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_set(RlpEnr_t *enr, const void *key, size_t keyLen, const RlpElement_t *const value)
+{
+  if(value == NULL)
+    return ERR_RLP_EBADARG;
+  return rlp_enr_add(enr, key, keyLen, value, NULL, 0);
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_set_raw(RlpEnr_t *enr, const void *key, size_t keyLen, const void *encodedValue, size_t encodedValueLen)
+{
+  RlpItem_t item;
+  if(encodedValue == NULL || rlp_decode_item(encodedValue, encodedValueLen, &item) != (int) encodedValueLen)
+    return ERR_RLP_EBADARG; // must be exactly one item
+  return rlp_enr_add(enr, key, keyLen, NULL, encodedValue, encodedValueLen);
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_content_hash(const RlpEnr_t *enr, uint8_t hash[RLP_KECCAK256_LEN])
+{
+  if(enr == NULL || hash == NULL)
+    return ERR_RLP_EBADARG;
+  rlp_enr_hash_content(enr->buff + RLP_ENR_BODY_OFFSET, enr->bodyLen, hash);
+  return ERR_RLP_OK;
+}
+
+// Returns length of the record in bytes, or a negative error value
+int rlp_enr_finish(RlpEnr_t *enr, const void *sig, size_t sigLen, const uint8_t **record)
+{
+  if(enr == NULL || sig == NULL || record == NULL || sigLen == 0 || sigLen > RLP_ENR_MAX_SIG_LEN)
+    return ERR_RLP_EBADARG;
+  RlpElement_t sigElement = RLP_ELEMENT_BYTEARRAY(sig, sigLen);
+  size_t sigEncodedLen = rlp_element_encoded_len(&sigElement);
+  size_t payloadLen = sigEncodedLen + enr->bodyLen;
+  size_t hdrLen = rlp_header_len(payloadLen);
+  if(hdrLen + payloadLen > RLP_ENR_MAX_LEN)
+    return ERR_RLP_EMSGSIZE;
+
+  // Signature and header go right in front of the body, nothing is moved
+  uint8_t *sigOut = rlp_enr_body(enr) - sigEncodedLen;
+  rlp_encode_element(sigOut, sigEncodedLen, &sigElement);
+  rlp_encode_header(sigOut - hdrLen, hdrLen, payloadLen, true);
+  enr->recordOff = (sigOut - hdrLen) - enr->buff;
+  enr->recordLen = hdrLen + payloadLen;
+  *record = enr->buff + enr->recordOff;
+  return enr->recordLen;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_decode(const void *record, size_t recordLen, RlpEnrView_t *view)
+{
+  if(record == NULL || view == NULL)
+    return ERR_RLP_EBADARG;
+  if(recordLen > RLP_ENR_MAX_LEN)
+    return ERR_RLP_EMSGSIZE;
+
+  const uint8_t *base = (const uint8_t *) record;
+  RlpItem_t list, item;
+  RlpCursor_t cur;
+  int ret = rlp_decode_item(base, recordLen, &list);
+  if(ret < 0)
+    return ret;
+  if(ret != (int) recordLen || !list.isList)
+    return ERR_RLP_EINVAL;
+  rlp_cursor_init(&cur, &list);
+
+  // Signature
+  if((ret = rlp_cursor_next(&cur, &item)) <= 0 || item.isList)
+    return ret < 0 ? ret : ERR_RLP_EINVAL;
+  view->record = base;
+  view->recordLen = recordLen;
+  view->sigOff = item.payload - base;
+  view->sigLen = item.payloadLen;
+  view->contentOff = cur.pos - base;
+
+  // Sequence number
+  if((ret = rlp_cursor_next(&cur, &item)) <= 0)
+    return ret < 0 ? ret : ERR_RLP_EINVAL;
+  if((ret = rlp_decode_uint64(&item, &view->seq)) < 0)
+    return ret == ERR_RLP_EBADARG ? ERR_RLP_EINVAL : ret;
+
+  // Key/value pairs, keys strictly ascending
+  RlpItem_t key, prevKey = { .payload = NULL };
+  view->pairsCnt = 0;
+  while((ret = rlp_cursor_next(&cur, &key)) == 1) {
+    if(key.isList)
+      return ERR_RLP_EINVAL;
+    if(prevKey.payload && rlp_enr_keycmp(prevKey.payload, prevKey.payloadLen, key.payload, key.payloadLen) >= 0)
+      return ERR_RLP_EINVAL;
+    const uint8_t *valStart = cur.pos;
+    if((ret = rlp_cursor_next(&cur, &item)) <= 0)
+      return ret < 0 ? ret : ERR_RLP_EINVAL; // key without a value
+    RlpEnrPair_t *pair = &view->pairs[view->pairsCnt++];
+    pair->keyOff = key.payload - base;
+    pair->keyLen = key.payloadLen;
+    pair->valOff = valStart - base;
+    pair->valLen = item.encodedLen;
+    prevKey = key;
+  }
+  return ret < 0 ? ret : ERR_RLP_OK;
+}
+
+// Returns ERR_RLP_OK, ERR_RLP_ENOENT if the key is absent, or a negative error value
+int rlp_enr_get(const RlpEnrView_t *view, const void *key, size_t keyLen, RlpItem_t *value)
+{
+  if(view == NULL || key == NULL || value == NULL)
+    return ERR_RLP_EBADARG;
+  size_t lo = 0, hi = view->pairsCnt;
+  while(lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const RlpEnrPair_t *pair = &view->pairs[mid];
+    int cmp = rlp_enr_keycmp(key, keyLen, view->record + pair->keyOff, pair->keyLen);
+    if(cmp == 0)
+      return rlp_decode_item(view->record + pair->valOff, pair->valLen, value) < 0 ? ERR_RLP_EINVAL : ERR_RLP_OK;
+    if(cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return ERR_RLP_ENOENT;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_view_content_hash(const RlpEnrView_t *view, uint8_t hash[RLP_KECCAK256_LEN])
+{
+  if(view == NULL || hash == NULL)
+    return ERR_RLP_EBADARG;
+  rlp_enr_hash_content(view->record + view->contentOff, view->recordLen - view->contentOff, hash);
+  return ERR_RLP_OK;
+}
@@ -0,0 +1,120 @@
+/**
+ * RLP Serializer - Node Records (EIP-778)
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Fixed buffer encoder and zero-copy decoder for Ethereum Node Records.
+ * A record is rlp([signature, seq, k, v, ...]) with unique keys in sorted order,
+ * no larger than 300 bytes. Signing itself is left to the caller, only the
+ * content hash (keccak256 of rlp([seq, k, v, ...])) is computed here.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_ENR_H_
+#define __RLP_ENR_H_
+
+#include "rlp_serializer.h"
+#include "rlp_keccak.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_ENR_MAX_LEN       300
+#define RLP_ENR_MAX_SIG_LEN   64   // "v4" identity scheme: 64 byte r || s
+#define RLP_ENR_MAX_PAIRS     (RLP_ENR_MAX_LEN / 2) // every key and value takes at least one byte
+
+// Room in front of the body for the list header and the signature item, so the
+// finished record is assembled in place: 3 byte list header + 2 byte string header + signature
+#define RLP_ENR_BODY_OFFSET   (3 + 2 + RLP_ENR_MAX_SIG_LEN)
+
+// Encoder state, everything lives in the struct so no allocation is needed.
+// Pairs can be set in any order, keys set in ascending order take the append fast path.
+typedef struct rlpEnr {
+  uint8_t      buff[RLP_ENR_BODY_OFFSET + RLP_ENR_MAX_LEN];
+  uint16_t     bodyLen;                      // seq and pairs, starting at RLP_ENR_BODY_OFFSET
+  uint16_t     pairsCnt;
+  uint16_t     pairOffs[RLP_ENR_MAX_PAIRS];  // body offset of every key, in key order
+  uint16_t     recordOff;                    // set by rlp_enr_finish()
+  uint16_t     recordLen;
+} RlpEnr_t;
+
+// Offsets are relative to the start of the record
+typedef struct rlpEnrPair {
+  uint16_t     keyOff;     // key payload
+  uint16_t     keyLen;
+  uint16_t     valOff;     // encoded value item, header included
+  uint16_t     valLen;
+} RlpEnrPair_t;
+
+// Decoded record; references the encoded input and must not outlive it
+typedef struct rlpEnrView {
+  const uint8_t  *record;
+  uint16_t       recordLen;
+  uint16_t       sigOff;       // signature payload
+  uint16_t       sigLen;
+  uint16_t       contentOff;   // first byte of the encoded seq, content runs to the end of the record
+  uint64_t       seq;
+  uint16_t       pairsCnt;
+  RlpEnrPair_t   pairs[RLP_ENR_MAX_PAIRS];
+} RlpEnrView_t;
+
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_init(RlpEnr_t *enr, uint64_t seq);
+
+// Adds a string value, duplicate keys are rejected with ERR_RLP_EINVAL
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_set(RlpEnr_t *enr, const void *key, size_t keyLen, const RlpElement_t *const value);
+
+// Adds an already encoded value item (e.g. a list such as the "eth" entry)
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_set_raw(RlpEnr_t *enr, const void *key, size_t keyLen, const void *encodedValue, size_t encodedValueLen);
+
+// Hashes rlp([seq, k, v, ...]) straight from the encoder buffer, this is what gets signed
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_content_hash(const RlpEnr_t *enr, uint8_t hash[RLP_KECCAK256_LEN]);
+
+// Prepends the signature and list header in place, *record points into enr
+// Returns length of the record in bytes, or a negative error value
+int rlp_enr_finish(RlpEnr_t *enr, const void *sig, size_t sigLen, const uint8_t **record);
+
+// Decodes and validates a record: size limit, shape, canonical seq and key order
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_decode(const void *record, size_t recordLen, RlpEnrView_t *view);
+
+// Binary search for key, value receives the decoded value item
+// Returns ERR_RLP_OK, ERR_RLP_ENOENT if the key is absent, or a negative error value
+int rlp_enr_get(const RlpEnrView_t *view, const void *key, size_t keyLen, RlpItem_t *value);
+
+// Hashes the content of a decoded record for signature verification, without copying it
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_enr_view_content_hash(const RlpEnrView_t *view, uint8_t hash[RLP_KECCAK256_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * RLP Serializer - Keccak-256
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Ethereum's Keccak-256 (the original Keccak padding, not SHA3-256).
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_keccak.h"
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/*                             Internal Constants                             */
+/* -------------------------------------------------------------------------- */
+
+#define KECCAK256_RATE 136  // (1600 - 2 * 256) / 8
+
+static const uint64_t keccakRoundConstants[24] = {
+  0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+  0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+  0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+  0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+  0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+static const uint8_t keccakRotations[24] = {
+  1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44,
+};
+
+static const uint8_t keccakPiLanes[24] = {
+  10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1,
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+static inline uint64_t rotl64(uint64_t x, unsigned n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+// Lanes are little endian regardless of host order
+static inline uint64_t load64_le(const uint8_t *p) {
+  uint64_t v = 0;
+  for(int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static void keccakf1600(uint64_t st[25]) {
+  uint64_t bc[5];
+  for(int round = 0; round < 24; round++) {
+    // Theta
+    for(int i = 0; i < 5; i++)
+      bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+    for(int i = 0; i < 5; i++) {
+      uint64_t t = bc[(i + 4) % 5] ^ rotl64(bc[(i + 1) % 5], 1);
+      for(int j = 0; j < 25; j += 5)
+        st[j + i] ^= t;
+    }
+    // Rho and Pi
+    uint64_t t = st[1];
+    for(int i = 0; i < 24; i++) {
+      int j = keccakPiLanes[i];
+      uint64_t tmp = st[j];
+      st[j] = rotl64(t, keccakRotations[i]);
+      t = tmp;
+    }
+    // Chi
+    for(int j = 0; j < 25; j += 5) {
+      for(int i = 0; i < 5; i++)
+        bc[i] = st[j + i];
+      for(int i = 0; i < 5; i++)
+        st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+    }
+    // Iota
+    st[0] ^= keccakRoundConstants[round];
+  }
+}
+
+static inline void keccak_absorb_block(uint64_t st[25], const uint8_t *block) {
+  for(int i = 0; i < KECCAK256_RATE / 8; i++)
+    st[i] ^= load64_le(block + 8 * i);
+  keccakf1600(st);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+void rlp_keccak256_init(RlpKeccak_t *ctx)
+{
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+void rlp_keccak256_update(RlpKeccak_t *ctx, const void *data, size_t len)
+{
+  const uint8_t *in = (const uint8_t *) data;
+  if(ctx->queueLen) {
+    size_t take = KECCAK256_RATE - ctx->queueLen;
+    if(take > len)
+      take = len;
+    memcpy(ctx->queue + ctx->queueLen, in, take);
+    ctx->queueLen += take;
+    in += take;
+    len -= take;
+    if(ctx->queueLen < KECCAK256_RATE)
+      return;
+    keccak_absorb_block(ctx->state, ctx->queue);
+    ctx->queueLen = 0;
+  }
+  // Full blocks are absorbed straight from the input
+  for(; len >= KECCAK256_RATE; in += KECCAK256_RATE, len -= KECCAK256_RATE)
+    keccak_absorb_block(ctx->state, in);
+  memcpy(ctx->queue, in, len);
+  ctx->queueLen = len;
+}
+
+void rlp_keccak256_final(RlpKeccak_t *ctx, uint8_t hash[RLP_KECCAK256_LEN])
+{
+  // Keccak pad10*1 with the 0x01 domain byte (SHA3 would use 0x06)
+  memset(ctx->queue + ctx->queueLen, 0, KECCAK256_RATE - ctx->queueLen);
+  ctx->queue[ctx->queueLen] |= 0x01;
+  ctx->queue[KECCAK256_RATE - 1] |= 0x80;
+  keccak_absorb_block(ctx->state, ctx->queue);
+  for(int i = 0; i < RLP_KECCAK256_LEN; i++)
+    hash[i] = (uint8_t) (ctx->state[i / 8] >> (8 * (i % 8)));
+}
+
+void rlp_keccak256(const void *data, size_t len, uint8_t hash[RLP_KECCAK256_LEN])
+{
+  RlpKeccak_t ctx;
+  rlp_keccak256_init(&ctx);
+  rlp_keccak256_update(&ctx, data, len);
+  rlp_keccak256_final(&ctx, hash);
+}
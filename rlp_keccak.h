@@ -0,0 +1,63 @@
+/**
+ * RLP Serializer - Keccak-256
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Ethereum's Keccak-256 (the original Keccak padding, not SHA3-256).
+ * Incremental so encoders can hash headers and payloads in place without
+ * staging them in one buffer first.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_KECCAK_H_
+#define __RLP_KECCAK_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_KECCAK256_LEN   32
+
+typedef struct rlpKeccak {
+  uint64_t     state[25];
+  uint8_t      queue[136];   // absorbed bytes not yet forming a full block
+  size_t       queueLen;
+} RlpKeccak_t;
+
+void rlp_keccak256_init(RlpKeccak_t *ctx);
+void rlp_keccak256_update(RlpKeccak_t *ctx, const void *data, size_t len);
+void rlp_keccak256_final(RlpKeccak_t *ctx, uint8_t hash[RLP_KECCAK256_LEN]);
+
+// One shot convenience wrapper
+void rlp_keccak256(const void *data, size_t len, uint8_t hash[RLP_KECCAK256_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * RLP Serializer - C++ Compile-Time Literals
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * constexpr encoder for constant fragments: strings, byte arrays, unsigned integers
+ * and nested lists are encoded into a std::array<uint8_t, N> while compiling, so
+ * constant RLP costs nothing at runtime and cannot drift from the real encoding.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_LITERAL_HPP_
+#define __RLP_LITERAL_HPP_
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+namespace rlp::lit {
+
+/* -------------------------------------------------------------------------- */
+/*                                   Values                                   */
+/* -------------------------------------------------------------------------- */
+
+// Byte string of fixed length
+template <std::size_t N>
+struct bytes_t {
+  std::array<std::uint8_t, N> v;
+};
+
+template <class... Ts>
+struct list_t {
+  std::tuple<Ts...> v;
+};
+
+// "dog" -> 0x83 'd' 'o' 'g', the terminating NUL is dropped
+template <std::size_t N>
+constexpr bytes_t<N - 1> str(const char (&s)[N]) noexcept {
+  bytes_t<N - 1> b{};
+  for(std::size_t i = 0; i < N - 1; i++)
+    b.v[i] = static_cast<std::uint8_t>(s[i]);
+  return b;
+}
+
+template <std::size_t N>
+constexpr bytes_t<N> bytes(const std::array<std::uint8_t, N> &a) noexcept {
+  return {a};
+}
+
+template <std::integral... Bs>
+constexpr bytes_t<sizeof...(Bs)> bytes(Bs... b) noexcept {
+  return {{static_cast<std::uint8_t>(b)...}};
+}
+
+template <class... Ts>
+constexpr list_t<Ts...> list(const Ts &...children) noexcept {
+  return {{children...}};
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Encoding                                  */
+/* -------------------------------------------------------------------------- */
+
+namespace detail {
+
+template <class T>
+concept uint_value = std::unsigned_integral<T> && !std::same_as<T, bool>;
+
+constexpr std::size_t be_len(std::uint64_t v) noexcept {
+  std::size_t n = 0;
+  for(; v; v >>= 8)
+    n++;
+  return n;
+}
+
+constexpr std::size_t header_len(std::size_t payloadLen) noexcept {
+  return payloadLen <= 55 ? 1 : 1 + be_len(payloadLen);
+}
+
+template <std::size_t N>
+constexpr void put_be(std::array<std::uint8_t, N> &out, std::size_t &pos, std::uint64_t v, std::size_t len) noexcept {
+  for(std::size_t i = len; i-- > 0;)
+    out[pos++] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+template <std::size_t N>
+constexpr void put_header(std::array<std::uint8_t, N> &out, std::size_t &pos, std::size_t payloadLen, bool isList) noexcept {
+  std::uint8_t shortOff = isList ? 0xc0 : 0x80;
+  std::uint8_t longOff = isList ? 0xf7 : 0xb7;
+  if(payloadLen <= 55) {
+    out[pos++] = static_cast<std::uint8_t>(shortOff + payloadLen);
+  } else {
+    std::size_t lenLen = be_len(payloadLen);
+    out[pos++] = static_cast<std::uint8_t>(longOff + lenLen);
+    put_be(out, pos, payloadLen, lenLen);
+  }
+}
+
+} // namespace detail
+
+template <detail::uint_value T>
+constexpr std::size_t encoded_len(T v) noexcept {
+  return v < 0x80 && v != 0 ? 1 : 1 + detail::be_len(v);
+}
+
+template <std::size_t M>
+constexpr std::size_t encoded_len(const bytes_t<M> &b) noexcept {
+  if(M == 1 && b.v[0] < 0x80)
+    return 1;
+  return detail::header_len(M) + M;
+}
+
+template <class... Ts>
+constexpr std::size_t payload_len(const list_t<Ts...> &l) noexcept {
+  return std::apply([](const auto &...c) { return (std::size_t{0} + ... + encoded_len(c)); }, l.v);
+}
+
+template <class... Ts>
+constexpr std::size_t encoded_len(const list_t<Ts...> &l) noexcept {
+  std::size_t payloadLen = payload_len(l);
+  return detail::header_len(payloadLen) + payloadLen;
+}
+
+template <std::size_t N, detail::uint_value T>
+constexpr void write(std::array<std::uint8_t, N> &out, std::size_t &pos, T v) noexcept {
+  if(v < 0x80 && v != 0) {
+    out[pos++] = static_cast<std::uint8_t>(v);
+    return;
+  }
+  std::size_t len = detail::be_len(v);
+  out[pos++] = static_cast<std::uint8_t>(0x80 + len);
+  detail::put_be(out, pos, v, len);
+}
+
+template <std::size_t N, std::size_t M>
+constexpr void write(std::array<std::uint8_t, N> &out, std::size_t &pos, const bytes_t<M> &b) noexcept {
+  if(!(M == 1 && b.v[0] < 0x80))
+    detail::put_header(out, pos, M, false);
+  for(std::uint8_t c : b.v)
+    out[pos++] = c;
+}
+
+template <std::size_t N, class... Ts>
+constexpr void write(std::array<std::uint8_t, N> &out, std::size_t &pos, const list_t<Ts...> &l) noexcept {
+  detail::put_header(out, pos, payload_len(l), true);
+  std::apply([&](const auto &...c) { (write(out, pos, c), ...); }, l.v);
+}
+
+// N must equal encoded_len(value); RLP_LITERAL() fills it in
+template <std::size_t N, class T>
+constexpr std::array<std::uint8_t, N> encode(const T &value) noexcept {
+  std::array<std::uint8_t, N> out{};
+  std::size_t pos = 0;
+  write(out, pos, value);
+  return out;
+}
+
+} // namespace rlp::lit
+
+// constexpr auto kEmptyList = RLP_LITERAL(rlp::lit::list());   // {0xc0}
+#define RLP_LITERAL(...) (::rlp::lit::encode<::rlp::lit::encoded_len(__VA_ARGS__)>(__VA_ARGS__))
+
+#endif
@@ -0,0 +1,326 @@
+/**
+ * RLP Serializer - Node Store
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Content addressed store for encoded trie nodes. Nodes are keyed by the Keccak-256
+ * of their encoding, appended to an mmap backed log and found through an in-memory
+ * open addressing index; duplicates cost one lookup and reads are zero copy.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_nodestore.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RLP_NODE_STORE_MAGIC  "RLPNODE1"
+
+#if defined(__GNUC__)
+#define RLP_STORE_PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define RLP_STORE_PREFETCH(addr)
+#endif
+
+typedef struct {
+  char       magic[8];
+  uint64_t   len;         // committed end of the log, native byte order
+} RlpNodeStoreHdr_t;
+
+static inline RlpNodeStoreHdr_t *rlp_node_store_hdr(const RlpNodeStore_t *s) {
+  return (RlpNodeStoreHdr_t *) s->base;
+}
+
+static inline uint64_t rlp_node_store_tag(const uint8_t *key) {
+  uint64_t tag;
+  memcpy(&tag, key, sizeof(tag));
+  return tag;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Index                                   */
+/* -------------------------------------------------------------------------- */
+
+// Slot holding key, or the empty slot where it would go
+static size_t rlp_node_store_find(const RlpNodeStore_t *s, const uint8_t *key, bool *found) {
+  uint64_t tag = rlp_node_store_tag(key);
+  size_t mask = s->slotsCap - 1;
+  for(size_t i = tag & mask;; i = (i + 1) & mask) {
+    const RlpNodeStoreSlot_t *slot = &s->slots[i];
+    if(slot->off == 0) {
+      *found = false;
+      return i;
+    }
+    if(slot->tag == tag && memcmp(s->base + slot->off, key, RLP_KECCAK256_LEN) == 0) {
+      *found = true;
+      return i;
+    }
+  }
+}
+
+// Makes room for n more nodes below a 3/4 load factor
+static int rlp_node_store_reserve_slots(RlpNodeStore_t *s, size_t n) {
+  size_t cap = s->slotsCap ? s->slotsCap : 1024;
+  while((s->nodesCnt + n) * 4 > cap * 3)
+    cap *= 2;
+  if(cap == s->slotsCap)
+    return ERR_RLP_OK;
+  RlpNodeStoreSlot_t *slots = calloc(cap, sizeof(*slots));
+  if(slots == NULL)
+    return ERR_RLP_ENOMEM;
+  for(size_t i = 0; i < s->slotsCap; i++) {
+    if(s->slots[i].off == 0)
+      continue;
+    size_t j = s->slots[i].tag & (cap - 1);
+    while(slots[j].off)
+      j = (j + 1) & (cap - 1);
+    slots[j] = s->slots[i];
+  }
+  free(s->slots);
+  s->slots = slots;
+  s->slotsCap = cap;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                     Log                                    */
+/* -------------------------------------------------------------------------- */
+
+// Grows the file and its mapping in place to hold at least len bytes
+static int rlp_node_store_grow(RlpNodeStore_t *s, size_t len) {
+  if(len <= s->mappedLen)
+    return ERR_RLP_OK;
+  size_t newLen = (len + RLP_NODE_STORE_GROW - 1) / RLP_NODE_STORE_GROW * RLP_NODE_STORE_GROW;
+  if(newLen > s->maxSize)
+    return ERR_RLP_ENOMEM;
+  if(ftruncate(s->fd, newLen) < 0)
+    return ERR_RLP_EIO;
+  void *p = mmap(s->base + s->mappedLen, newLen - s->mappedLen, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_FIXED, s->fd, s->mappedLen);
+  if(p == MAP_FAILED)
+    return ERR_RLP_EIO;
+  s->mappedLen = newLen;
+  return ERR_RLP_OK;
+}
+
+static int rlp_node_store_sync(const RlpNodeStore_t *s, size_t from, size_t to) {
+  if(s->flags & RLP_NODE_STORE_NOSYNC)
+    return ERR_RLP_OK;
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  from &= ~(page - 1);
+  return msync(s->base + from, to - from, MS_SYNC) < 0 ? ERR_RLP_EIO : ERR_RLP_OK;
+}
+
+// Indexes every committed record
+static int rlp_node_store_load(RlpNodeStore_t *s) {
+  size_t off = RLP_NODE_STORE_HDR_LEN, cnt = 0;
+  while(off < s->len) {
+    RlpItem_t node;
+    if(s->len - off < RLP_KECCAK256_LEN ||
+       rlp_decode_item(s->base + off + RLP_KECCAK256_LEN, s->len - off - RLP_KECCAK256_LEN, &node) < 0)
+      return ERR_RLP_EINVAL;
+    cnt++;
+    off += RLP_KECCAK256_LEN + node.encodedLen;
+  }
+  int err = rlp_node_store_reserve_slots(s, cnt);
+  if(err < 0)
+    return err;
+  for(off = RLP_NODE_STORE_HDR_LEN; off < s->len;) {
+    RlpItem_t node;
+    bool found;
+    const uint8_t *key = s->base + off;
+    rlp_decode_item(key + RLP_KECCAK256_LEN, s->len - off - RLP_KECCAK256_LEN, &node);
+    size_t i = rlp_node_store_find(s, key, &found);
+    if(!found) {
+      s->slots[i] = (RlpNodeStoreSlot_t) { .tag = rlp_node_store_tag(key), .off = off };
+      s->nodesCnt++;
+    }
+    off += RLP_KECCAK256_LEN + node.encodedLen;
+  }
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_node_store_open(RlpNodeStore_t *s, const char *path, size_t maxSize, unsigned flags)
+{
+  if(s == NULL || path == NULL)
+    return ERR_RLP_EBADARG;
+  memset(s, 0, sizeof(*s));
+  s->fd = -1;
+  s->flags = flags;
+  s->maxSize = maxSize ? maxSize : RLP_NODE_STORE_DEFAULT_MAX;
+  if(s->maxSize < RLP_NODE_STORE_GROW)
+    return ERR_RLP_EBADARG;
+
+  int err = ERR_RLP_EIO;
+  struct stat st;
+  s->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if(s->fd < 0 || fstat(s->fd, &st) < 0)
+    goto fail;
+  // Reserve the whole range up front so the mapping never moves as the log grows
+  s->base = mmap(NULL, s->maxSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(s->base == MAP_FAILED) {
+    s->base = NULL;
+    err = ERR_RLP_ENOMEM;
+    goto fail;
+  }
+
+  bool fresh = st.st_size == 0;
+  if(!fresh && (st.st_size % RLP_NODE_STORE_GROW || (size_t) st.st_size > s->maxSize)) {
+    err = ERR_RLP_EINVAL;
+    goto fail;
+  }
+  s->mappedLen = 0;
+  if((err = rlp_node_store_grow(s, fresh ? RLP_NODE_STORE_HDR_LEN : (size_t) st.st_size)) < 0)
+    goto fail;
+
+  RlpNodeStoreHdr_t *hdr = rlp_node_store_hdr(s);
+  if(fresh) {
+    memcpy(hdr->magic, RLP_NODE_STORE_MAGIC, sizeof(hdr->magic));
+    hdr->len = RLP_NODE_STORE_HDR_LEN;
+    if((err = rlp_node_store_sync(s, 0, RLP_NODE_STORE_HDR_LEN)) < 0)
+      goto fail;
+  } else if(memcmp(hdr->magic, RLP_NODE_STORE_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->len < RLP_NODE_STORE_HDR_LEN || hdr->len > s->mappedLen) {
+    err = ERR_RLP_EINVAL;
+    goto fail;
+  }
+  s->len = hdr->len;
+
+  if((err = rlp_node_store_reserve_slots(s, 0)) < 0 || (err = rlp_node_store_load(s)) < 0)
+    goto fail;
+  return ERR_RLP_OK;
+
+fail:
+  rlp_node_store_close(s);
+  return err;
+}
+
+void rlp_node_store_close(RlpNodeStore_t *s)
+{
+  if(s == NULL)
+    return;
+  if(s->base)
+    munmap(s->base, s->maxSize);
+  if(s->fd >= 0)
+    close(s->fd);
+  free(s->slots);
+  memset(s, 0, sizeof(*s));
+  s->fd = -1;
+}
+
+int rlp_node_store_get(const RlpNodeStore_t *s, const uint8_t key[RLP_KECCAK256_LEN], RlpItem_t *node)
+{
+  if(s == NULL || s->slots == NULL || key == NULL || node == NULL)
+    return ERR_RLP_EBADARG;
+  bool found;
+  size_t i = rlp_node_store_find(s, key, &found);
+  if(!found)
+    return ERR_RLP_ENOENT;
+  size_t off = s->slots[i].off + RLP_KECCAK256_LEN;
+  return rlp_decode_item(s->base + off, s->len - off, node) < 0 ? ERR_RLP_EINVAL : ERR_RLP_OK;
+}
+
+void rlp_node_store_prefetch(const RlpNodeStore_t *s, const uint8_t key[RLP_KECCAK256_LEN], bool fromDisk)
+{
+  if(s == NULL || s->slots == NULL || key == NULL)
+    return;
+  // Tags only: comparing full keys would fault the record in synchronously
+  uint64_t tag = rlp_node_store_tag(key);
+  size_t mask = s->slotsCap - 1;
+  for(size_t i = tag & mask; s->slots[i].off; i = (i + 1) & mask) {
+    if(s->slots[i].tag != tag)
+      continue;
+    const uint8_t *rec = s->base + s->slots[i].off;
+    if(fromDisk) {
+      size_t page = (size_t) sysconf(_SC_PAGESIZE);
+      uintptr_t start = (uintptr_t) rec & ~(page - 1);
+      // Most nodes are under 600 bytes, take the next page too when the record starts near the end
+      size_t len = (uintptr_t) rec + 1024 > start + page ? 2 * page : page;
+      madvise((void *) start, len, MADV_WILLNEED);
+    }
+    RLP_STORE_PREFETCH(rec);
+    RLP_STORE_PREFETCH(rec + 64);
+  }
+}
+
+int rlp_node_store_put_batch(RlpNodeStore_t *s, const RlpGatherSeg_t *nodes, size_t nodesCnt,
+                             uint8_t (*keys)[RLP_KECCAK256_LEN])
+{
+  if(s == NULL || s->slots == NULL || (nodes == NULL && nodesCnt != 0))
+    return ERR_RLP_EBADARG;
+  if(nodesCnt > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+
+  // Validate and size up front so nothing can fail once records are being written
+  size_t worstLen = 0;
+  for(size_t i = 0; i < nodesCnt; i++) {
+    RlpItem_t item;
+    if(rlp_decode_item(nodes[i].buff, nodes[i].len, &item) < 0 || item.encodedLen != nodes[i].len)
+      return ERR_RLP_EINVAL;
+    worstLen += RLP_KECCAK256_LEN + nodes[i].len;
+  }
+  int err = rlp_node_store_reserve_slots(s, nodesCnt);
+  if(err < 0 || (err = rlp_node_store_grow(s, s->len + worstLen)) < 0)
+    return err;
+
+  size_t end = s->len;
+  int added = 0;
+  for(size_t i = 0; i < nodesCnt; i++) {
+    uint8_t key[RLP_KECCAK256_LEN];
+    bool found;
+    rlp_keccak256(nodes[i].buff, nodes[i].len, key);
+    if(keys)
+      memcpy(keys[i], key, sizeof(key));
+    // Records of this batch are indexed as they are written, so in-batch duplicates are caught too
+    size_t slot = rlp_node_store_find(s, key, &found);
+    if(found)
+      continue;
+    memcpy(s->base + end, key, sizeof(key));
+    memcpy(s->base + end + sizeof(key), nodes[i].buff, nodes[i].len);
+    s->slots[slot] = (RlpNodeStoreSlot_t) { .tag = rlp_node_store_tag(key), .off = end };
+    s->nodesCnt++;
+    end += sizeof(key) + nodes[i].len;
+    added++;
+  }
+  if(end == s->len)
+    return 0;
+
+  // Records reach the disk before the header that publishes them. They are readable
+  // right away; if a sync fails they are just not durable until a later commit.
+  size_t start = s->len;
+  s->len = end;
+  if((err = rlp_node_store_sync(s, start, end)) < 0)
+    return err;
+  rlp_node_store_hdr(s)->len = end;
+  if((err = rlp_node_store_sync(s, 0, sizeof(RlpNodeStoreHdr_t))) < 0)
+    return err;
+  return added;
+}
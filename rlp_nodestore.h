@@ -0,0 +1,104 @@
+/**
+ * RLP Serializer - Node Store
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Content addressed store for encoded trie nodes. Nodes are keyed by the Keccak-256
+ * of their encoding, appended to an mmap backed log and found through an in-memory
+ * open addressing index; duplicates cost one lookup and reads are zero copy.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_NODESTORE_H_
+#define __RLP_NODESTORE_H_
+
+#include "rlp_serializer.h"
+#include "rlp_keccak.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_NODE_STORE_NOSYNC       0x1             // skip msync() on commit, for scratch stores
+#define RLP_NODE_STORE_HDR_LEN      4096            // log header: magic and committed length
+#define RLP_NODE_STORE_GROW         (64u << 20)     // file growth step
+#define RLP_NODE_STORE_DEFAULT_MAX  (1ull << 40)    // address space reserved when maxSize is 0
+
+// Log layout: header page, then records of key[32] followed by the node's RLP item.
+// Records past the committed length in the header are ignored on open, so a crash
+// mid-commit loses that commit and nothing else.
+typedef struct rlpNodeStoreSlot {
+  uint64_t     tag;       // first 8 bytes of the key
+  uint64_t     off;       // record offset in the log, 0 for an empty slot
+} RlpNodeStoreSlot_t;
+
+// One writer; any number of readers while no write is in progress
+typedef struct rlpNodeStore {
+  int                 fd;
+  unsigned            flags;
+  uint8_t             *base;      // maxSize bytes reserved, the file is mapped at the start
+  size_t              maxSize;
+  size_t              mappedLen;  // file size, a multiple of RLP_NODE_STORE_GROW
+  size_t              len;        // committed end of the log
+  RlpNodeStoreSlot_t  *slots;
+  size_t              slotsCap;   // power of two
+  size_t              nodesCnt;
+} RlpNodeStore_t;
+
+// Opens or creates the log at path and rebuilds the index from it. The log can grow
+// up to maxSize bytes (0 for RLP_NODE_STORE_DEFAULT_MAX) without ever moving, so
+// views returned by rlp_node_store_get() stay valid until close.
+// Returns 0 on success, or a negative error value
+int rlp_node_store_open(RlpNodeStore_t *s, const char *path, size_t maxSize, unsigned flags);
+
+void rlp_node_store_close(RlpNodeStore_t *s);
+
+// Looks a node up by key; node is a view into the mapped log
+// Returns 0 on success, ERR_RLP_ENOENT if absent, or a negative error value
+int rlp_node_store_get(const RlpNodeStore_t *s, const uint8_t key[RLP_KECCAK256_LEN], RlpItem_t *node);
+
+// Starts bringing the record for key into memory without touching the log. fromDisk
+// also asks the kernel to read its page in if it is not resident (madvise WILLNEED).
+void rlp_node_store_prefetch(const RlpNodeStore_t *s, const uint8_t key[RLP_KECCAK256_LEN], bool fromDisk);
+
+// Appends every node not yet stored as one commit: one grow, one copy each, one sync.
+// Each node must be exactly one encoded item. keys, if not NULL, receives every node's key.
+// Returns the number of nodes added (duplicates are skipped), or a negative error value
+int rlp_node_store_put_batch(RlpNodeStore_t *s, const RlpGatherSeg_t *nodes, size_t nodesCnt,
+                             uint8_t (*keys)[RLP_KECCAK256_LEN]);
+
+// Single node commit, see rlp_node_store_put_batch()
+// Returns 1 if added, 0 if already stored, or a negative error value
+static inline int rlp_node_store_put(RlpNodeStore_t *s, const void *encoded, size_t len,
+                                     uint8_t key[RLP_KECCAK256_LEN]) {
+  RlpGatherSeg_t node = { encoded, len };
+  return rlp_node_store_put_batch(s, &node, 1, (uint8_t (*)[RLP_KECCAK256_LEN]) key);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
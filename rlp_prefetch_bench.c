@@ -0,0 +1,157 @@
+/**
+ * RLP Serializer - Prefetch Benchmark
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Times rlp_encode_list() on a long list whose descriptors and payloads are scattered
+ * over a large heap with every cache level flushed, next to the same encode on a short
+ * list that stays in cache. The prefetch distance is fixed at compile time, so build
+ * once per distance:
+ *   for d in 0 16 32 64 128; do
+ *     cc -O2 -DRLP_PREFETCH_DISTANCE=$d rlp_prefetch_bench.c -o pf && ./pf
+ *   done
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define RLP_STATIC
+#include "rlp_single.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_ELEMENTS    (1u << 20)
+#define BENCH_SLOT        64            // descriptors and payloads each get a cache line
+#define BENCH_PERM        0x9e3779b1u   // odd, so slot k * BENCH_PERM never repeats
+#define BENCH_WARM        4096          // elements in the warm list, well inside L2
+#define BENCH_WARM_REPS   256
+
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Evicts the list from every cache level; without clflush, walks a buffer larger than the caches
+static void bench_flush(const RlpElement_t *const *elems, size_t n, uint8_t *evict, size_t evictLen) {
+#if defined(__SSE2__)
+  (void) evict;
+  (void) evictLen;
+  for(size_t i = 0; i < n; i++) {
+    _mm_clflush(elems[i]->buff);
+    _mm_clflush(elems[i]);
+  }
+  for(size_t i = 0; i < n * sizeof(*elems); i += BENCH_SLOT)
+    _mm_clflush((const uint8_t *) elems + i);
+  _mm_mfence();
+#else
+  (void) elems;
+  (void) n;
+  for(size_t i = 0; i < evictLen; i += BENCH_SLOT)
+    evict[i]++;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+  size_t heapLen = (argc > 1 ? strtoull(argv[1], NULL, 10) : 512) << 20;
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  size_t slots = heapLen / BENCH_SLOT;
+  if(rounds <= 0 || slots < 2 * BENCH_ELEMENTS || (slots & (slots - 1))) {
+    fprintf(stderr, "usage: %s [heap MB, a power of two >= 128] [rounds]\n", argv[0]);
+    return 1;
+  }
+
+  uint8_t *heap = aligned_alloc(BENCH_SLOT, heapLen);
+  const RlpElement_t **elems = malloc(BENCH_ELEMENTS * sizeof(*elems));
+  size_t outLen = BENCH_ELEMENTS * 40 + 16;
+  uint8_t *out = malloc(outLen);
+#if defined(__SSE2__)
+  uint8_t *evict = NULL;
+  size_t evictLen = 0;
+#else
+  size_t evictLen = 1u << 30;
+  uint8_t *evict = calloc(1, evictLen);
+#endif
+  if(!heap || !elems || !out || (evictLen && !evict))
+    return 1;
+
+  // Descriptor i and payload i land on unrelated lines anywhere in the heap
+  static const size_t sizes[] = { 8, 20, 32, 32 };   // integer, address, hashes
+  for(size_t i = 0; i < BENCH_ELEMENTS; i++) {
+    RlpElement_t *e = (RlpElement_t *) (heap + ((2 * i * BENCH_PERM) & (slots - 1)) * BENCH_SLOT);
+    uint8_t *payload = heap + ((2 * i + 1) * BENCH_PERM & (slots - 1)) * BENCH_SLOT;
+    size_t len = sizes[rng() % 4];
+    for(size_t b = 0; b < len; b++)
+      payload[b] = (uint8_t) rng();
+    *e = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = len, .buff = payload };
+    elems[i] = e;
+  }
+
+  double cold = 0, warm = 0;
+  for(int r = 0; r < rounds; r++) {
+    bench_flush(elems, BENCH_ELEMENTS, evict, evictLen);
+    double t0 = now_ns();
+    int len = rlp_encode_list(out, outLen, elems, BENCH_ELEMENTS);
+    double t1 = now_ns();
+    for(int w = 0; w < BENCH_WARM_REPS && len >= 0; w++)
+      len = rlp_encode_list(out, outLen, elems, BENCH_WARM);
+    double t2 = now_ns();
+    if(len < 0) {
+      fprintf(stderr, "encode error %d\n", len);
+      return 1;
+    }
+    if(r == 0 || t1 - t0 < cold)
+      cold = t1 - t0;
+    if(r == 0 || (t2 - t1) / BENCH_WARM_REPS < warm)
+      warm = (t2 - t1) / BENCH_WARM_REPS;
+  }
+
+  printf("distance %3d: cold %6.1f ns/element, warm %5.1f ns/element (%u elements over %zu MB, best of %d)\n",
+         RLP_PREFETCH_DISTANCE, cold / BENCH_ELEMENTS, warm / BENCH_WARM, BENCH_ELEMENTS, heapLen >> 20, rounds);
+  free(evict);
+  free(out);
+  free(elems);
+  free(heap);
+  return 0;
+}
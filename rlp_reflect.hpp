@@ -0,0 +1,328 @@
+/**
+ * RLP Serializer - C++ Struct Reflection
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Encodes plain aggregate structs as RLP lists without building RlpElement_t arrays.
+ * Fields are visited through structured bindings (field count found the way
+ * Boost.PFR does) or listed with RLP_FIELDS(); all of it inlines into the caller.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_REFLECT_HPP_
+#define __RLP_REFLECT_HPP_
+
+#include "rlp_serializer.hpp"
+
+#include <array>
+#include <concepts>
+#include <cstring>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Lists the fields to encode, in order; takes precedence over structured bindings
+// and works for classes that are not aggregates:
+//   struct Log { ...; RLP_FIELDS(address, topics, data) };
+#define RLP_FIELDS(...) \
+  auto rlp_fields() const noexcept { return std::tie(__VA_ARGS__); }
+
+// Most fields an aggregate without RLP_FIELDS() may have
+#define RLP_REFLECT_MAX_FIELDS 16
+
+/**
+ * Field mapping:
+ *   unsigned integers and bool        integer, leading zeroes trimmed
+ *   std::array<uint8_t, N>            byte array of exactly N bytes
+ *   contiguous ranges of bytes/chars  byte array (vector<uint8_t>, string, span, ...)
+ *   other ranges                      list of their elements
+ *   aggregates / RLP_FIELDS() classes list of their fields
+ */
+namespace rlp::reflect {
+
+namespace detail {
+
+/* -------------------------------------------------------------------------- */
+/*                                   Fields                                   */
+/* -------------------------------------------------------------------------- */
+
+struct any_field {
+  template <class T>
+  constexpr operator T &() const && noexcept;
+};
+
+template <class T, class... A>
+constexpr std::size_t field_count() noexcept {
+  if constexpr(requires { T{std::declval<A>()..., any_field{}}; })
+    return field_count<T, A..., any_field>();
+  else
+    return sizeof...(A);
+}
+
+template <class T>
+concept has_rlp_fields = requires(const T &v) { v.rlp_fields(); };
+
+template <class T>
+concept integer = std::unsigned_integral<T> && sizeof(T) <= sizeof(std::uint64_t);
+
+template <class T>
+concept byte_like = sizeof(T) == 1 && (std::integral<T> || std::same_as<T, std::byte>);
+
+template <class T>
+concept byte_string = std::ranges::contiguous_range<const T> &&
+                      byte_like<std::remove_cv_t<std::ranges::range_value_t<const T>>>;
+
+template <class T>
+concept list_range = std::ranges::range<const T> && !byte_string<T>;
+
+template <class T>
+concept record = std::is_class_v<T> && !std::ranges::range<const T> &&
+                 (has_rlp_fields<T> || std::is_aggregate_v<T>);
+
+// Binds the fields of an aggregate and calls f with them
+template <class T, class F>
+constexpr decltype(auto) visit_aggregate(const T &v, F &&f) {
+  constexpr std::size_t N = field_count<T>();
+  if constexpr(N == 0) {
+    return f();
+  } else if constexpr(N == 1) {
+    auto &[f0] = v;
+    return f(f0);
+  } else if constexpr(N == 2) {
+    auto &[f0, f1] = v;
+    return f(f0, f1);
+  } else if constexpr(N == 3) {
+    auto &[f0, f1, f2] = v;
+    return f(f0, f1, f2);
+  } else if constexpr(N == 4) {
+    auto &[f0, f1, f2, f3] = v;
+    return f(f0, f1, f2, f3);
+  } else if constexpr(N == 5) {
+    auto &[f0, f1, f2, f3, f4] = v;
+    return f(f0, f1, f2, f3, f4);
+  } else if constexpr(N == 6) {
+    auto &[f0, f1, f2, f3, f4, f5] = v;
+    return f(f0, f1, f2, f3, f4, f5);
+  } else if constexpr(N == 7) {
+    auto &[f0, f1, f2, f3, f4, f5, f6] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6);
+  } else if constexpr(N == 8) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7);
+  } else if constexpr(N == 9) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+  } else if constexpr(N == 10) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+  } else if constexpr(N == 11) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+  } else if constexpr(N == 12) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+  } else if constexpr(N == 13) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+  } else if constexpr(N == 14) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+  } else if constexpr(N == 15) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+  } else if constexpr(N == 16) {
+    auto &[f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = v;
+    return f(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+  } else {
+    static_assert(N <= RLP_REFLECT_MAX_FIELDS, "too many fields, use RLP_FIELDS()");
+  }
+}
+
+// Calls f with every field of v
+template <class T, class F>
+constexpr decltype(auto) visit_fields(const T &v, F &&f) {
+  if constexpr(has_rlp_fields<T>)
+    return std::apply(f, v.rlp_fields());
+  else
+    return visit_aggregate(v, f);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Sizing                                   */
+/* -------------------------------------------------------------------------- */
+
+constexpr std::size_t be_len(std::uint64_t v) noexcept {
+  std::size_t n = 0;
+  for(; v; v >>= 8)
+    n++;
+  return n;
+}
+
+constexpr std::size_t header_len(std::size_t payloadLen) noexcept {
+  return payloadLen <= 55 ? 1 : 1 + be_len(payloadLen);
+}
+
+template <class T>
+constexpr std::size_t encoded_len(const T &v) noexcept;
+
+template <class T>
+constexpr std::size_t payload_len(const T &v) noexcept {
+  if constexpr(list_range<T>) {
+    std::size_t len = 0;
+    for(const auto &e : v)
+      len += detail::encoded_len(e);
+    return len;
+  } else {
+    static_assert(record<T>, "no RLP mapping for this field type");
+    return visit_fields(v, [](const auto &...f) { return (std::size_t{0} + ... + detail::encoded_len(f)); });
+  }
+}
+
+template <class T>
+constexpr std::size_t encoded_len(const T &v) noexcept {
+  if constexpr(integer<T>) {
+    std::uint64_t x = v;
+    return x < 0x80 && x != 0 ? 1 : 1 + be_len(x);
+  } else if constexpr(byte_string<T>) {
+    std::size_t n = std::ranges::size(v);
+    if(n == 1 && static_cast<std::uint8_t>(*std::ranges::data(v)) < 0x80)
+      return 1;
+    return header_len(n) + n;
+  } else {
+    std::size_t payloadLen = payload_len(v);
+    return header_len(payloadLen) + payloadLen;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Writing                                  */
+/* -------------------------------------------------------------------------- */
+
+constexpr std::uint8_t *put_be(std::uint8_t *p, std::uint64_t v, std::size_t len) noexcept {
+  for(std::size_t i = len; i-- > 0;)
+    *p++ = static_cast<std::uint8_t>(v >> (8 * i));
+  return p;
+}
+
+constexpr std::uint8_t *put_header(std::uint8_t *p, std::size_t payloadLen, bool isList) noexcept {
+  if(payloadLen <= 55) {
+    *p++ = static_cast<std::uint8_t>((isList ? 0xc0 : 0x80) + payloadLen);
+    return p;
+  }
+  std::size_t lenLen = be_len(payloadLen);
+  *p++ = static_cast<std::uint8_t>((isList ? 0xf7 : 0xb7) + lenLen);
+  return put_be(p, payloadLen, lenLen);
+}
+
+constexpr std::uint8_t *put_header_back(std::uint8_t *end, std::size_t payloadLen, bool isList) noexcept {
+  std::uint8_t *p = end - header_len(payloadLen);
+  put_header(p, payloadLen, isList);
+  return p;
+}
+
+// Writes v so that it ends at end and returns where it starts. Going backwards, a list's
+// children are written before its header, so its payload length is known without sizing
+// the subtree again; only the top level encode() sizes everything, once.
+// Caller guarantees room for encoded_len(v) bytes before end.
+template <class T>
+std::uint8_t *write_back(std::uint8_t *end, const T &v) noexcept {
+  if constexpr(integer<T>) {
+    std::uint64_t x = v;
+    if(x < 0x80 && x != 0) {
+      *--end = static_cast<std::uint8_t>(x);
+      return end;
+    }
+    std::size_t len = be_len(x);
+    std::uint8_t *p = end - 1 - len;
+    *p = static_cast<std::uint8_t>(0x80 + len);
+    put_be(p + 1, x, len);
+    return p;
+  } else if constexpr(byte_string<T>) {
+    std::size_t n = std::ranges::size(v);
+    const auto *src = reinterpret_cast<const std::uint8_t *>(std::ranges::data(v));
+    std::uint8_t *p = end - n;
+    if(n)
+      std::memcpy(p, src, n);
+    return n == 1 && src[0] < 0x80 ? p : put_header_back(p, n, false);
+  } else if constexpr(list_range<T>) {
+    std::uint8_t *p = end;
+    if constexpr(std::ranges::bidirectional_range<const T>) {
+      auto first = std::ranges::begin(v);
+      for(auto it = std::ranges::next(first, std::ranges::end(v)); it != first;)
+        p = detail::write_back(p, *--it);
+    } else {
+      // Forward only: size this level once and write each child into its slot
+      p = end - payload_len(v);
+      for(std::uint8_t *q = p; const auto &e : v) {
+        q += detail::encoded_len(e);
+        detail::write_back(q, e);
+      }
+    }
+    return put_header_back(p, static_cast<std::size_t>(end - p), true);
+  } else {
+    std::uint8_t *p = end;
+    visit_fields(v, [&p](const auto &...f) {
+      auto fields = std::forward_as_tuple(f...);
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((p = detail::write_back(p, std::get<sizeof...(I) - 1 - I>(fields))), ...);
+      }(std::index_sequence_for<decltype(f)...>{});
+    });
+    return put_header_back(p, static_cast<std::size_t>(end - p), true);
+  }
+}
+
+} // namespace detail
+
+/* -------------------------------------------------------------------------- */
+/*                                  Encoding                                  */
+/* -------------------------------------------------------------------------- */
+
+template <class T>
+constexpr std::size_t encoded_len(const T &v) noexcept {
+  return detail::encoded_len(v);
+}
+
+template <class T>
+result<std::size_t> encode(std::span<std::uint8_t> out, const T &v) noexcept {
+  std::size_t len = detail::encoded_len(v);
+  if(out.size() < len)
+    return error::msg_size;
+  detail::write_back(out.data() + len, v);
+  return len;
+}
+
+// Allocates exactly the encoded size from mr and encodes into it
+template <class T>
+result<buffer> encode(const T &v, std::pmr::memory_resource *mr = std::pmr::get_default_resource()) {
+  std::size_t len = detail::encoded_len(v);
+  buffer out(len, mr);
+  detail::write_back(out.data() + len, v);
+  return out;
+}
+
+} // namespace rlp::reflect
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * RLP Serializer - Ropes
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Immutable, reference counted, pre-encoded subtrees. Parents share children
+ * instead of copying their bytes; bytes are laid out contiguously only when
+ * asked for, through gather output or a flatten.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_rope.h"
+#include "rlp_copy.h"
+#include <stdatomic.h>
+#include <string.h>
+
+struct rlpRope {
+  atomic_size_t refs;
+  size_t        encodedLen;
+  size_t        segsCnt;      // header plus every segment below
+  size_t        childrenCnt;
+  bool          isList;
+  uint8_t       hdrLen;
+  uint8_t       hdr[9];       // list header, referenced by gather output
+  RlpRope_t     *children[];  // lists: the children; leaves: the encoded bytes
+};
+
+static inline uint8_t *rlp_rope_bytes(const RlpRope_t *r) {
+  return (uint8_t *) r->children;
+}
+
+static RlpRope_t *rlp_rope_alloc(size_t extra) {
+  RlpRope_t *r = malloc(sizeof(*r) + extra);
+  if(r == NULL)
+    return NULL;
+  atomic_init(&r->refs, 1);
+  r->childrenCnt = 0;
+  r->isList = false;
+  r->hdrLen = 0;
+  return r;
+}
+
+static RlpRope_t *rlp_rope_leaf(size_t len) {
+  RlpRope_t *r = rlp_rope_alloc(len);
+  if(r == NULL)
+    return NULL;
+  r->encodedLen = len;
+  r->segsCnt = 1;
+  return r;
+}
+
+static RlpRope_t *rlp_rope_list_alloc(size_t childrenCnt) {
+  RlpRope_t *r = rlp_rope_alloc(childrenCnt * sizeof(RlpRope_t *));
+  if(r == NULL)
+    return NULL;
+  r->isList = true;
+  r->childrenCnt = childrenCnt;
+  return r;
+}
+
+// Takes a reference on every child and computes the header and totals
+static RlpRope_t *rlp_rope_list_seal(RlpRope_t *r) {
+  size_t payloadLen = 0, segsCnt = 1;
+  for(size_t i = 0; i < r->childrenCnt; i++) {
+    rlp_rope_retain(r->children[i]);
+    payloadLen += r->children[i]->encodedLen;
+    segsCnt += r->children[i]->segsCnt;
+  }
+  r->hdrLen = (uint8_t) rlp_encode_header(r->hdr, sizeof(r->hdr), payloadLen, true);
+  r->encodedLen = r->hdrLen + payloadLen;
+  r->segsCnt = segsCnt;
+  return r;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+RlpRope_t *rlp_rope_raw(const void *encoded, size_t len)
+{
+  RlpItem_t item;
+  if(rlp_decode_item(encoded, len, &item) < 0 || item.encodedLen != len)
+    return NULL;
+  RlpRope_t *r = rlp_rope_leaf(len);
+  if(r == NULL)
+    return NULL;
+  memcpy(rlp_rope_bytes(r), encoded, len);
+  return r;
+}
+
+RlpRope_t *rlp_rope_element(const RlpElement_t *const rlpElement)
+{
+  size_t len = rlp_element_encoded_len(rlpElement);
+  if(len == 0)
+    return NULL;
+  RlpRope_t *r = rlp_rope_leaf(len);
+  if(r == NULL)
+    return NULL;
+  if(rlp_encode_element(rlp_rope_bytes(r), len, rlpElement) < 0) {
+    free(r);
+    return NULL;
+  }
+  return r;
+}
+
+RlpRope_t *rlp_rope_list(RlpRope_t *const *children, size_t childrenCnt)
+{
+  if(children == NULL && childrenCnt != 0)
+    return NULL;
+  for(size_t i = 0; i < childrenCnt; i++) {
+    if(children[i] == NULL)
+      return NULL;
+  }
+  RlpRope_t *r = rlp_rope_list_alloc(childrenCnt);
+  if(r == NULL)
+    return NULL;
+  if(childrenCnt)
+    memcpy(r->children, children, childrenCnt * sizeof(*children));
+  return rlp_rope_list_seal(r);
+}
+
+RlpRope_t *rlp_rope_with_child(const RlpRope_t *list, size_t idx, RlpRope_t *child)
+{
+  if(list == NULL || !list->isList || idx >= list->childrenCnt || child == NULL)
+    return NULL;
+  RlpRope_t *r = rlp_rope_list_alloc(list->childrenCnt);
+  if(r == NULL)
+    return NULL;
+  memcpy(r->children, list->children, list->childrenCnt * sizeof(*list->children));
+  r->children[idx] = child;
+  return rlp_rope_list_seal(r);
+}
+
+RlpRope_t *rlp_rope_retain(RlpRope_t *r)
+{
+  if(r != NULL)
+    atomic_fetch_add_explicit(&r->refs, 1, memory_order_relaxed);
+  return r;
+}
+
+void rlp_rope_release(RlpRope_t *r)
+{
+  if(r == NULL || atomic_fetch_sub_explicit(&r->refs, 1, memory_order_acq_rel) != 1)
+    return;
+  for(size_t i = 0; i < r->childrenCnt; i++)
+    rlp_rope_release(r->children[i]);
+  free(r);
+}
+
+size_t rlp_rope_len(const RlpRope_t *r)
+{
+  return r ? r->encodedLen : 0;
+}
+
+bool rlp_rope_is_list(const RlpRope_t *r)
+{
+  return r && r->isList;
+}
+
+size_t rlp_rope_children_count(const RlpRope_t *r)
+{
+  return r ? r->childrenCnt : 0;
+}
+
+RlpRope_t *rlp_rope_child(const RlpRope_t *r, size_t idx)
+{
+  return r && idx < r->childrenCnt ? r->children[idx] : NULL;
+}
+
+size_t rlp_rope_segs_count(const RlpRope_t *r)
+{
+  return r ? r->segsCnt : 0;
+}
+
+int rlp_rope_gather(RlpGather_t *g, const RlpRope_t *r)
+{
+  if(g == NULL || r == NULL)
+    return ERR_RLP_EBADARG;
+  if(r->encodedLen > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  if(g->segsCap - g->segsCnt < r->segsCnt)
+    return ERR_RLP_ENOMEM;
+  if(!r->isList)
+    return rlp_gather_raw(g, rlp_rope_bytes(r), r->encodedLen);
+  rlp_gather_raw(g, r->hdr, r->hdrLen);
+  for(size_t i = 0; i < r->childrenCnt; i++)
+    rlp_rope_gather(g, r->children[i]);
+  return (int) r->encodedLen;
+}
+
+static uint8_t *rlp_rope_write(uint8_t *out, const RlpRope_t *r)
+{
+  if(!r->isList) {
+    rlp_copy_payload(out, rlp_rope_bytes(r), r->encodedLen);
+    return out + r->encodedLen;
+  }
+  memcpy(out, r->hdr, r->hdrLen);
+  out += r->hdrLen;
+  for(size_t i = 0; i < r->childrenCnt; i++)
+    out = rlp_rope_write(out, r->children[i]);
+  return out;
+}
+
+int rlp_rope_flatten(const RlpRope_t *r, void *rlpEncodedOutput, size_t rlpEncodedOutputLen)
+{
+  if(r == NULL || rlpEncodedOutput == NULL)
+    return ERR_RLP_EBADARG;
+  if(r->encodedLen > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  if(rlpEncodedOutputLen < r->encodedLen)
+    return ERR_RLP_EMSGSIZE;
+  rlp_rope_write(rlpEncodedOutput, r);
+  return (int) r->encodedLen;
+}
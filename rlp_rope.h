@@ -0,0 +1,94 @@
+/**
+ * RLP Serializer - Ropes
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Immutable, reference counted, pre-encoded subtrees. Parents share children
+ * instead of copying their bytes; bytes are laid out contiguously only when
+ * asked for, through gather output or a flatten.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_ROPE_H_
+#define __RLP_ROPE_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A rope is either a leaf holding one encoded item or a list of ropes. Ropes
+// never change once built, so any number of parents and threads may share one;
+// an edit builds a new parent around the untouched children (copy on write).
+typedef struct rlpRope RlpRope_t;
+
+// Leaf holding a copy of one already encoded item
+// Returns the new rope with one reference, or NULL if encoded is not a single item or allocation failed
+RlpRope_t *rlp_rope_raw(const void *encoded, size_t len);
+
+// Leaf holding the encoding of rlpElement
+// Returns the new rope with one reference, or NULL on a bad element or failed allocation
+RlpRope_t *rlp_rope_element(const RlpElement_t *const rlpElement);
+
+// List of children; every child gains a reference, the caller keeps its own
+// Returns the new rope with one reference, or NULL if allocation failed
+RlpRope_t *rlp_rope_list(RlpRope_t *const *children, size_t childrenCnt);
+
+// Copy of list with child idx replaced by child; the other children are shared
+// Returns the new rope with one reference, or NULL on a bad argument or failed allocation
+RlpRope_t *rlp_rope_with_child(const RlpRope_t *list, size_t idx, RlpRope_t *child);
+
+RlpRope_t *rlp_rope_retain(RlpRope_t *r);
+
+// Drops a reference, freeing the rope and releasing its children on the last one
+void rlp_rope_release(RlpRope_t *r);
+
+size_t rlp_rope_len(const RlpRope_t *r);
+
+bool rlp_rope_is_list(const RlpRope_t *r);
+
+// Number of children of a list, 0 for a leaf
+size_t rlp_rope_children_count(const RlpRope_t *r);
+
+// Borrowed pointer to child idx, or NULL
+RlpRope_t *rlp_rope_child(const RlpRope_t *r, size_t idx);
+
+// Segments rlp_rope_gather() appends for r
+size_t rlp_rope_segs_count(const RlpRope_t *r);
+
+// Appends r to g by reference, no bytes are copied; r must stay referenced until the segments are consumed
+// Returns length of output in bytes, or a negative error value
+int rlp_rope_gather(RlpGather_t *g, const RlpRope_t *r);
+
+// Writes the encoding of r contiguously
+// Returns length of output in bytes, or a negative error value
+int rlp_rope_flatten(const RlpRope_t *r, void *rlpEncodedOutput, size_t rlpEncodedOutputLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
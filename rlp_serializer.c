@@ -35,9 +35,19 @@
  */
 
 #include "rlp_serializer.h"
+#include "rlp_copy.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 /* -------------------------------------------------------------------------- */
 /*                             Internal Constants                             */
@@ -51,6 +61,24 @@
 #define DEBUG_PRINTF(...)
 #endif
 
+// How far ahead of the streaming copy the source is prefetched
+#define RLP_STREAM_COPY_PREFETCH 512
+
+// How many elements ahead the list encoder prefetches. Descriptors are fetched
+// this far ahead and their payloads half as far, by which time the descriptor
+// holding the payload pointer has arrived. On 1M element lists with descriptors
+// and payloads scattered over 512 MB, any distance from 16 to 128 is about as good
+// and 32 was the best on the whole; see rlp_prefetch_bench.c.
+#ifndef RLP_PREFETCH_DISTANCE
+#define RLP_PREFETCH_DISTANCE 32
+#endif
+
+#if defined(__GNUC__)
+#define RLP_PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define RLP_PREFETCH(addr)
+#endif
+
 enum rlpProtocolConstants {
   RLP_EXTENDED_LENGTH_THRESHOLD = 55,
   RLP_OFFSET_LIST_SHORT         = 0xC0,
@@ -103,6 +131,39 @@ static inline int rlp_int_size_from_type(RlpType_t t) {
   }
 }
 
+// Integers are big endian; skip their leading zero bytes.
+// An all-zero integer is trimmed down to zero length.
+static inline const uint8_t *rlp_trim_leading_zeroes(const uint8_t *buff, size_t *len) {
+  size_t scanZero = 0;
+  while(scanZero < *len && buff[scanZero] == 0x00)
+    scanZero++;
+  *len -= scanZero;
+  return buff + scanZero;
+}
+
+// Number of bytes needed to represent len in big endian with no leading zeroes
+static inline size_t rlp_length_of_length(size_t len) {
+  size_t lengthOfLength = 0;
+  for(; len != 0; len >>= 8)
+    lengthOfLength++;
+  return lengthOfLength;
+}
+
+// Writes a string or list header, offsets select which; returns header size
+static inline size_t rlp_write_header(uint8_t *out, size_t payloadLen, uint8_t shortOffset, uint8_t longOffset) {
+  if(payloadLen <= RLP_EXTENDED_LENGTH_THRESHOLD) {
+    out[0] = (uint8_t) (shortOffset + payloadLen);
+    return 1;
+  }
+  size_t lengthOfLength = rlp_length_of_length(payloadLen);
+  out[0] = (uint8_t) (longOffset + lengthOfLength);
+  for(size_t i = lengthOfLength; i > 0; --i) {
+    out[i] = (uint8_t) payloadLen;
+    payloadLen >>= 8;
+  }
+  return lengthOfLength + 1;
+}
+
 static inline bool rlp_type_mem_check(size_t buffSz, RlpType_t type) {
   if (RLP_TYPE_IS_INTEGER_TYPE(type))
       return buffSz == rlp_int_size_from_type(type);
@@ -112,11 +173,246 @@ static inline bool rlp_type_mem_check(size_t buffSz, RlpType_t type) {
   return false;
 }
 
+// Element arrays from a tx pool are pointers to descriptors scattered over the heap,
+// each pointing to a payload elsewhere: two dependent misses per element unless fetched early.
+// The sizing pass has not validated elements ahead of i yet, a NULL descriptor is skipped here
+// and rejected when the pass reaches it. A distance of 0 turns prefetching off.
+static inline void rlp_prefetch_elements(const RlpElement_t *const *rlpElementsArr, size_t i, size_t n) {
+#if RLP_PREFETCH_DISTANCE > 0
+  if(i + RLP_PREFETCH_DISTANCE < n)
+    RLP_PREFETCH(rlpElementsArr[i + RLP_PREFETCH_DISTANCE]);
+  if(i + RLP_PREFETCH_DISTANCE / 2 < n) {
+    const RlpElement_t *ahead = rlpElementsArr[i + RLP_PREFETCH_DISTANCE / 2];
+    if(ahead != NULL)
+      RLP_PREFETCH(ahead->buff);
+  }
+#else
+  (void) rlpElementsArr; (void) i; (void) n;
+#endif
+}
+
+// Descriptors are warm and validated by the sizing pass, only the payloads may have been evicted
+static inline void rlp_prefetch_payload(const RlpElement_t *const *rlpElementsArr, size_t i, size_t n) {
+#if RLP_PREFETCH_DISTANCE > 0
+  if(i + RLP_PREFETCH_DISTANCE < n)
+    RLP_PREFETCH(rlpElementsArr[i + RLP_PREFETCH_DISTANCE]->buff);
+#else
+  (void) rlpElementsArr; (void) i; (void) n;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Payload Copies                              */
+/* -------------------------------------------------------------------------- */
+
+#if defined(RLP_STATIC)
+static size_t rlpStreamCopyThreshold = RLP_STREAM_COPY_THRESHOLD;
+#else
+size_t rlpStreamCopyThreshold = RLP_STREAM_COPY_THRESHOLD;
+#endif
+
+RLP_API void rlp_copy_stream(void *dst, const void *src, size_t n) {
+#if defined(__SSE2__)
+  uint8_t *d = (uint8_t *) dst;
+  const uint8_t *s = (const uint8_t *) src;
+  // Streaming stores need an aligned destination, copy the head normally
+  size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+  if(head > n)
+    head = n;
+  rlp_copy_small(d, s, head);
+  d += head;
+  s += head;
+  n -= head;
+  for(; n >= 64; n -= 64, d += 64, s += 64) {
+    // Prefetching past the end of src is harmless, prefetches never fault
+    _mm_prefetch((const char *) s + RLP_STREAM_COPY_PREFETCH, _MM_HINT_NTA);
+    __m128i x0 = _mm_loadu_si128((const __m128i *) (s +  0));
+    __m128i x1 = _mm_loadu_si128((const __m128i *) (s + 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i *) (s + 32));
+    __m128i x3 = _mm_loadu_si128((const __m128i *) (s + 48));
+    _mm_stream_si128((__m128i *) (d +  0), x0);
+    _mm_stream_si128((__m128i *) (d + 16), x1);
+    _mm_stream_si128((__m128i *) (d + 32), x2);
+    _mm_stream_si128((__m128i *) (d + 48), x3);
+  }
+  rlp_copy_small(d, s, n);
+  // Streaming stores are weakly ordered, fence before anyone else reads the output
+  _mm_sfence();
+#else
+  memcpy(dst, src, n);
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Integer Lists                               */
+/* -------------------------------------------------------------------------- */
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define RLP_UINT64_LIST_LE
+#endif
+
+// Encoding class of an integer: 0 for zero (0x80), 1 below 0x80 (the byte itself), else
+// 1 + its byte count (header 0x80 + count, then the bytes). The encoded length is the
+// class, or 1 for class 0.
+static inline unsigned rlp_uint64_class(uint64_t v) {
+  if(v < RLP_OFFSET_ITEM_SHORT)
+    return v != 0;
+#if defined(__GNUC__)
+  return 1 + 8 - (unsigned) __builtin_clzll(v) / 8;
+#else
+  return 1 + (unsigned) rlp_length_of_length(v);
+#endif
+}
+
+#if defined(__AVX2__)
+// Classes of four integers at once: v != 0, plus one unsigned compare per byte boundary.
+// The compares are independent and summed as a tree, not one after the other.
+static inline __m256i rlp_uint64_class4(__m256i v) {
+  // Compares are signed, flipping the sign bit of both sides makes them unsigned
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  __m256i x = _mm256_xor_si256(v, sign);
+#define RLP_GE(bound) _mm256_cmpgt_epi64(x, _mm256_set1_epi64x((int64_t) (((bound) - 1) ^ (uint64_t) INT64_MIN)))
+  __m256i a = _mm256_add_epi64(_mm256_cmpgt_epi64(x, sign), RLP_GE(RLP_OFFSET_ITEM_SHORT));
+  __m256i b = _mm256_add_epi64(RLP_GE(1ull << 8), RLP_GE(1ull << 16));
+  __m256i c = _mm256_add_epi64(RLP_GE(1ull << 24), RLP_GE(1ull << 32));
+  __m256i d = _mm256_add_epi64(RLP_GE(1ull << 40), RLP_GE(1ull << 48));
+  __m256i e = RLP_GE(1ull << 56);
+#undef RLP_GE
+  // Each true compare is -1
+  return _mm256_sub_epi64(_mm256_setzero_si256(), _mm256_add_epi64(_mm256_add_epi64(a, b), _mm256_add_epi64(_mm256_add_epi64(c, d), e)));
+}
+
+static inline __m256i rlp_uint64_len4(__m256i c) {
+  return _mm256_sub_epi64(c, _mm256_cmpeq_epi64(c, _mm256_setzero_si256()));
+}
+#endif
+
+#if defined(__SSSE3__)
+// Byte shuffles from a little endian integer to its encoding after the header byte,
+// one per class; indexes with the top bit set (0x80) come out zero and the header is or-ed in
+static const uint8_t rlpUint64Shuffle[10][16] __attribute__((aligned(16))) = {
+  { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x03, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x04, 0x03, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+  { 0x80, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+};
+static const uint8_t rlpUint64Header[10] = { 0x80, 0x00, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88 };
+
+// Writes 16 bytes at out, the ones past the encoding are garbage for the next integer to overwrite
+static inline void rlp_uint64_pack(uint8_t *out, uint64_t v, unsigned c) {
+  __m128i x = _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i *) &v), _mm_load_si128((const __m128i *) rlpUint64Shuffle[c]));
+  _mm_storeu_si128((__m128i *) out, _mm_or_si128(x, _mm_cvtsi32_si128(rlpUint64Header[c])));
+}
+#define RLP_UINT64_PACK_SLACK 16
+#elif defined(RLP_UINT64_LIST_LE)
+// Writes 9 bytes at out: the header, then the value byte swapped with its significant
+// bytes moved to the front; the ones past the encoding are garbage for the next integer
+static inline void rlp_uint64_pack(uint8_t *out, uint64_t v, unsigned c) {
+  if(c < 2) {
+    out[0] = c ? (uint8_t) v : RLP_OFFSET_ITEM_SHORT;
+    return;
+  }
+  uint64_t be = __builtin_bswap64(v << (8 * (9 - c)));
+  out[0] = (uint8_t) (RLP_OFFSET_ITEM_SHORT + c - 1);
+  memcpy(out + 1, &be, sizeof(be));
+}
+#define RLP_UINT64_PACK_SLACK 9
+#endif
+
+// Sum of the encoded lengths
+static size_t rlp_uint64_payload_len(const uint64_t *values, size_t cnt) {
+  size_t i = 0, len = 0;
+#if defined(__AVX2__)
+  const __m256i highBits = _mm256_set1_epi64x((int64_t) ~(uint64_t) (RLP_OFFSET_ITEM_SHORT - 1));
+  __m256i acc = _mm256_setzero_si256();
+  for(; i + 4 <= cnt; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    if(_mm256_testz_si256(v, highBits))
+      len += 4; // all single byte
+    else
+      acc = _mm256_add_epi64(acc, rlp_uint64_len4(rlp_uint64_class4(v)));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *) lanes, acc);
+  len += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+  for(; i < cnt; i++) {
+    unsigned c = rlp_uint64_class(values[i]);
+    len += c ? c : 1;
+  }
+  return len;
+}
+
+// Encodes the integers back to back from out up to end, which must be exactly their length.
+// The packing loops write past each encoding, so they stop short of end and the rest are
+// written exactly.
+static void rlp_uint64_pack_all(uint8_t *out, const uint8_t *end, const uint64_t *values, size_t cnt) {
+  size_t i = 0;
+#if defined(__AVX2__) && defined(__SSSE3__)
+  // Four at a time: classes and lengths in vector lanes, positions from an in-register
+  // prefix sum. The running offset stays in a register too, so the shuffles and stores
+  // of one block do not wait on each other or on the previous block.
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i base = zero;
+  size_t total = end - out;
+  const __m256i highBits = _mm256_set1_epi64x((int64_t) ~(uint64_t) (RLP_OFFSET_ITEM_SHORT - 1));
+  const __m256i lowBytes = _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  for(; i + 4 <= cnt; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (values + i));
+    size_t off = (size_t) _mm_cvtsi128_si64(_mm256_castsi256_si128(base));
+    if(_mm256_testz_si256(v, highBits) && off + 4 <= total) {
+      // Four single byte encodings: the values themselves, 0x80 for zero
+      __m256i b = _mm256_or_si256(v, _mm256_and_si256(_mm256_cmpeq_epi64(v, zero), _mm256_set1_epi64x(RLP_OFFSET_ITEM_SHORT)));
+      b = _mm256_shuffle_epi8(b, lowBytes);
+      uint32_t four = (uint32_t) _mm256_extract_epi16(b, 0) | (uint32_t) _mm256_extract_epi16(b, 8) << 16;
+      memcpy(out + off, &four, sizeof(four));
+      base = _mm256_add_epi64(base, _mm256_set1_epi64x(4));
+      continue;
+    }
+    __m256i c = rlp_uint64_class4(v);
+    __m256i len = rlp_uint64_len4(c);
+    __m256i sum = _mm256_add_epi64(len, _mm256_blend_epi32(_mm256_permute4x64_epi64(len, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+    sum = _mm256_add_epi64(sum, _mm256_blend_epi32(_mm256_permute4x64_epi64(sum, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F));
+    uint64_t cls[4], pos[4];
+    _mm256_storeu_si256((__m256i *) cls, c);
+    _mm256_storeu_si256((__m256i *) pos, _mm256_add_epi64(base, _mm256_sub_epi64(sum, len)));
+    if(pos[3] + RLP_UINT64_PACK_SLACK > total)
+      break;
+    rlp_uint64_pack(out + pos[0], values[i + 0], (unsigned) cls[0]);
+    rlp_uint64_pack(out + pos[1], values[i + 1], (unsigned) cls[1]);
+    rlp_uint64_pack(out + pos[2], values[i + 2], (unsigned) cls[2]);
+    rlp_uint64_pack(out + pos[3], values[i + 3], (unsigned) cls[3]);
+    base = _mm256_add_epi64(base, _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 3, 3, 3)));
+  }
+  out += _mm_cvtsi128_si64(_mm256_castsi256_si128(base));
+#endif
+#if defined(RLP_UINT64_PACK_SLACK)
+  for(; i < cnt && end - out >= RLP_UINT64_PACK_SLACK; i++) {
+    unsigned c = rlp_uint64_class(values[i]);
+    rlp_uint64_pack(out, values[i], c);
+    out += c ? c : 1;
+  }
+#endif
+  for(; i < cnt; i++)
+    out += rlp_encode_uint64(out, end - out, values[i]);
+}
+
 /* -------------------------------------------------------------------------- */
 /*                             API Implementation                             */
 /* -------------------------------------------------------------------------- */
 
-RlpType_t rlp_int_type_from_size(int s) {
+RLP_API void rlp_set_stream_copy_threshold(size_t bytes) {
+  rlpStreamCopyThreshold = bytes;
+}
+
+RLP_API RlpType_t rlp_int_type_from_size(int s) {
   for(int i = RLP_TYPE_INT8; i <= RLP_TYPE_INT1024; i++) {
     if(s == rlp_int_size_from_type(i))
       return i;
@@ -125,12 +421,12 @@ RlpType_t rlp_int_type_from_size(int s) {
 }
 
 // Returns length of output in bytes, or a negative error value
-int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const rlpElement)
+RLP_API int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const rlpElement)
 {
   if(rlpEncodedOutput == NULL || rlpElement == NULL || rlpEncodedOutputLen == 0 || 
      rlpElement->type == RLP_TYPE_INVALID || !rlp_type_mem_check(rlpElement->len, rlpElement->type))
     return ERR_RLP_EBADARG;
-  if(rlpEncodedOutputLen < (rlpElement->len + 1)) // extra byte for rlp encoding tag
+  if(rlpEncodedOutputLen < rlp_element_encoded_len(rlpElement)) // exact size, header included
     return ERR_RLP_ENOMEM;
   if(rlp_memoverlap(rlpEncodedOutput, rlpEncodedOutputLen, rlpElement->buff, rlpElement->len)) // No overlapping memory regions
     return ERR_RLP_EILLEGALMEM;
@@ -140,20 +436,8 @@ int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const
   size_t rlpElementLen = rlpElement->len;
   size_t rlpEncodedLen = 0;
 
-  if(RLP_TYPE_IS_INTEGER_TYPE(rlpElement->type)) {
-    const uint8_t *buffBase = rlpElement->buff;
-    for(size_t scanZero = 0; scanZero < rlpElement->len; scanZero++) { 
-      if(buffBase[scanZero]) {
-        rlpElementBuff = (buffBase + scanZero);
-        rlpElementLen -= scanZero;
-        break;
-      } else if (scanZero == rlpElement->len - 1) {
-        // If we reach the end and have not yet found a non-zero byte,
-        // this field is zero length
-        rlpElementLen = 0;
-      }
-    }
-  }
+  if(RLP_TYPE_IS_INTEGER_TYPE(rlpElement->type))
+    rlpElementBuff = rlp_trim_leading_zeroes(rlpElementBuff, &rlpElementLen);
   // Element Header Generation
   if(rlpElementLen == 0) {
     rlpEncodedLen = 1;
@@ -168,20 +452,17 @@ int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const
     uint8_t length = (uint8_t) (RLP_OFFSET_ITEM_SHORT + rlpElementLen);
     rlpOut[0] = length;
     // Payload
-    memcpy(rlpOut + 1, rlpElementBuff, rlpElementLen);
+    rlp_copy_small(rlpOut + 1, rlpElementBuff, rlpElementLen);
     rlpEncodedLen = rlpElementLen + 1;
   } 
   // Complicated case of needing an extended length byte
   else {
-    int tmpLength = rlpElementLen;
+    size_t tmpLength = rlpElementLen;
     size_t lengthOfLength = (size_t) 0;
     while (tmpLength != 0) {
         ++lengthOfLength;
         tmpLength = tmpLength >> 8;
     }
-    if(rlpEncodedOutputLen < (rlpElementLen + lengthOfLength + 1))
-      return ERR_RLP_ENOMEM; // buffer is unable to accomodate the encoded payload... 
-                             // this should not happen, since we checked above.
     rlpOut[0] = (uint8_t) (RLP_OFFSET_ITEM_LONG + lengthOfLength);
     tmpLength = rlpElementLen;
     for(int i = lengthOfLength; i > 0; --i) {
@@ -189,69 +470,341 @@ int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const
       tmpLength = tmpLength >> 8;
     }
     // Payload
-    memcpy(rlpOut + 1 + lengthOfLength, rlpElementBuff, (rlpElementLen + lengthOfLength + 1));
+    rlp_copy_payload(rlpOut + 1 + lengthOfLength, rlpElementBuff, rlpElementLen);
     rlpEncodedLen = (rlpElementLen + lengthOfLength + 1);
   }
   return rlpEncodedLen; // all was successful, return encoded length.
 }
 
 // Returns length of output in bytes, or a negative error value
-int rlp_encode_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, 
+RLP_API int rlp_encode_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, 
                     const RlpElement_t *const *rlpElementsArr, size_t rplElementsLen)
 {
   if( rlpEncodedOutput == NULL || rlpElementsArr == NULL || rlpEncodedOutputLen == 0 )
     return ERR_RLP_EBADARG;
   
-  // loop through all elements and determine if sufficient output space is available
-  // and there are no memory overlap violations
-  size_t spaceRemaining = rlpEncodedOutputLen;
-  for(int i = 0; i < rplElementsLen; i++) {
-    if(spaceRemaining < (rlpElementsArr[i]->len + 1)) // extra byte for rlp encoding tag
-      return ERR_RLP_ENOMEM;
-    else
-      spaceRemaining -= (rlpElementsArr[i]->len + 1);
+  // loop through all elements to size the payload exactly
+  // and make sure there are no memory overlap violations
+  size_t payloadLen = 0;
+  for(size_t i = 0; i < rplElementsLen; i++) {
+    rlp_prefetch_elements(rlpElementsArr, i, rplElementsLen);
+    size_t elementLen = rlp_element_encoded_len(rlpElementsArr[i]);
+    if(elementLen == 0)
+      return ERR_RLP_EBADARG;
+    payloadLen += elementLen;
 
     if(rlp_memoverlap(rlpEncodedOutput, rlpEncodedOutputLen, rlpElementsArr[i]->buff, rlpElementsArr[i]->len)) // No overlapping memory regions
       return ERR_RLP_EILLEGALMEM;
   }
-  size_t rlpEncodedLen = 0;
+  if(rlp_header_len(payloadLen) + payloadLen > rlpEncodedOutputLen)
+    return ERR_RLP_ENOMEM;
+
+  // The header goes first, elements are encoded right behind it
   uint8_t *rlpOut = (uint8_t *) rlpEncodedOutput;
-  
-  // Encode each element
-  for(int i = 0; i < rplElementsLen; i++) {
+  size_t rlpEncodedLen = rlp_write_header(rlpOut, payloadLen, RLP_OFFSET_LIST_SHORT, RLP_OFFSET_LIST_LONG);
+  for(size_t i = 0; i < rplElementsLen; i++) {
+    rlp_prefetch_payload(rlpElementsArr, i, rplElementsLen);
     int ret = rlp_encode_element((rlpOut + rlpEncodedLen), (rlpEncodedOutputLen - rlpEncodedLen), rlpElementsArr[i]);
-    DEBUG_PRINTF("retsize == %zu | elementNum == %d\r\n", ret, i);
+    DEBUG_PRINTF("retsize == %d | elementNum == %zu\r\n", ret, i);
     if(ret < 0)
       return ret;
     rlpEncodedLen += ret;
   }
-  // Calculate list header byte size
-  uint8_t listHdrByteCnt = 0;
-  for(int byteShifts = rlpEncodedLen; byteShifts > 0; byteShifts = byteShifts >> 8) {
-    listHdrByteCnt++;
+  return rlpEncodedLen;
+}
+
+// Returns the exact number of bytes rlp_encode_element() produces, or 0 on bad argument
+RLP_API size_t rlp_element_encoded_len(const RlpElement_t *const rlpElement)
+{
+  if(rlpElement == NULL || rlpElement->type == RLP_TYPE_INVALID ||
+     !rlp_type_mem_check(rlpElement->len, rlpElement->type))
+    return 0;
+
+  const uint8_t *rlpElementBuff = rlpElement->buff;
+  size_t rlpElementLen = rlpElement->len;
+  if(RLP_TYPE_IS_INTEGER_TYPE(rlpElement->type))
+    rlpElementBuff = rlp_trim_leading_zeroes(rlpElementBuff, &rlpElementLen);
+
+  if(rlpElementLen == 1 && rlpElementBuff[0] < RLP_OFFSET_ITEM_SHORT)
+    return 1;
+  return rlp_header_len(rlpElementLen) + rlpElementLen;
+}
+
+// Returns the number of header bytes preceding a string or list payload of payloadLen bytes
+RLP_API size_t rlp_header_len(size_t payloadLen)
+{
+  if(payloadLen <= RLP_EXTENDED_LENGTH_THRESHOLD)
+    return 1;
+  return 1 + rlp_length_of_length(payloadLen);
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_header(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, size_t payloadLen, bool isList)
+{
+  if(rlpEncodedOutput == NULL)
+    return ERR_RLP_EBADARG;
+  if(rlpEncodedOutputLen < rlp_header_len(payloadLen))
+    return ERR_RLP_ENOMEM;
+  if(isList)
+    return rlp_write_header(rlpEncodedOutput, payloadLen, RLP_OFFSET_LIST_SHORT, RLP_OFFSET_LIST_LONG);
+  return rlp_write_header(rlpEncodedOutput, payloadLen, RLP_OFFSET_ITEM_SHORT, RLP_OFFSET_ITEM_LONG);
+}
+
+// Returns the exact number of bytes rlp_encode_uint64() produces for v
+RLP_API size_t rlp_uint64_encoded_len(uint64_t v)
+{
+  if(v < RLP_OFFSET_ITEM_SHORT)
+    return 1; // zero encodes as the empty string, anything else below 0x80 is its own byte
+  return 1 + rlp_length_of_length(v);
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_uint64(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, uint64_t v)
+{
+  if(rlpEncodedOutput == NULL)
+    return ERR_RLP_EBADARG;
+  size_t rlpEncodedLen = rlp_uint64_encoded_len(v);
+  if(rlpEncodedOutputLen < rlpEncodedLen)
+    return ERR_RLP_ENOMEM;
+
+  uint8_t *rlpOut = (uint8_t *) rlpEncodedOutput;
+  if(v == 0)
+    rlpOut[0] = (uint8_t) RLP_OFFSET_ITEM_SHORT;
+  else if(v < RLP_OFFSET_ITEM_SHORT)
+    rlpOut[0] = (uint8_t) v;
+  else {
+    rlpOut[0] = (uint8_t) (RLP_OFFSET_ITEM_SHORT + (rlpEncodedLen - 1));
+    for(size_t i = rlpEncodedLen - 1; i > 0; --i) {
+      rlpOut[i] = (uint8_t) v;
+      v >>= 8;
+    }
+  }
+  return rlpEncodedLen;
+}
+
+// Returns the exact number of bytes rlp_encode_uint64_list() produces
+RLP_API size_t rlp_uint64_list_encoded_len(const uint64_t *values, size_t valuesCnt)
+{
+  if(values == NULL && valuesCnt)
+    return 0;
+  size_t payloadLen = rlp_uint64_payload_len(values, valuesCnt);
+  return rlp_header_len(payloadLen) + payloadLen;
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_uint64_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const uint64_t *values, size_t valuesCnt)
+{
+  if(rlpEncodedOutput == NULL || (values == NULL && valuesCnt))
+    return ERR_RLP_EBADARG;
+  if(valuesCnt && rlp_memoverlap(rlpEncodedOutput, rlpEncodedOutputLen, values, valuesCnt * sizeof(*values)))
+    return ERR_RLP_EILLEGALMEM;
+  size_t payloadLen = rlp_uint64_payload_len(values, valuesCnt);
+  if(rlp_header_len(payloadLen) + payloadLen > rlpEncodedOutputLen)
+    return ERR_RLP_ENOMEM;
+
+  uint8_t *rlpOut = (uint8_t *) rlpEncodedOutput;
+  size_t hdrLen = rlp_write_header(rlpOut, payloadLen, RLP_OFFSET_LIST_SHORT, RLP_OFFSET_LIST_LONG);
+  rlp_uint64_pack_all(rlpOut + hdrLen, rlpOut + hdrLen + payloadLen, values, valuesCnt);
+  return hdrLen + payloadLen;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Gather Output                               */
+/* -------------------------------------------------------------------------- */
+
+RLP_API void rlp_gather_init(RlpGather_t *g, RlpGatherSeg_t *segs, size_t segsCap, void *scratch, size_t scratchCap)
+{
+  g->segs       = segs;
+  g->segsCap    = segsCap;
+  g->segsCnt    = 0;
+  g->scratch    = scratch;
+  g->scratchCap = scratchCap;
+  g->scratchLen = 0;
+  g->totalLen   = 0;
+}
+
+// Consecutive scratch reservations extend the same segment
+RLP_API uint8_t *rlp_gather_reserve(RlpGather_t *g, size_t n)
+{
+  if(g == NULL || g->scratchCap - g->scratchLen < n)
+    return NULL;
+  uint8_t *tail = g->scratch + g->scratchLen;
+  RlpGatherSeg_t *last = g->segsCnt ? &g->segs[g->segsCnt - 1] : NULL;
+  if(last == NULL || (const uint8_t *) last->buff + last->len != tail) {
+    if(g->segsCnt == g->segsCap)
+      return NULL;
+    last = &g->segs[g->segsCnt++];
+    last->buff = tail;
+    last->len = 0;
   }
-  if(rlpEncodedLen > RLP_EXTENDED_LENGTH_THRESHOLD)
-    listHdrByteCnt++; // additional byte for extended length tag
-  // orig
-  if((listHdrByteCnt + rlpEncodedLen) > rlpEncodedOutputLen) {
-    // ain't enough room for the header
+  last->len += n;
+  g->scratchLen += n;
+  g->totalLen += n;
+  return tail;
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_raw(RlpGather_t *g, const void *buff, size_t len)
+{
+  if(g == NULL || (buff == NULL && len != 0))
+    return ERR_RLP_EBADARG;
+  if(len == 0)
+    return 0;
+  if(g->segsCnt == g->segsCap)
     return ERR_RLP_ENOMEM;
+  g->segs[g->segsCnt].buff = buff;
+  g->segs[g->segsCnt].len = len;
+  g->segsCnt++;
+  g->totalLen += len;
+  return len;
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_header(RlpGather_t *g, size_t payloadLen, bool isList)
+{
+  if(g == NULL)
+    return ERR_RLP_EBADARG;
+  uint8_t *out = rlp_gather_reserve(g, rlp_header_len(payloadLen));
+  if(out == NULL)
+    return ERR_RLP_ENOMEM;
+  if(isList)
+    return rlp_write_header(out, payloadLen, RLP_OFFSET_LIST_SHORT, RLP_OFFSET_LIST_LONG);
+  return rlp_write_header(out, payloadLen, RLP_OFFSET_ITEM_SHORT, RLP_OFFSET_ITEM_LONG);
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_element(RlpGather_t *g, const RlpElement_t *const rlpElement)
+{
+  size_t rlpEncodedLen = rlp_element_encoded_len(rlpElement);
+  if(g == NULL || rlpEncodedLen == 0)
+    return ERR_RLP_EBADARG;
+
+  if(rlpElement->len < RLP_GATHER_REF_THRESHOLD) {
+    uint8_t *out = rlp_gather_reserve(g, rlpEncodedLen);
+    if(out == NULL)
+      return ERR_RLP_ENOMEM;
+    return rlp_encode_element(out, rlpEncodedLen, rlpElement);
   }
-  // first shift everything down to fit the header
-  for(int i = (listHdrByteCnt + rlpEncodedLen); i >= listHdrByteCnt ; i--) {
-    rlpOut[i] = rlpOut[i - (listHdrByteCnt)];
+  // Large payloads are referenced in place, only their header is staged.
+  // Byte arrays are never trimmed, so the payload is exactly the element buffer.
+  const uint8_t *rlpElementBuff = rlpElement->buff;
+  size_t rlpElementLen = rlpElement->len;
+  if(RLP_TYPE_IS_INTEGER_TYPE(rlpElement->type))
+    rlpElementBuff = rlp_trim_leading_zeroes(rlpElementBuff, &rlpElementLen);
+  int hdrLen = rlp_gather_header(g, rlpElementLen, false);
+  if(hdrLen < 0)
+    return hdrLen;
+  int ret = rlp_gather_raw(g, rlpElementBuff, rlpElementLen);
+  if(ret < 0)
+    return ret;
+  return hdrLen + ret;
+}
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_flatten(const RlpGather_t *g, void *rlpEncodedOutput, size_t rlpEncodedOutputLen)
+{
+  if(g == NULL || rlpEncodedOutput == NULL)
+    return ERR_RLP_EBADARG;
+  if(rlpEncodedOutputLen < g->totalLen)
+    return ERR_RLP_ENOMEM;
+  uint8_t *rlpOut = (uint8_t *) rlpEncodedOutput;
+  for(size_t i = 0; i < g->segsCnt; i++) {
+    rlp_copy_payload(rlpOut, g->segs[i].buff, g->segs[i].len);
+    rlpOut += g->segs[i].len;
   }
-  if(rlpEncodedLen > RLP_EXTENDED_LENGTH_THRESHOLD) {
-    // generate the header
-    for(int i = 0; i < listHdrByteCnt; i++) {
-      rlpOut[(listHdrByteCnt - 1) - i] = // subtract 1 to turn count into index
-        (uint8_t) (rlpEncodedLen >> (8 * i));
-    }
-    rlpOut[0] = (uint8_t) (RLP_OFFSET_LIST_LONG + (listHdrByteCnt - 1));
+  return g->totalLen;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Decoding                                  */
+/* -------------------------------------------------------------------------- */
+
+// Returns the number of bytes the item occupies, or a negative error value
+RLP_API int rlp_decode_item(const void *rlpEncoded, size_t rlpEncodedLen, RlpItem_t *item)
+{
+  if(rlpEncoded == NULL || item == NULL)
+    return ERR_RLP_EBADARG;
+  if(rlpEncodedLen == 0)
+    return ERR_RLP_ENODATA;
+
+  const uint8_t *rlpIn = (const uint8_t *) rlpEncoded;
+  uint8_t prefix = rlpIn[0];
+  size_t hdrLen = 1;
+  size_t payloadLen = 0;
+
+  item->isList = (prefix >= RLP_OFFSET_LIST_SHORT);
+  if(prefix < RLP_OFFSET_ITEM_SHORT) {
+    // The byte is its own payload
+    item->payload = rlpIn;
+    item->payloadLen = 1;
+    item->encodedLen = 1;
+    return 1;
+  }
+  else if(prefix <= RLP_OFFSET_ITEM_LONG || (prefix >= RLP_OFFSET_LIST_SHORT && prefix <= RLP_OFFSET_LIST_LONG)) {
+    payloadLen = prefix - (item->isList ? RLP_OFFSET_LIST_SHORT : RLP_OFFSET_ITEM_SHORT);
+    if(!item->isList && payloadLen == 1 && (rlpEncodedLen < 2 || rlpIn[1] < RLP_OFFSET_ITEM_SHORT))
+      return rlpEncodedLen < 2 ? ERR_RLP_ENODATA : ERR_RLP_EINVAL; // single byte should have been its own payload
   }
   else {
-    rlpOut[0] = (uint8_t) (RLP_OFFSET_LIST_SHORT + rlpEncodedLen);
+    size_t lengthOfLength = prefix - (item->isList ? RLP_OFFSET_LIST_LONG : RLP_OFFSET_ITEM_LONG);
+    if(lengthOfLength > sizeof(size_t))
+      return ERR_RLP_EMSGSIZE;
+    if(rlpEncodedLen < 1 + lengthOfLength)
+      return ERR_RLP_ENODATA;
+    if(rlpIn[1] == 0x00)
+      return ERR_RLP_EINVAL; // leading zero in length
+    for(size_t i = 1; i <= lengthOfLength; i++)
+      payloadLen = (payloadLen << 8) | rlpIn[i];
+    if(payloadLen <= RLP_EXTENDED_LENGTH_THRESHOLD)
+      return ERR_RLP_EINVAL; // should have used the short form
+    hdrLen += lengthOfLength;
   }
-  rlpEncodedLen += listHdrByteCnt;
-  return rlpEncodedLen;
-}
\ No newline at end of file
+  if(payloadLen > rlpEncodedLen - hdrLen)
+    return ERR_RLP_ENODATA;
+  if(hdrLen + payloadLen > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  item->payload = rlpIn + hdrLen;
+  item->payloadLen = payloadLen;
+  item->encodedLen = hdrLen + payloadLen;
+  return item->encodedLen;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+RLP_API int rlp_cursor_init(RlpCursor_t *cur, const RlpItem_t *list)
+{
+  if(cur == NULL || list == NULL || !list->isList)
+    return ERR_RLP_EBADARG;
+  cur->pos = list->payload;
+  cur->end = list->payload + list->payloadLen;
+  return ERR_RLP_OK;
+}
+
+// Returns 1 and fills item, 0 once the list is exhausted, or a negative error value
+RLP_API int rlp_cursor_next(RlpCursor_t *cur, RlpItem_t *item)
+{
+  if(cur == NULL || item == NULL)
+    return ERR_RLP_EBADARG;
+  if(cur->pos == cur->end)
+    return 0;
+  int ret = rlp_decode_item(cur->pos, cur->end - cur->pos, item);
+  if(ret < 0)
+    return ret == ERR_RLP_ENODATA ? ERR_RLP_EINVAL : ret; // an item overrunning its list is malformed
+  cur->pos += ret;
+  return 1;
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+RLP_API int rlp_decode_uint64(const RlpItem_t *item, uint64_t *v)
+{
+  if(item == NULL || v == NULL || item->isList)
+    return ERR_RLP_EBADARG;
+  if(item->payloadLen > sizeof(uint64_t))
+    return ERR_RLP_EMSGSIZE;
+  if(item->payloadLen > 0 && item->payload[0] == 0x00)
+    return ERR_RLP_EINVAL; // leading zeroes, zero itself is the empty string
+  uint64_t value = 0;
+  for(size_t i = 0; i < item->payloadLen; i++)
+    value = (value << 8) | item->payload[i];
+  *v = value;
+  return ERR_RLP_OK;
+}
@@ -41,10 +41,19 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define RLP_SERIALIZER_VER_MAJOR 1
 #define RLP_SERIALIZER_VER_MINOR 0
 #define RLP_SERIALIZER_VER_PATCH 0
 
+// Linkage of the core functions; rlp_single.h makes them static inline under RLP_STATIC
+#ifndef RLP_API
+#define RLP_API
+#endif
+
 typedef enum {
   RLP_TYPE_INVALID,
   RLP_TYPE_BYTE_ARRAY,
@@ -58,7 +67,7 @@ typedef enum {
   RLP_TYPE_INT512,
   RLP_TYPE_INT1024,
 } RlpType_t;
-#define RLP_TYPE_IS_INTEGER_TYPE(x) ((x) >= RLP_TYPE_INT8) && ((x) <= RLP_TYPE_INT1024)
+#define RLP_TYPE_IS_INTEGER_TYPE(x) (((x) >= RLP_TYPE_INT8) && ((x) <= RLP_TYPE_INT1024))
 
 
 // This is a scatter type
@@ -77,23 +86,143 @@ typedef enum {
   ERR_RLP_EBADARG,                  // Bad argument
   ERR_RLP_EILLEGALMEM,              // Memory access violation (overlapping buffers)
   ERR_RLP_ENOMEM,                   // Not enough memory
-  // The commented section of error codes below is reserved for decoding RLP payloads
-  // ERR_RLP_EINVAL,                   // Invalid RLP data
-  // ERR_RLP_EMSGSIZE,                 // RLP data exceeds size provided (insufficient buffer space)
-  // ERR_RLP_ENODATA,                  // Not enough data was provided
-  // ERR_RLP_ENOENT,                   // No entry was found
+  // Decoding RLP payloads
+  ERR_RLP_EINVAL,                   // Invalid RLP data
+  ERR_RLP_EMSGSIZE,                 // RLP data exceeds size provided (insufficient buffer space)
+  ERR_RLP_ENODATA,                  // Not enough data was provided
+  ERR_RLP_ENOENT,                   // No entry was found
+  ERR_RLP_EIO,                      // Output sink failed to write
   ERR_RLP_OK         =  0,          // No error
 } ERLPError_e;
 
 
 // Determine the correct RLP integer type based on size
-RlpType_t rlp_int_type_from_size(int s);
+RLP_API RlpType_t rlp_int_type_from_size(int s);
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const rlpElement);
+
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const *rlpElementsArr, size_t rplElementsLen);
+
+// Payloads of at least this many bytes are copied with non-temporal (streaming) stores.
+// Multi-megabyte copies then bypass the cache instead of evicting the working set of
+// other threads. Tune with rlp_set_stream_copy_threshold(); SIZE_MAX disables streaming.
+#ifndef RLP_STREAM_COPY_THRESHOLD
+#define RLP_STREAM_COPY_THRESHOLD (1024 * 1024)
+#endif
+RLP_API void rlp_set_stream_copy_threshold(size_t bytes);
+
+// Returns the exact number of bytes rlp_encode_element() produces, or 0 on bad argument
+RLP_API size_t rlp_element_encoded_len(const RlpElement_t *const rlpElement);
+
+// Returns the number of header bytes preceding a string or list payload of payloadLen bytes
+// (a single byte string below 0x80 has no header, callers handle that case themselves)
+RLP_API size_t rlp_header_len(size_t payloadLen);
 
+// Writes only the string (isList == false) or list header for a payload of payloadLen bytes
 // Returns length of output in bytes, or a negative error value
-int rlp_encode_element(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const rlpElement);
+RLP_API int rlp_encode_header(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, size_t payloadLen, bool isList);
 
+// Returns the exact number of bytes rlp_encode_uint64() produces for v
+RLP_API size_t rlp_uint64_encoded_len(uint64_t v);
+
+// Encodes a native integer as big endian with no leading zeroes
 // Returns length of output in bytes, or a negative error value
-int rlp_encode_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const RlpElement_t *const *rlpElementsArr, size_t rplElementsLen);
+RLP_API int rlp_encode_uint64(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, uint64_t v);
+
+// Returns the exact number of bytes rlp_encode_uint64_list() produces, 0 on bad argument
+RLP_API size_t rlp_uint64_list_encoded_len(const uint64_t *values, size_t valuesCnt);
+
+// Encodes a list of native integers, the same bytes as a list of rlp_encode_uint64() items
+// without an element per value. Lengths are computed four values at a time with AVX2 and
+// each value is packed with one SSSE3 byte shuffle, when compiled in (-mavx2 / -mssse3).
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_encode_uint64_list(void *rlpEncodedOutput, size_t rlpEncodedOutputLen, const uint64_t *values, size_t valuesCnt);
+
+
+// Gather output
+// Instead of copying every payload into one buffer, the encoding is described as
+// a list of segments (iovec style) that can be handed to writev() or a socket.
+// Headers and small items are staged in a caller provided scratch buffer,
+// payloads of RLP_GATHER_REF_THRESHOLD bytes or more are referenced in place
+// and must stay alive until the segments are consumed.
+#ifndef RLP_GATHER_REF_THRESHOLD
+#define RLP_GATHER_REF_THRESHOLD 256
+#endif
+
+typedef struct rlpGatherSeg {
+  const void   *buff;
+  size_t       len;
+} RlpGatherSeg_t;
+
+typedef struct rlpGather {
+  RlpGatherSeg_t *segs;       // caller provided segment array
+  size_t         segsCap;
+  size_t         segsCnt;
+  uint8_t        *scratch;    // caller provided staging area for headers and small items
+  size_t         scratchCap;
+  size_t         scratchLen;
+  size_t         totalLen;    // sum of all segment lengths
+} RlpGather_t;
+
+RLP_API void rlp_gather_init(RlpGather_t *g, RlpGatherSeg_t *segs, size_t segsCap, void *scratch, size_t scratchCap);
+
+// Reserves n bytes of scratch at the end of the output for the caller to fill in
+// Returns a pointer to the reserved bytes, or NULL if scratch or segments ran out
+RLP_API uint8_t *rlp_gather_reserve(RlpGather_t *g, size_t n);
+
+// Appends already encoded bytes by reference
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_raw(RlpGather_t *g, const void *buff, size_t len);
+
+// Appends a string or list header for a payload of payloadLen bytes
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_header(RlpGather_t *g, size_t payloadLen, bool isList);
+
+// Appends an encoded element, copying it to scratch or referencing its payload depending on size
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_element(RlpGather_t *g, const RlpElement_t *const rlpElement);
+
+// Copies all segments into one contiguous buffer
+// Returns length of output in bytes, or a negative error value
+RLP_API int rlp_gather_flatten(const RlpGather_t *g, void *rlpEncodedOutput, size_t rlpEncodedOutputLen);
+
+
+
+// Decoding
+// Decoded items are views into the encoded input, nothing is copied.
+// Decoding is strict: non-minimal headers and lengths are rejected as ERR_RLP_EINVAL.
+typedef struct rlpItem {
+  const uint8_t  *payload;     // points into the encoded input
+  size_t         payloadLen;
+  size_t         encodedLen;   // header + payload
+  bool           isList;
+} RlpItem_t;
+
+// Walks the items of a list payload in order
+typedef struct rlpCursor {
+  const uint8_t  *pos;
+  const uint8_t  *end;
+} RlpCursor_t;
+
+// Decodes the item at the start of rlpEncoded, trailing bytes are left alone
+// Returns the number of bytes the item occupies, or a negative error value
+RLP_API int rlp_decode_item(const void *rlpEncoded, size_t rlpEncodedLen, RlpItem_t *item);
+
+// Positions cur on the first item of a decoded list
+// Returns ERR_RLP_OK, or a negative error value
+RLP_API int rlp_cursor_init(RlpCursor_t *cur, const RlpItem_t *list);
+
+// Returns 1 and fills item, 0 once the list is exhausted, or a negative error value
+RLP_API int rlp_cursor_next(RlpCursor_t *cur, RlpItem_t *item);
+
+// Reads a canonical big endian integer of at most 8 bytes
+// Returns ERR_RLP_OK, or a negative error value
+RLP_API int rlp_decode_uint64(const RlpItem_t *item, uint64_t *v);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif
\ No newline at end of file
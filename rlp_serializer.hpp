@@ -0,0 +1,346 @@
+/**
+ * RLP Serializer - C++ Interface
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Header-only C++20 layer over the C API: move-only buffers whose memory comes
+ * from a std::pmr::memory_resource, std::span in and out, and decoded views in the
+ * spirit of std::string_view. Everything is inline and forwards to the C calls.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SERIALIZER_HPP_
+#define __RLP_SERIALIZER_HPP_
+
+#include "rlp_serializer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace rlp {
+
+/* -------------------------------------------------------------------------- */
+/*                                   Errors                                   */
+/* -------------------------------------------------------------------------- */
+
+enum class error : int {
+  unknown       = ERR_RLP_EUNKNOWN,
+  bad_arg       = ERR_RLP_EBADARG,
+  illegal_mem   = ERR_RLP_EILLEGALMEM,
+  no_mem        = ERR_RLP_ENOMEM,
+  invalid       = ERR_RLP_EINVAL,
+  msg_size      = ERR_RLP_EMSGSIZE,
+  no_data       = ERR_RLP_ENODATA,
+  no_entry      = ERR_RLP_ENOENT,
+  io            = ERR_RLP_EIO,
+  ok            = ERR_RLP_OK,
+};
+
+// Value or error, no exceptions; T must be default constructible
+template <class T>
+class result {
+public:
+  result(T value) : value_(std::move(value)), err_(error::ok) {}
+  result(error err) : value_(), err_(err) {}
+
+  bool has_value() const noexcept { return err_ == error::ok; }
+  explicit operator bool() const noexcept { return has_value(); }
+  error err() const noexcept { return err_; }
+
+  T &value() & noexcept { return value_; }
+  const T &value() const & noexcept { return value_; }
+  T &&value() && noexcept { return std::move(value_); }
+  T &operator*() & noexcept { return value_; }
+  T *operator->() noexcept { return &value_; }
+  const T *operator->() const noexcept { return &value_; }
+
+private:
+  T      value_;
+  error  err_;
+};
+
+// Maps a C return value (length or negative error) onto a result
+inline result<std::size_t> from_c(int ret) noexcept {
+  if(ret < 0)
+    return static_cast<error>(ret);
+  return static_cast<std::size_t>(ret);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Buffer                                   */
+/* -------------------------------------------------------------------------- */
+
+// Owning, move-only byte buffer. Memory comes from a memory_resource, so encode
+// output can be carved from a std::pmr::monotonic_buffer_resource arena.
+class buffer {
+public:
+  buffer() noexcept = default;
+
+  explicit buffer(std::size_t size, std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+    : mr_(mr), data_(size ? static_cast<std::uint8_t *>(mr->allocate(size, 1)) : nullptr), size_(size), cap_(size) {}
+
+  buffer(const buffer &) = delete;
+  buffer &operator=(const buffer &) = delete;
+
+  buffer(buffer &&other) noexcept
+    : mr_(other.mr_), data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)), cap_(std::exchange(other.cap_, 0)) {}
+
+  buffer &operator=(buffer &&other) noexcept {
+    if(this != &other) {
+      release();
+      mr_ = other.mr_;
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      cap_ = std::exchange(other.cap_, 0);
+    }
+    return *this;
+  }
+
+  ~buffer() { release(); }
+
+  std::uint8_t *data() noexcept { return data_; }
+  const std::uint8_t *data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  std::span<std::uint8_t> span() noexcept { return {data_, size_}; }
+  std::span<const std::uint8_t> span() const noexcept { return {data_, size_}; }
+  operator std::span<const std::uint8_t>() const noexcept { return span(); }
+  std::pmr::memory_resource *resource() const noexcept { return mr_; }
+
+  // Drops trailing bytes without reallocating
+  void shrink(std::size_t size) noexcept {
+    if(size < size_)
+      size_ = size;
+  }
+
+private:
+  void release() noexcept {
+    if(data_)
+      mr_->deallocate(data_, cap_, 1);
+    data_ = nullptr;
+  }
+
+  std::pmr::memory_resource  *mr_ = std::pmr::get_default_resource();
+  std::uint8_t               *data_ = nullptr;
+  std::size_t                size_ = 0;
+  std::size_t                cap_ = 0;     // allocated size, shrink() leaves it alone
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                  Elements                                  */
+/* -------------------------------------------------------------------------- */
+
+inline RlpElement_t bytes(std::span<const std::uint8_t> data) noexcept {
+  return RlpElement_t{RLP_TYPE_BYTE_ARRAY, data.size(), data.data()};
+}
+
+inline RlpElement_t bytes(std::string_view data) noexcept {
+  return RlpElement_t{RLP_TYPE_BYTE_ARRAY, data.size(), data.data()};
+}
+
+// Big endian integer stored in data; leading zeroes are trimmed while encoding
+inline RlpElement_t integer(std::span<const std::uint8_t> bigEndian) noexcept {
+  return RlpElement_t{rlp_int_type_from_size(static_cast<int>(bigEndian.size())), bigEndian.size(), bigEndian.data()};
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Encoding                                  */
+/* -------------------------------------------------------------------------- */
+
+inline std::size_t encoded_len(const RlpElement_t &element) noexcept {
+  return rlp_element_encoded_len(&element);
+}
+
+// 0 if any element is invalid
+inline std::size_t encoded_list_len(std::span<const RlpElement_t *const> elements) noexcept {
+  std::size_t payloadLen = 0;
+  for(const RlpElement_t *e : elements) {
+    std::size_t len = rlp_element_encoded_len(e);
+    if(len == 0)
+      return 0;
+    payloadLen += len;
+  }
+  return rlp_header_len(payloadLen) + payloadLen;
+}
+
+inline result<std::size_t> encode(std::span<std::uint8_t> out, const RlpElement_t &element) noexcept {
+  return from_c(rlp_encode_element(out.data(), out.size(), &element));
+}
+
+inline result<std::size_t> encode_list(std::span<std::uint8_t> out, std::span<const RlpElement_t *const> elements) noexcept {
+  return from_c(rlp_encode_list(out.data(), out.size(), elements.data(), elements.size()));
+}
+
+inline result<std::size_t> encode_uint64(std::span<std::uint8_t> out, std::uint64_t v) noexcept {
+  return from_c(rlp_encode_uint64(out.data(), out.size(), v));
+}
+
+inline result<std::size_t> encode_uint64_list(std::span<std::uint8_t> out, std::span<const std::uint64_t> values) noexcept {
+  return from_c(rlp_encode_uint64_list(out.data(), out.size(), values.data(), values.size()));
+}
+
+// Allocates exactly the encoded size from mr and encodes into it
+inline result<buffer> encode(const RlpElement_t &element,
+                             std::pmr::memory_resource *mr = std::pmr::get_default_resource()) {
+  std::size_t len = encoded_len(element);
+  if(len == 0)
+    return error::bad_arg;
+  buffer out(len, mr);
+  auto ret = encode(out.span(), element);
+  if(!ret)
+    return ret.err();
+  return out;
+}
+
+inline result<buffer> encode_list(std::span<const RlpElement_t *const> elements,
+                                  std::pmr::memory_resource *mr = std::pmr::get_default_resource()) {
+  std::size_t len = encoded_list_len(elements);
+  if(len == 0)
+    return error::bad_arg;
+  buffer out(len, mr);
+  auto ret = encode_list(out.span(), elements);
+  if(!ret)
+    return ret.err();
+  return out;
+}
+
+inline result<buffer> encode_uint64_list(std::span<const std::uint64_t> values,
+                                         std::pmr::memory_resource *mr = std::pmr::get_default_resource()) {
+  buffer out(rlp_uint64_list_encoded_len(values.data(), values.size()), mr);
+  auto ret = encode_uint64_list(out.span(), values);
+  if(!ret)
+    return ret.err();
+  return out;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Decoding                                  */
+/* -------------------------------------------------------------------------- */
+
+class list_range;
+
+// Decoded view of one item, references the encoded input like a std::string_view
+class item {
+public:
+  item() noexcept : raw_{nullptr, 0, 0, false} {}
+  explicit item(const RlpItem_t &raw) noexcept : raw_(raw) {}
+
+  bool is_list() const noexcept { return raw_.isList; }
+  std::span<const std::uint8_t> payload() const noexcept { return {raw_.payload, raw_.payloadLen}; }
+  std::string_view str() const noexcept {
+    return {reinterpret_cast<const char *>(raw_.payload), raw_.payloadLen};
+  }
+  // The whole encoding, header included
+  std::span<const std::uint8_t> encoded() const noexcept {
+    return {raw_.payload + raw_.payloadLen - raw_.encodedLen, raw_.encodedLen};
+  }
+  std::size_t size() const noexcept { return raw_.payloadLen; }
+  const RlpItem_t &raw() const noexcept { return raw_; }
+
+  result<std::uint64_t> as_uint64() const noexcept {
+    std::uint64_t v = 0;
+    int ret = rlp_decode_uint64(&raw_, &v);
+    if(ret < 0)
+      return static_cast<error>(ret);
+    return v;
+  }
+
+  // Children of a list; iterating a string yields nothing
+  list_range items() const noexcept;
+
+private:
+  RlpItem_t raw_;
+};
+
+// Single pass range over the children of a list. A malformed child ends the
+// iteration early and is reported by err().
+class list_range {
+public:
+  class iterator {
+  public:
+    using value_type = item;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() noexcept = default;
+    explicit iterator(list_range *range) noexcept : range_(range) { ++*this; }
+
+    const item &operator*() const noexcept { return cur_; }
+    const item *operator->() const noexcept { return &cur_; }
+    iterator &operator++() noexcept {
+      RlpItem_t raw;
+      int ret = rlp_cursor_next(&range_->cur_, &raw);
+      if(ret == 1)
+        cur_ = item(raw);
+      else {
+        if(ret < 0)
+          range_->err_ = static_cast<error>(ret);
+        range_ = nullptr;
+      }
+      return *this;
+    }
+    void operator++(int) noexcept { ++*this; }
+    bool operator==(std::default_sentinel_t) const noexcept { return range_ == nullptr; }
+
+  private:
+    list_range  *range_ = nullptr;
+    item        cur_;
+  };
+
+  explicit list_range(const RlpItem_t &list) noexcept {
+    if(!list.isList || rlp_cursor_init(&cur_, &list) < 0)
+      cur_.pos = cur_.end = nullptr;
+  }
+
+  iterator begin() noexcept { return iterator(this); }
+  std::default_sentinel_t end() const noexcept { return {}; }
+  error err() const noexcept { return err_; }
+
+private:
+  RlpCursor_t  cur_;
+  error        err_ = error::ok;
+};
+
+inline list_range item::items() const noexcept {
+  return list_range(raw_);
+}
+
+// Decodes the item at the front of data; trailing bytes are allowed, check
+// encoded().size() against data.size() when they are not
+inline result<item> decode(std::span<const std::uint8_t> data) noexcept {
+  RlpItem_t raw;
+  int ret = rlp_decode_item(data.data(), data.size(), &raw);
+  if(ret < 0)
+    return static_cast<error>(ret);
+  return item(raw);
+}
+
+} // namespace rlp
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * RLP Serializer - Withdrawals and Blob Sidecars
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Encoders for the post-Shanghai withdrawal list and the post-Cancun (EIP-4844)
+ * blob transaction network wrapper.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_sidecar.h"
+#include "rlp_copy.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+// Every blob is a long string of RLP_BLOB_LEN bytes: 0xba 0x02 0x00 0x00
+#define RLP_BLOB_HDR_LEN        4
+// Commitments and proofs are short strings: 0xb0 followed by 48 bytes
+#define RLP_KZG_ITEM_HDR        0xb0
+#define RLP_KZG_ITEM_LEN        (1 + RLP_KZG_COMMITMENT_LEN)
+
+static inline size_t rlp_withdrawal_payload_len(const RlpWithdrawal_t *w) {
+  return rlp_uint64_encoded_len(w->index) +
+         rlp_uint64_encoded_len(w->validatorIndex) +
+         1 + RLP_ADDRESS_LEN +
+         rlp_uint64_encoded_len(w->amount);
+}
+
+static size_t rlp_withdrawals_payload_len(const RlpWithdrawal_t *withdrawals, size_t withdrawalsCnt) {
+  size_t payloadLen = 0;
+  for(size_t i = 0; i < withdrawalsCnt; i++)
+    payloadLen += 1 + rlp_withdrawal_payload_len(&withdrawals[i]); // a withdrawal never exceeds 55 bytes
+  return payloadLen;
+}
+
+static inline bool rlp_blob_sidecar_check(const RlpBlobSidecar_t *sidecar) {
+  if(sidecar == NULL || sidecar->txPayloadBody == NULL || sidecar->txPayloadBodyLen == 0)
+    return false;
+  if(sidecar->blobsCnt && (sidecar->blobs == NULL || sidecar->commitments == NULL || sidecar->proofs == NULL))
+    return false;
+  return true;
+}
+
+static size_t rlp_blob_sidecar_payload_len(const RlpBlobSidecar_t *sidecar) {
+  size_t blobsLen = sidecar->blobsCnt * (RLP_BLOB_HDR_LEN + RLP_BLOB_LEN);
+  size_t kzgLen = sidecar->blobsCnt * RLP_KZG_ITEM_LEN;
+  return sidecar->txPayloadBodyLen +
+         rlp_header_len(blobsLen) + blobsLen +
+         2 * (rlp_header_len(kzgLen) + kzgLen);
+}
+
+// Fixed width 48 byte items; the constant size folds rlp_copy_small() down to its 32-64 class
+static uint8_t *rlp_write_kzg_list(uint8_t *out, const uint8_t (*items)[RLP_KZG_COMMITMENT_LEN], size_t cnt) {
+  size_t payloadLen = cnt * RLP_KZG_ITEM_LEN;
+  out += rlp_encode_header(out, rlp_header_len(payloadLen), payloadLen, true);
+  for(size_t i = 0; i < cnt; i++) {
+    out[0] = RLP_KZG_ITEM_HDR;
+    rlp_copy_small(out + 1, items[i], RLP_KZG_COMMITMENT_LEN);
+    out += RLP_KZG_ITEM_LEN;
+  }
+  return out;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+// Returns the exact number of bytes rlp_encode_withdrawals() produces
+size_t rlp_withdrawals_encoded_len(const RlpWithdrawal_t *withdrawals, size_t withdrawalsCnt)
+{
+  size_t payloadLen = rlp_withdrawals_payload_len(withdrawals, withdrawalsCnt);
+  return rlp_header_len(payloadLen) + payloadLen;
+}
+
+// Returns length of output in bytes, or a negative error value
+int rlp_encode_withdrawals(void *rlpEncodedOutput, size_t rlpEncodedOutputLen,
+                           const RlpWithdrawal_t *withdrawals, size_t withdrawalsCnt)
+{
+  if(rlpEncodedOutput == NULL || (withdrawals == NULL && withdrawalsCnt != 0))
+    return ERR_RLP_EBADARG;
+  size_t payloadLen = rlp_withdrawals_payload_len(withdrawals, withdrawalsCnt);
+  size_t rlpEncodedLen = rlp_header_len(payloadLen) + payloadLen;
+  if(rlpEncodedOutputLen < rlpEncodedLen)
+    return ERR_RLP_ENOMEM;
+
+  // Sizes are known, so every header is written in place and nothing is shifted afterwards
+  uint8_t *rlpOut = (uint8_t *) rlpEncodedOutput;
+  uint8_t *rlpEnd = rlpOut + rlpEncodedLen;
+  rlpOut += rlp_encode_header(rlpOut, rlpEncodedLen, payloadLen, true);
+  for(size_t i = 0; i < withdrawalsCnt; i++) {
+    const RlpWithdrawal_t *w = &withdrawals[i];
+    rlpOut += rlp_encode_header(rlpOut, rlpEnd - rlpOut, rlp_withdrawal_payload_len(w), true);
+    rlpOut += rlp_encode_uint64(rlpOut, rlpEnd - rlpOut, w->index);
+    rlpOut += rlp_encode_uint64(rlpOut, rlpEnd - rlpOut, w->validatorIndex);
+    rlpOut += rlp_encode_header(rlpOut, rlpEnd - rlpOut, RLP_ADDRESS_LEN, false);
+    rlp_copy_small(rlpOut, w->address, RLP_ADDRESS_LEN);
+    rlpOut += RLP_ADDRESS_LEN;
+    rlpOut += rlp_encode_uint64(rlpOut, rlpEnd - rlpOut, w->amount);
+  }
+  return rlpEncodedLen;
+}
+
+// Returns the exact number of bytes the encoded sidecar occupies, or 0 on bad argument
+size_t rlp_blob_sidecar_encoded_len(const RlpBlobSidecar_t *sidecar)
+{
+  if(!rlp_blob_sidecar_check(sidecar))
+    return 0;
+  size_t payloadLen = rlp_blob_sidecar_payload_len(sidecar);
+  return rlp_header_len(payloadLen) + payloadLen;
+}
+
+// Returns the number of scratch bytes rlp_gather_blob_sidecar() stages, or 0 on bad argument
+size_t rlp_blob_sidecar_scratch_len(const RlpBlobSidecar_t *sidecar)
+{
+  size_t rlpEncodedLen = rlp_blob_sidecar_encoded_len(sidecar);
+  if(rlpEncodedLen == 0)
+    return 0;
+  return rlpEncodedLen - sidecar->txPayloadBodyLen - sidecar->blobsCnt * RLP_BLOB_LEN;
+}
+
+// Returns length of output in bytes, or a negative error value
+int rlp_gather_blob_sidecar(RlpGather_t *g, const RlpBlobSidecar_t *sidecar)
+{
+  if(g == NULL || !rlp_blob_sidecar_check(sidecar))
+    return ERR_RLP_EBADARG;
+  size_t scratchLen = rlp_blob_sidecar_scratch_len(sidecar);
+  if(g->scratchCap - g->scratchLen < scratchLen ||
+     g->segsCap - g->segsCnt < RLP_BLOB_SIDECAR_GATHER_SEGS(sidecar->blobsCnt))
+    return ERR_RLP_ENOMEM;
+
+  // Space was checked above, none of the appends below can fail
+  size_t startLen = g->totalLen;
+  size_t blobsLen = sidecar->blobsCnt * (RLP_BLOB_HDR_LEN + RLP_BLOB_LEN);
+  rlp_gather_header(g, rlp_blob_sidecar_payload_len(sidecar), true);
+  rlp_gather_raw(g, sidecar->txPayloadBody, sidecar->txPayloadBodyLen);
+  rlp_gather_header(g, blobsLen, true);
+  for(size_t i = 0; i < sidecar->blobsCnt; i++) {
+    rlp_gather_header(g, RLP_BLOB_LEN, false);
+    rlp_gather_raw(g, sidecar->blobs[i], RLP_BLOB_LEN);
+  }
+  // Commitments and proofs are small, stage both lists in one scratch run
+  size_t kzgLen = sidecar->blobsCnt * RLP_KZG_ITEM_LEN;
+  uint8_t *kzgOut = rlp_gather_reserve(g, 2 * (rlp_header_len(kzgLen) + kzgLen));
+  kzgOut = rlp_write_kzg_list(kzgOut, sidecar->commitments, sidecar->blobsCnt);
+  rlp_write_kzg_list(kzgOut, sidecar->proofs, sidecar->blobsCnt);
+  return g->totalLen - startLen;
+}
@@ -0,0 +1,96 @@
+/**
+ * RLP Serializer - Withdrawals and Blob Sidecars
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Encoders for the post-Shanghai withdrawal list and the post-Cancun (EIP-4844)
+ * blob transaction network wrapper. Sizes are computed exactly up front and blob
+ * payloads are emitted through gather output so they are never copied.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SIDECAR_H_
+#define __RLP_SIDECAR_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_ADDRESS_LEN          20
+#define RLP_BLOB_LEN             131072  // 4096 field elements of 32 bytes
+#define RLP_KZG_COMMITMENT_LEN   48
+#define RLP_KZG_PROOF_LEN        48
+
+// EIP-4895 withdrawal: rlp([index, validatorIndex, address, amount])
+// Integers are native and are trimmed while encoding; amount is in Gwei.
+typedef struct rlpWithdrawal {
+  uint64_t     index;
+  uint64_t     validatorIndex;
+  uint8_t      address[RLP_ADDRESS_LEN];
+  uint64_t     amount;
+} RlpWithdrawal_t;
+
+// EIP-4844 network form: rlp([txPayloadBody, blobs, commitments, proofs])
+// txPayloadBody is the already encoded transaction list and is referenced as is.
+// The 0x03 transaction type byte is not part of this list, callers emit it first.
+typedef struct rlpBlobSidecar {
+  const void     *txPayloadBody;
+  size_t         txPayloadBodyLen;
+  const uint8_t  *const *blobs;                          // blobsCnt pointers to RLP_BLOB_LEN bytes
+  const uint8_t  (*commitments)[RLP_KZG_COMMITMENT_LEN]; // blobsCnt commitments
+  const uint8_t  (*proofs)[RLP_KZG_PROOF_LEN];           // blobsCnt proofs
+  size_t         blobsCnt;
+} RlpBlobSidecar_t;
+
+// Number of gather segments rlp_gather_blob_sidecar() needs at most
+#define RLP_BLOB_SIDECAR_GATHER_SEGS(blobsCnt)  (2 * (blobsCnt) + 3)
+
+
+// Returns the exact number of bytes rlp_encode_withdrawals() produces
+size_t rlp_withdrawals_encoded_len(const RlpWithdrawal_t *withdrawals, size_t withdrawalsCnt);
+
+// Encodes the withdrawal list in one pass, the list header is written first
+// Returns length of output in bytes, or a negative error value
+int rlp_encode_withdrawals(void *rlpEncodedOutput, size_t rlpEncodedOutputLen,
+                           const RlpWithdrawal_t *withdrawals, size_t withdrawalsCnt);
+
+// Returns the exact number of bytes the encoded sidecar occupies, or 0 on bad argument
+size_t rlp_blob_sidecar_encoded_len(const RlpBlobSidecar_t *sidecar);
+
+// Returns the number of scratch bytes rlp_gather_blob_sidecar() stages, or 0 on bad argument
+size_t rlp_blob_sidecar_scratch_len(const RlpBlobSidecar_t *sidecar);
+
+// Appends the sidecar to g. Blobs and the transaction body are referenced in place,
+// headers, commitments and proofs are staged in scratch.
+// Returns length of output in bytes, or a negative error value
+int rlp_gather_blob_sidecar(RlpGather_t *g, const RlpBlobSidecar_t *sidecar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * RLP Serializer - Single Header
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Core encoder and decoder as one include. Define RLP_STATIC to make every core
+ * function static inline in the including file, so small encodes inline and header
+ * forms fold for known sizes; or define RLP_IMPLEMENTATION in one file to link it.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Either, in every file:
+ *   #define RLP_STATIC
+ *   #include "rlp_single.h"
+ *
+ * or, in exactly one file (plain #include "rlp_single.h" everywhere else):
+ *   #define RLP_IMPLEMENTATION
+ *   #include "rlp_single.h"
+ *
+ * With RLP_STATIC each file has its own stream copy threshold, so
+ * rlp_set_stream_copy_threshold() applies to the calling file only. The other
+ * modules (sinks, sidecars, ENR, ...) link against the regular core and cannot
+ * be mixed with RLP_STATIC in the same file.
+ */
+
+#ifndef __RLP_SINGLE_H_
+#define __RLP_SINGLE_H_
+
+#if defined(RLP_STATIC)
+#define RLP_API static inline
+#endif
+
+#include "rlp_serializer.h"
+
+#endif
+
+#if (defined(RLP_STATIC) || defined(RLP_IMPLEMENTATION)) && !defined(__RLP_SINGLE_IMPL_)
+#define __RLP_SINGLE_IMPL_
+#include "rlp_serializer.c"
+#endif
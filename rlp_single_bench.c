@@ -0,0 +1,157 @@
+/**
+ * RLP Serializer - Single Header Benchmark
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Encodes legacy transactions field by field, the size where call overhead and
+ * header form selection matter. Build it twice and compare:
+ *   cc -O2 -DRLP_STATIC rlp_single_bench.c -o bench_inlined
+ *   cc -O2 rlp_single_bench.c rlp_serializer.c -o bench_linked
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_single.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_TXS         4096
+
+typedef struct {
+  uint64_t  nonce;
+  uint64_t  gasPrice;
+  uint64_t  gas;
+  uint8_t   to[20];
+  uint64_t  value;
+  uint8_t   data[68];
+  size_t    dataLen;
+  uint8_t   v;
+  uint8_t   r[32];
+  uint8_t   s[32];
+} BenchTx_t;
+
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static void fill(uint8_t *out, size_t len) {
+  for(size_t i = 0; i < len; i++)
+    out[i] = (uint8_t) rng();
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Elements are built per call, as an application encoding from its own structs would
+static int bench_encode(uint8_t *out, size_t outLen, const BenchTx_t *tx) {
+  RlpElement_t f[9] = {
+    { .type = RLP_TYPE_INT64, .len = 8, .buff = &tx->nonce },
+    { .type = RLP_TYPE_INT64, .len = 8, .buff = &tx->gasPrice },
+    { .type = RLP_TYPE_INT64, .len = 8, .buff = &tx->gas },
+    { .type = RLP_TYPE_BYTE_ARRAY, .len = 20, .buff = tx->to },
+    { .type = RLP_TYPE_INT64, .len = 8, .buff = &tx->value },
+    { .type = RLP_TYPE_BYTE_ARRAY, .len = tx->dataLen, .buff = tx->data },
+    { .type = RLP_TYPE_BYTE_ARRAY, .len = 1, .buff = &tx->v },
+    { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = tx->r },
+    { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = tx->s },
+  };
+  const RlpElement_t *ptrs[9];
+  for(size_t i = 0; i < 9; i++)
+    ptrs[i] = &f[i];
+  return rlp_encode_list(out, outLen, ptrs, 9);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  if(rounds <= 0) {
+    fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+    return 1;
+  }
+
+  BenchTx_t *txs = malloc(BENCH_TXS * sizeof(*txs));
+  uint8_t *out = malloc(BENCH_TXS * 256);
+  if(!txs || !out)
+    return 1;
+  for(size_t i = 0; i < BENCH_TXS; i++) {
+    BenchTx_t *tx = &txs[i];
+    tx->nonce = rng() % 5000;
+    tx->gasPrice = 1000000000ull + rng() % 100000000000ull;
+    tx->gas = rng() % 2 ? 21000 : 50000 + rng() % 200000;
+    tx->value = rng() % 3 ? rng() >> 4 : 0;
+    tx->dataLen = rng() % 2 ? 0 : 68;   // plain transfer or ERC-20 transfer call
+    tx->v = 0x25 + rng() % 2;
+    fill(tx->to, sizeof(tx->to));
+    fill(tx->data, sizeof(tx->data));
+    fill(tx->r, sizeof(tx->r));
+    fill(tx->s, sizeof(tx->s));
+  }
+
+  // Touch everything once before timing
+  size_t bytes = 0;
+  for(size_t i = 0; i < BENCH_TXS; i++)
+    bytes += (size_t) bench_encode(out + i * 256, 256, &txs[i]);
+
+  double best = 0;
+  uint64_t check = 0;
+  for(int r = 0; r < rounds; r++) {
+    double t0 = now_ns();
+    for(size_t i = 0; i < BENCH_TXS; i++) {
+      int len = bench_encode(out + i * 256, 256, &txs[i]);
+      if(len < 0)
+        return 1;
+      check += (uint64_t) len;
+    }
+    double ns = now_ns() - t0;
+    if(r == 0 || ns < best)
+      best = ns;
+  }
+
+#if defined(RLP_STATIC)
+  const char *mode = "inlined (RLP_STATIC)";
+#else
+  const char *mode = "linked";
+#endif
+  printf("%s: %.1f ns/tx, %zu B average, best of %d rounds (%llu)\n", mode, best / BENCH_TXS,
+         bytes / BENCH_TXS, rounds, (unsigned long long) (check / (uint64_t) rounds));
+  free(out);
+  free(txs);
+  return 0;
+}
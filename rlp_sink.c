@@ -0,0 +1,167 @@
+/**
+ * RLP Serializer - Output Sinks
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Generic sink helpers and the blocking file descriptor sink.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_sink.h"
+#include "rlp_copy.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+uint8_t *rlp_sink_reserve(RlpSink_t *sink, size_t n)
+{
+  if(sink->cap - sink->len >= n)
+    return sink->buff + sink->len;
+  // A flush may carry bytes over into the new window (see the io_uring direct mode)
+  if(n > sink->cap || sink->flush(sink) < 0 || sink->cap - sink->len < n)
+    return NULL;
+  return sink->buff + sink->len;
+}
+
+// Returns len, or a negative error value
+int rlp_sink_write(RlpSink_t *sink, const void *data, size_t len)
+{
+  const uint8_t *in = (const uint8_t *) data;
+  size_t remaining = len;
+  while(remaining) {
+    if(sink->len == sink->cap) {
+      int ret = sink->flush(sink);
+      if(ret < 0)
+        return ret;
+    }
+    size_t chunk = sink->cap - sink->len;
+    if(chunk > remaining)
+      chunk = remaining;
+    rlp_copy_payload(sink->buff + sink->len, in, chunk);
+    sink->len += chunk;
+    in += chunk;
+    remaining -= chunk;
+  }
+  return len;
+}
+
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_gather(RlpSink_t *sink, const RlpGather_t *g)
+{
+  for(size_t i = 0; i < g->segsCnt; i++) {
+    int ret = rlp_sink_write(sink, g->segs[i].buff, g->segs[i].len);
+    if(ret < 0)
+      return ret;
+  }
+  return g->totalLen;
+}
+
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_encode_header(RlpSink_t *sink, size_t payloadLen, bool isList)
+{
+  size_t hdrLen = rlp_header_len(payloadLen);
+  uint8_t *out = rlp_sink_reserve(sink, hdrLen);
+  if(out == NULL)
+    return ERR_RLP_EIO;
+  rlp_encode_header(out, hdrLen, payloadLen, isList);
+  rlp_sink_commit(sink, hdrLen);
+  return hdrLen;
+}
+
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_encode_element(RlpSink_t *sink, const RlpElement_t *const rlpElement)
+{
+  size_t rlpEncodedLen = rlp_element_encoded_len(rlpElement);
+  if(sink == NULL || rlpEncodedLen == 0)
+    return ERR_RLP_EBADARG;
+  if(rlpEncodedLen <= sink->cap - sink->len || rlpEncodedLen <= sink->cap / 2) {
+    // Common case: encode in place in the window
+    uint8_t *out = rlp_sink_reserve(sink, rlpEncodedLen);
+    if(out == NULL)
+      return ERR_RLP_EIO;
+    int ret = rlp_encode_element(out, rlpEncodedLen, rlpElement);
+    if(ret < 0)
+      return ret;
+    rlp_sink_commit(sink, ret);
+    return ret;
+  }
+  if(RLP_TYPE_IS_INTEGER_TYPE(rlpElement->type)) {
+    // Tiny window; integers top out at 128 bytes so stage them on the stack
+    uint8_t tmp[1 + 1 + 128];
+    int ret = rlp_encode_element(tmp, sizeof(tmp), rlpElement);
+    return ret < 0 ? ret : rlp_sink_write(sink, tmp, ret);
+  }
+  // Payload larger than a window: header in place, payload streamed across windows
+  int hdrLen = rlp_sink_encode_header(sink, rlpElement->len, false);
+  if(hdrLen < 0)
+    return hdrLen;
+  int ret = rlp_sink_write(sink, rlpElement->buff, rlpElement->len);
+  if(ret < 0)
+    return ret;
+  return hdrLen + ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  fd Sink                                   */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_fd_sink_flush(RlpSink_t *sink)
+{
+  RlpFdSink_t *s = (RlpFdSink_t *) sink;
+  size_t off = 0;
+  while(off < sink->len) {
+    ssize_t ret = write(s->fd, sink->buff + off, sink->len - off);
+    if(ret < 0 && errno == EINTR)
+      continue;
+    if(ret <= 0)
+      return ERR_RLP_EIO;
+    off += ret;
+  }
+  sink->len = 0;
+  return ERR_RLP_OK;
+}
+
+static int rlp_fd_sink_close(RlpSink_t *sink)
+{
+  return rlp_fd_sink_flush(sink);
+}
+
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_fd_sink_init(RlpFdSink_t *s, int fd, void *buff, size_t buffLen)
+{
+  if(s == NULL || fd < 0 || buff == NULL || buffLen == 0)
+    return ERR_RLP_EBADARG;
+  s->fd = fd;
+  s->sink.buff = buff;
+  s->sink.len = 0;
+  s->sink.cap = buffLen;
+  s->sink.flush = rlp_fd_sink_flush;
+  s->sink.close = rlp_fd_sink_close;
+  return ERR_RLP_OK;
+}
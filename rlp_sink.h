@@ -0,0 +1,104 @@
+/**
+ * RLP Serializer - Output Sinks
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * A sink owns the output buffer. Encoders write straight into its current
+ * window and the sink decides what happens to full windows (write them out,
+ * compress them, ...), so encoded bytes are never staged in a second buffer.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SINK_H_
+#define __RLP_SINK_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rlpSink RlpSink_t;
+struct rlpSink {
+  uint8_t      *buff;     // current output window
+  size_t       len;       // bytes written to the window so far
+  size_t       cap;       // window size
+  // Hands buff[0..len) downstream and installs a fresh window; at most half a window
+  // worth of bytes may be carried over into it (len != 0 afterwards)
+  int          (*flush)(RlpSink_t *sink);
+  // Flushes, waits for every outstanding write and releases the sink
+  int          (*close)(RlpSink_t *sink);
+};
+
+// Blocking write(2) sink, the baseline the asynchronous sinks are measured against
+typedef struct rlpFdSink {
+  RlpSink_t    sink;      // must stay first
+  int          fd;
+} RlpFdSink_t;
+
+
+// Returns a pointer to n contiguous bytes of output space, flushing the window if needed.
+// Nothing is written until rlp_sink_commit(). Returns NULL if the flush failed or n does not fit
+// in a fresh window; half a window is always available after a flush.
+uint8_t *rlp_sink_reserve(RlpSink_t *sink, size_t n);
+
+// Marks n reserved bytes as written
+static inline void rlp_sink_commit(RlpSink_t *sink, size_t n) {
+  sink->len += n;
+}
+
+// Copies len bytes to the sink, spanning windows as needed
+// Returns len, or a negative error value
+int rlp_sink_write(RlpSink_t *sink, const void *data, size_t len);
+
+// Streams every segment of a gather list to the sink
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_gather(RlpSink_t *sink, const RlpGather_t *g);
+
+// Encodes an element directly into the sink window, large payloads are copied across windows
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_encode_element(RlpSink_t *sink, const RlpElement_t *const rlpElement);
+
+// Writes a string or list header for a payload of payloadLen bytes
+// Returns length of output in bytes, or a negative error value
+int rlp_sink_encode_header(RlpSink_t *sink, size_t payloadLen, bool isList);
+
+static inline int rlp_sink_flush(RlpSink_t *sink) {
+  return sink->flush(sink);
+}
+
+static inline int rlp_sink_close(RlpSink_t *sink) {
+  return sink->close(sink);
+}
+
+// buff is caller owned and used as the only window, fd is not closed by rlp_sink_close()
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_fd_sink_init(RlpFdSink_t *s, int fd, void *buff, size_t buffLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
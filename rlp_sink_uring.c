@@ -0,0 +1,316 @@
+/**
+ * RLP Serializer - io_uring File Sink
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Talks to the kernel through the raw io_uring syscalls, no liburing needed.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "rlp_sink_uring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+#define RLP_URING_PAGE 4096
+
+struct rlpUringPending {
+  uint64_t     fileOff;
+  uint32_t     len;
+  uint32_t     done;
+};
+
+static inline int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+  return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int sys_io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static inline int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nrArgs) {
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+static inline uint8_t *rlp_uring_buf(RlpUringSink_t *s, unsigned idx) {
+  return s->bufs + (size_t) idx * s->bufSz;
+}
+
+// Queues a fixed-buffer write and hands it to the kernel.
+// The SQ has an entry per buffer, so it cannot be full here.
+static int rlp_uring_submit(RlpUringSink_t *s, unsigned idx)
+{
+  struct rlpUringPending *p = &s->pending[idx];
+  unsigned tail = *s->sqTail;
+  unsigned slot = tail & s->sqMask;
+  struct io_uring_sqe *sqe = &s->sqes[slot];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_WRITE_FIXED;
+  sqe->fd = s->fd;
+  sqe->addr = (uint64_t) (uintptr_t) (rlp_uring_buf(s, idx) + p->done);
+  sqe->len = p->len - p->done;
+  sqe->off = p->fileOff + p->done;
+  sqe->buf_index = 0;
+  sqe->user_data = idx;
+  s->sqArray[slot] = slot;
+  __atomic_store_n(s->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  for(;;) {
+    int ret = sys_io_uring_enter(s->ringFd, 1, 0, 0);
+    if(ret >= 0)
+      return ERR_RLP_OK;
+    if(errno != EINTR && errno != EAGAIN)
+      return ERR_RLP_EIO;
+  }
+}
+
+// Recycles completed buffers; with wait set, blocks until at least one completes
+static int rlp_uring_reap(RlpUringSink_t *s, bool wait)
+{
+  for(;;) {
+    unsigned head = *s->cqHead;
+    unsigned tail = __atomic_load_n(s->cqTail, __ATOMIC_ACQUIRE);
+    if(head == tail) {
+      if(!wait)
+        return ERR_RLP_OK;
+      if(sys_io_uring_enter(s->ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+        return ERR_RLP_EIO;
+      continue;
+    }
+    for(; head != tail; head++) {
+      struct io_uring_cqe *cqe = &s->cqes[head & s->cqMask];
+      unsigned idx = (unsigned) cqe->user_data;
+      struct rlpUringPending *p = &s->pending[idx];
+      if(cqe->res > 0 && p->done + cqe->res < p->len) {
+        // Short write, queue the rest of the buffer again
+        p->done += cqe->res;
+        if(rlp_uring_submit(s, idx) == ERR_RLP_OK)
+          continue;
+        // The tail is lost, fail the sink rather than recycle the buffer silently
+        if(s->err == ERR_RLP_OK)
+          s->err = ERR_RLP_EIO;
+      }
+      if(cqe->res <= 0 && s->err == ERR_RLP_OK)
+        s->err = ERR_RLP_EIO;
+      s->freeList[s->freeCnt++] = idx;
+    }
+    __atomic_store_n(s->cqHead, tail, __ATOMIC_RELEASE);
+    return s->err;
+  }
+}
+
+static int rlp_uring_sink_flush(RlpSink_t *sink)
+{
+  RlpUringSink_t *s = (RlpUringSink_t *) sink;
+  if(s->err != ERR_RLP_OK)
+    return s->err;
+  if(sink->len == 0)
+    return ERR_RLP_OK;
+
+  // Direct I/O only takes whole blocks, the unaligned tail moves to the next window
+  size_t submitLen = sink->len;
+  if(s->flags & RLP_URING_DIRECT)
+    submitLen &= ~((size_t) RLP_URING_DIRECT_ALIGN - 1);
+  if(submitLen == 0)
+    return ERR_RLP_OK;
+
+  unsigned idx = s->cur;
+  s->pending[idx].fileOff = s->fileOff;
+  s->pending[idx].len = submitLen;
+  s->pending[idx].done = 0;
+  if(rlp_uring_submit(s, idx) < 0)
+    return s->err = ERR_RLP_EIO;
+  s->fileOff += submitLen;
+
+  // Pick up whatever finished meanwhile, only block when every buffer is in flight
+  int ret = rlp_uring_reap(s, false);
+  while(ret == ERR_RLP_OK && s->freeCnt == 0)
+    ret = rlp_uring_reap(s, true);
+  if(ret < 0)
+    return ret;
+
+  s->cur = s->freeList[--s->freeCnt];
+  size_t tailLen = sink->len - submitLen;
+  memcpy(rlp_uring_buf(s, s->cur), rlp_uring_buf(s, idx) + submitLen, tailLen);
+  sink->buff = rlp_uring_buf(s, s->cur);
+  sink->len = tailLen;
+  return ERR_RLP_OK;
+}
+
+static void rlp_uring_sink_release(RlpUringSink_t *s)
+{
+  if(s->ringFd >= 0)
+    close(s->ringFd);
+  if(s->sqes)
+    munmap(s->sqes, s->sqesSz);
+  if(s->cqRing && s->cqRing != s->sqRing)
+    munmap(s->cqRing, s->cqRingSz);
+  if(s->sqRing)
+    munmap(s->sqRing, s->sqRingSz);
+  rlp_mem_unmap(&s->bufsMap);
+  free(s->freeList);
+  if(s->fd >= 0)
+    close(s->fd);
+  s->ringFd = s->fd = -1;
+  s->sqes = NULL;
+  s->sqRing = s->cqRing = NULL;
+  s->bufs = NULL;
+  s->freeList = NULL;
+}
+
+static int rlp_uring_sink_close(RlpSink_t *sink)
+{
+  RlpUringSink_t *s = (RlpUringSink_t *) sink;
+  int ret = rlp_uring_sink_flush(sink);
+  while(s->freeCnt + 1 < s->bufsCnt && rlp_uring_reap(s, true) == ERR_RLP_OK)
+    ; // drain, cur is the only buffer not on the free list
+  if(ret == ERR_RLP_OK)
+    ret = s->err;
+
+  // Unaligned direct I/O remainder: drop O_DIRECT for the final write
+  if(ret == ERR_RLP_OK && sink->len) {
+    if(s->flags & RLP_URING_DIRECT)
+      fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) & ~O_DIRECT);
+    size_t off = 0;
+    while(off < sink->len) {
+      ssize_t n = pwrite(s->fd, sink->buff + off, sink->len - off, s->fileOff + off);
+      if(n < 0 && errno == EINTR)
+        continue;
+      if(n <= 0) {
+        ret = ERR_RLP_EIO;
+        break;
+      }
+      off += n;
+    }
+  }
+  rlp_uring_sink_release(s);
+  return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+// Returns ERR_RLP_OK, ERR_RLP_EIO if io_uring is unavailable, or a negative error value
+int rlp_uring_sink_open(RlpUringSink_t *s, const char *path, size_t bufSz, unsigned bufsCnt, unsigned flags)
+{
+  if(s == NULL || path == NULL || bufSz == 0 || bufsCnt < 2 || bufsCnt > UINT16_MAX)
+    return ERR_RLP_EBADARG;
+  memset(s, 0, sizeof(*s));
+  s->fd = s->ringFd = -1;
+  s->flags = flags;
+  if((flags & RLP_URING_DIRECT) && bufSz < 2 * RLP_URING_DIRECT_ALIGN)
+    bufSz = 2 * RLP_URING_DIRECT_ALIGN; // the carried over tail must stay under half a window
+  s->bufSz = (bufSz + RLP_URING_PAGE - 1) & ~((size_t) RLP_URING_PAGE - 1);
+  s->bufsCnt = bufsCnt;
+
+  int openFlags = O_WRONLY | O_CREAT | O_TRUNC | ((flags & RLP_URING_DIRECT) ? O_DIRECT : 0);
+  if((s->fd = open(path, openFlags, 0644)) < 0)
+    return ERR_RLP_EIO;
+
+  // Buffers and per-buffer bookkeeping; buffers are faulted in now so the first flush does not stall
+  unsigned memFlags = RLP_MEM_PREFAULT | ((flags & RLP_URING_HUGEPAGES) ? RLP_MEM_HUGEPAGES : 0);
+  s->freeList = malloc(bufsCnt * (sizeof(unsigned) + sizeof(struct rlpUringPending)));
+  if(s->freeList == NULL || rlp_mem_map(&s->bufsMap, s->bufSz * bufsCnt, memFlags) < 0) {
+    rlp_uring_sink_release(s);
+    return ERR_RLP_ENOMEM;
+  }
+  s->bufs = s->bufsMap.base;
+  s->pending = (struct rlpUringPending *) (s->freeList + bufsCnt);
+
+  // Ring setup, one SQ entry per buffer
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  if((s->ringFd = sys_io_uring_setup(bufsCnt, &params)) < 0)
+    goto fail;
+  s->sqRingSz = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  s->cqRingSz = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP) {
+    if(s->cqRingSz > s->sqRingSz)
+      s->sqRingSz = s->cqRingSz;
+    s->cqRingSz = s->sqRingSz;
+  }
+  s->sqRing = mmap(NULL, s->sqRingSz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ringFd, IORING_OFF_SQ_RING);
+  if(s->sqRing == MAP_FAILED) {
+    s->sqRing = NULL;
+    goto fail;
+  }
+  if(params.features & IORING_FEAT_SINGLE_MMAP)
+    s->cqRing = s->sqRing;
+  else {
+    s->cqRing = mmap(NULL, s->cqRingSz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ringFd, IORING_OFF_CQ_RING);
+    if(s->cqRing == MAP_FAILED) {
+      s->cqRing = NULL;
+      goto fail;
+    }
+  }
+  s->sqesSz = params.sq_entries * sizeof(struct io_uring_sqe);
+  s->sqes = mmap(NULL, s->sqesSz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ringFd, IORING_OFF_SQES);
+  if(s->sqes == MAP_FAILED) {
+    s->sqes = NULL;
+    goto fail;
+  }
+  uint8_t *sq = s->sqRing;
+  uint8_t *cq = s->cqRing;
+  s->sqTail  = (unsigned *) (sq + params.sq_off.tail);
+  s->sqMask  = *(unsigned *) (sq + params.sq_off.ring_mask);
+  s->sqArray = (unsigned *) (sq + params.sq_off.array);
+  s->cqHead  = (unsigned *) (cq + params.cq_off.head);
+  s->cqTail  = (unsigned *) (cq + params.cq_off.tail);
+  s->cqMask  = *(unsigned *) (cq + params.cq_off.ring_mask);
+  s->cqes    = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+  // Register the buffers once so the kernel does not pin pages on every write.
+  // They are one contiguous region, registered as fixed buffer 0.
+  struct iovec iov = { .iov_base = s->bufs, .iov_len = s->bufSz * bufsCnt };
+  if(sys_io_uring_register(s->ringFd, IORING_REGISTER_BUFFERS, &iov, 1) < 0)
+    goto fail;
+
+  for(unsigned i = 1; i < bufsCnt; i++)
+    s->freeList[s->freeCnt++] = i;
+  s->cur = 0;
+  s->sink.buff = rlp_uring_buf(s, 0);
+  s->sink.len = 0;
+  s->sink.cap = s->bufSz;
+  s->sink.flush = rlp_uring_sink_flush;
+  s->sink.close = rlp_uring_sink_close;
+  return ERR_RLP_OK;
+
+fail:
+  rlp_uring_sink_release(s);
+  return ERR_RLP_EIO;
+}
@@ -0,0 +1,93 @@
+/**
+ * RLP Serializer - io_uring File Sink
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Linux only. Output windows are page aligned buffers registered with an io_uring
+ * instance; a full window is submitted as a fixed-buffer write and the encoder moves
+ * on to the next free buffer right away. It only waits when every buffer is in flight.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SINK_URING_H_
+#define __RLP_SINK_URING_H_
+
+#include "rlp_sink.h"
+#include "rlp_arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_URING_DIRECT      0x1   // O_DIRECT: exported data bypasses the page cache
+#define RLP_URING_HUGEPAGES   0x2   // back the buffers with 2 MB pages, see rlp_mem_map()
+#define RLP_URING_DIRECT_ALIGN 4096 // write size/offset alignment required in direct mode
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct rlpUringPending;
+
+typedef struct rlpUringSink {
+  RlpSink_t               sink;        // must stay first
+  int                     fd;
+  int                     ringFd;
+  unsigned                flags;
+  int                     err;         // first write error, reported by flush and close
+  uint64_t                fileOff;     // file offset of the next submitted window
+  // Buffers
+  RlpMapping_t            bufsMap;     // pre-faulted, registered with the ring
+  uint8_t                 *bufs;       // bufsCnt * bufSz bytes
+  size_t                  bufSz;
+  unsigned                bufsCnt;
+  unsigned                cur;         // buffer backing the current window
+  unsigned                freeCnt;
+  unsigned                *freeList;
+  struct rlpUringPending  *pending;    // per buffer write state while in flight
+  // Rings
+  void                    *sqRing;
+  size_t                  sqRingSz;
+  void                    *cqRing;
+  size_t                  cqRingSz;
+  struct io_uring_sqe     *sqes;
+  size_t                  sqesSz;
+  unsigned                *sqTail;
+  unsigned                *sqArray;
+  unsigned                sqMask;
+  unsigned                *cqHead;
+  unsigned                *cqTail;
+  unsigned                cqMask;
+  struct io_uring_cqe     *cqes;
+} RlpUringSink_t;
+
+
+// Creates (truncating) path and sets up bufsCnt buffers of bufSz bytes (rounded up to whole pages).
+// Returns ERR_RLP_OK, ERR_RLP_EIO if io_uring is unavailable, or a negative error value
+int rlp_uring_sink_open(RlpUringSink_t *s, const char *path, size_t bufSz, unsigned bufsCnt, unsigned flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
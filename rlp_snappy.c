@@ -0,0 +1,560 @@
+/**
+ * RLP Serializer - Snappy Compression
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Raw and framed Snappy with a single hash table matcher per 64 KB block.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_snappy.h"
+#include <pthread.h>
+#include <string.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                             Internal Constants                             */
+/* -------------------------------------------------------------------------- */
+
+#define RLP_SNAPPY_TABLE        (1 << 14)   // hash table entries for a full block
+#define RLP_SNAPPY_MARGIN       15          // input tail emitted as a literal, keeps 4 byte loads in bounds
+#define RLP_SNAPPY_CHUNK_DATA   0x00
+#define RLP_SNAPPY_CHUNK_RAW    0x01
+#define RLP_SNAPPY_CHUNK_PAD    0xfe
+#define RLP_SNAPPY_CHUNK_ID     0xff
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define RLP_SNAPPY_LE 1
+#endif
+
+static const uint8_t rlpSnappyStreamId[RLP_SNAPPY_STREAM_HDR] = {
+  RLP_SNAPPY_CHUNK_ID, 0x06, 0x00, 0x00, 's', 'N', 'a', 'P', 'p', 'Y'
+};
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+static inline uint32_t rlp_snappy_load32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t rlp_snappy_get_le(const uint8_t *p, size_t n) {
+  uint32_t v = 0;
+  for(size_t i = 0; i < n; i++)
+    v |= (uint32_t) p[i] << (8 * i);
+  return v;
+}
+
+static inline void rlp_snappy_put_le(uint8_t *p, uint32_t v, size_t n) {
+  for(size_t i = 0; i < n; i++, v >>= 8)
+    p[i] = (uint8_t) v;
+}
+
+static inline uint8_t *rlp_snappy_put_varint(uint8_t *p, uint32_t v) {
+  while(v >= 0x80) {
+    *p++ = (uint8_t) (v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t) v;
+  return p;
+}
+
+// Returns bytes consumed, or 0 on a truncated or oversized varint
+static size_t rlp_snappy_get_varint(const uint8_t *p, size_t len, uint32_t *v) {
+  uint64_t r = 0;
+  for(size_t i = 0; i < len && i < 5; i++) {
+    r |= (uint64_t) (p[i] & 0x7f) << (7 * i);
+    if(!(p[i] & 0x80)) {
+      if(r > UINT32_MAX)
+        return 0;
+      *v = (uint32_t) r;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// Framed chunks carry a rotated and offset CRC so that CRCs of CRCs do not collide
+static inline uint32_t rlp_snappy_mask(uint32_t crc) {
+  return ((crc >> 15) | (crc << 17)) + 0xa282ead8u;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   CRC-32C                                  */
+/* -------------------------------------------------------------------------- */
+
+#if !defined(__SSE4_2__)
+static uint32_t rlpCrc32cTable[8][256];
+static pthread_once_t rlpCrc32cOnce = PTHREAD_ONCE_INIT;
+
+// Slicing by 8: table k advances the CRC of a byte followed by k zero bytes
+static void rlp_crc32c_init(void) {
+  for(uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for(int k = 0; k < 8; k++)
+      c = (c >> 1) ^ (0x82f63b78u & (0u - (c & 1)));
+    rlpCrc32cTable[0][i] = c;
+  }
+  for(uint32_t i = 0; i < 256; i++)
+    for(int k = 1; k < 8; k++)
+      rlpCrc32cTable[k][i] = (rlpCrc32cTable[k - 1][i] >> 8) ^ rlpCrc32cTable[0][rlpCrc32cTable[k - 1][i] & 0xff];
+}
+#endif
+
+uint32_t rlp_crc32c(uint32_t crc, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+  uint32_t c = ~crc;
+#if defined(__SSE4_2__)
+  uint64_t c64 = c;
+  for(; len >= 8; p += 8, len -= 8) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    c64 = _mm_crc32_u64(c64, w);
+  }
+  c = (uint32_t) c64;
+  for(; len; p++, len--)
+    c = _mm_crc32_u8(c, *p);
+#else
+  pthread_once(&rlpCrc32cOnce, rlp_crc32c_init);
+#if defined(RLP_SNAPPY_LE)
+  for(; len >= 8; p += 8, len -= 8) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    w ^= c;
+    c = rlpCrc32cTable[7][w & 0xff] ^ rlpCrc32cTable[6][(w >> 8) & 0xff] ^
+        rlpCrc32cTable[5][(w >> 16) & 0xff] ^ rlpCrc32cTable[4][(w >> 24) & 0xff] ^
+        rlpCrc32cTable[3][(w >> 32) & 0xff] ^ rlpCrc32cTable[2][(w >> 40) & 0xff] ^
+        rlpCrc32cTable[1][(w >> 48) & 0xff] ^ rlpCrc32cTable[0][w >> 56];
+  }
+#endif
+  for(; len; p++, len--)
+    c = (c >> 8) ^ rlpCrc32cTable[0][(c ^ *p) & 0xff];
+#endif
+  return ~c;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Compression                                */
+/* -------------------------------------------------------------------------- */
+
+static inline uint32_t rlp_snappy_hash(const uint8_t *p, int shift) {
+  return (rlp_snappy_load32(p) * 0x1e35a7bdu) >> shift;
+}
+
+// Length of the common prefix of a and b, where b is ahead of a and ends at end
+static inline size_t rlp_snappy_match_len(const uint8_t *a, const uint8_t *b, const uint8_t *end) {
+  size_t n = 0;
+#if defined(RLP_SNAPPY_LE)
+  while(b + n + 8 <= end) {
+    uint64_t x, y;
+    memcpy(&x, a + n, sizeof(x));
+    memcpy(&y, b + n, sizeof(y));
+    if(x != y)
+      return n + (__builtin_ctzll(x ^ y) >> 3);
+    n += 8;
+  }
+#endif
+  while(b + n < end && a[n] == b[n])
+    n++;
+  return n;
+}
+
+static uint8_t *rlp_snappy_emit_literal(uint8_t *op, const uint8_t *lit, size_t len) {
+  size_t n = len - 1;
+  if(n < 60)
+    *op++ = (uint8_t) (n << 2);
+  else {
+    size_t bytes = n < 0x100 ? 1 : n < 0x10000 ? 2 : n < 0x1000000 ? 3 : 4;
+    *op++ = (uint8_t) ((59 + bytes) << 2);
+    rlp_snappy_put_le(op, (uint32_t) n, bytes);
+    op += bytes;
+  }
+  memcpy(op, lit, len);
+  return op + len;
+}
+
+// 4 <= len <= 64
+static inline uint8_t *rlp_snappy_emit_copy_upto64(uint8_t *op, size_t off, size_t len) {
+  if(len < 12 && off < 2048) {
+    *op++ = (uint8_t) (1 | ((len - 4) << 2) | ((off >> 8) << 5));
+    *op++ = (uint8_t) off;
+  } else {
+    *op++ = (uint8_t) (2 | ((len - 1) << 2));
+    *op++ = (uint8_t) off;
+    *op++ = (uint8_t) (off >> 8);
+  }
+  return op;
+}
+
+static uint8_t *rlp_snappy_emit_copy(uint8_t *op, size_t off, size_t len) {
+  while(len >= 68) {
+    op = rlp_snappy_emit_copy_upto64(op, off, 64);
+    len -= 64;
+  }
+  // Leave at least 4 bytes for the last copy
+  if(len > 64) {
+    op = rlp_snappy_emit_copy_upto64(op, off, 60);
+    len -= 60;
+  }
+  return rlp_snappy_emit_copy_upto64(op, off, len);
+}
+
+// Compresses one block of at most RLP_SNAPPY_BLOCK bytes into an element stream.
+// Positions that find no match are probed ever more sparsely, so incompressible
+// input is skipped over quickly.
+static uint8_t *rlp_snappy_compress_block(const uint8_t *in, size_t n, uint8_t *op, uint16_t *table) {
+  const uint8_t *ip = in, *end = in + n, *nextEmit = in;
+  size_t tableSize = 256;
+  int shift = 32 - 8;
+  while(tableSize < RLP_SNAPPY_TABLE && tableSize < n) {
+    tableSize <<= 1;
+    shift--;
+  }
+  memset(table, 0, tableSize * sizeof(*table));
+
+  if(n >= RLP_SNAPPY_MARGIN) {
+    const uint8_t *ipLimit = end - RLP_SNAPPY_MARGIN;
+    uint32_t nextHash = rlp_snappy_hash(++ip, shift);
+    for(;;) {
+      // Find a 4 byte match
+      uint32_t skip = 32;
+      const uint8_t *nextIp = ip, *candidate;
+      do {
+        ip = nextIp;
+        uint32_t h = nextHash;
+        nextIp = ip + (skip++ >> 5);
+        if(nextIp > ipLimit)
+          goto emit_remainder;
+        nextHash = rlp_snappy_hash(nextIp, shift);
+        candidate = in + table[h];
+        table[h] = (uint16_t) (ip - in);
+      } while(rlp_snappy_load32(ip) != rlp_snappy_load32(candidate));
+
+      op = rlp_snappy_emit_literal(op, nextEmit, ip - nextEmit);
+
+      // Emit copies for as long as the next position matches too
+      do {
+        const uint8_t *base = ip;
+        ip += 4 + rlp_snappy_match_len(candidate + 4, ip + 4, end);
+        op = rlp_snappy_emit_copy(op, base - candidate, ip - base);
+        nextEmit = ip;
+        if(ip >= ipLimit)
+          goto emit_remainder;
+        table[rlp_snappy_hash(ip - 1, shift)] = (uint16_t) (ip - 1 - in);
+        uint32_t h = rlp_snappy_hash(ip, shift);
+        candidate = in + table[h];
+        table[h] = (uint16_t) (ip - in);
+      } while(rlp_snappy_load32(ip) == rlp_snappy_load32(candidate));
+
+      nextHash = rlp_snappy_hash(++ip, shift);
+    }
+  }
+
+emit_remainder:
+  if(nextEmit < end)
+    op = rlp_snappy_emit_literal(op, nextEmit, end - nextEmit);
+  return op;
+}
+
+// Writes one framed chunk for n <= RLP_SNAPPY_BLOCK bytes; out holds RLP_SNAPPY_CHUNK_MAX bytes
+static size_t rlp_snappy_frame_chunk(const uint8_t *in, size_t n, uint8_t *out, uint16_t *table) {
+  uint32_t crc = rlp_snappy_mask(rlp_crc32c(0, in, n));
+  uint8_t *data = out + 8;
+  uint8_t *p = rlp_snappy_put_varint(data, (uint32_t) n);
+  size_t len = rlp_snappy_compress_block(in, n, p, table) - data;
+  uint8_t type = RLP_SNAPPY_CHUNK_DATA;
+  // Not worth decompressing when it saves less than an eighth
+  if(len >= n - n / 8) {
+    type = RLP_SNAPPY_CHUNK_RAW;
+    memcpy(data, in, n);
+    len = n;
+  }
+  out[0] = type;
+  rlp_snappy_put_le(out + 1, (uint32_t) (4 + len), 3);
+  rlp_snappy_put_le(out + 4, crc, 4);
+  return 8 + len;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Decompression                               */
+/* -------------------------------------------------------------------------- */
+
+// Decodes an element stream into exactly outLen bytes
+static int rlp_snappy_decompress_elems(const uint8_t *ip, const uint8_t *end, uint8_t *out, size_t outLen) {
+  uint8_t *op = out, *oend = out + outLen;
+  while(ip < end) {
+    uint8_t tag = *ip++;
+    size_t len, off;
+    if((tag & 3) == 0) {
+      len = (tag >> 2) + 1;
+      if(len > 60) {
+        size_t bytes = len - 60;
+        if((size_t) (end - ip) < bytes)
+          return ERR_RLP_EINVAL;
+        len = (size_t) rlp_snappy_get_le(ip, bytes) + 1;
+        ip += bytes;
+      }
+      if((size_t) (end - ip) < len || (size_t) (oend - op) < len)
+        return ERR_RLP_EINVAL;
+      memcpy(op, ip, len);
+      ip += len;
+      op += len;
+      continue;
+    }
+    if((tag & 3) == 1) {
+      if(ip == end)
+        return ERR_RLP_EINVAL;
+      len = ((tag >> 2) & 7) + 4;
+      off = ((size_t) (tag >> 5) << 8) | *ip++;
+    } else {
+      size_t bytes = (tag & 3) == 2 ? 2 : 4;
+      if((size_t) (end - ip) < bytes)
+        return ERR_RLP_EINVAL;
+      len = (tag >> 2) + 1;
+      off = rlp_snappy_get_le(ip, bytes);
+      ip += bytes;
+    }
+    if(off == 0 || off > (size_t) (op - out) || (size_t) (oend - op) < len)
+      return ERR_RLP_EINVAL;
+    if(off >= len)
+      memcpy(op, op - off, len);
+    else {
+      // Overlapping copy repeats the last off bytes
+      for(size_t i = 0; i < len; i++)
+        op[i] = op[i - off];
+    }
+    op += len;
+  }
+  return op == oend ? ERR_RLP_OK : ERR_RLP_EINVAL;
+}
+
+// Walks the chunks of a framed stream; out == NULL only sums the lengths
+static int rlp_snappy_frame_walk(const uint8_t *in, size_t inLen, uint8_t *out, size_t outCap, size_t *len) {
+  const uint8_t *p = in, *end = in + inLen;
+  size_t total = 0;
+  if(inLen && (inLen < RLP_SNAPPY_STREAM_HDR || memcmp(in, rlpSnappyStreamId, RLP_SNAPPY_STREAM_HDR) != 0))
+    return ERR_RLP_EINVAL;
+  while(p < end) {
+    if(end - p < 4)
+      return ERR_RLP_ENODATA;
+    uint8_t type = p[0];
+    size_t chunkLen = rlp_snappy_get_le(p + 1, 3);
+    const uint8_t *data = p + 4;
+    if((size_t) (end - data) < chunkLen)
+      return ERR_RLP_ENODATA;
+    p = data + chunkLen;
+
+    if(type == RLP_SNAPPY_CHUNK_ID) {
+      // Concatenated streams repeat the identifier
+      if(chunkLen != 6 || memcmp(data, rlpSnappyStreamId + 4, 6) != 0)
+        return ERR_RLP_EINVAL;
+      continue;
+    }
+    if(type >= 0x80)
+      continue; // padding and skippable chunks
+    if(type != RLP_SNAPPY_CHUNK_DATA && type != RLP_SNAPPY_CHUNK_RAW)
+      return ERR_RLP_EINVAL; // reserved unskippable chunk
+    if(chunkLen < 4)
+      return ERR_RLP_EINVAL;
+
+    uint32_t n = (uint32_t) (chunkLen - 4);
+    size_t pre = 0;
+    if(type == RLP_SNAPPY_CHUNK_DATA && (pre = rlp_snappy_get_varint(data + 4, chunkLen - 4, &n)) == 0)
+      return ERR_RLP_EINVAL;
+    if(n > RLP_SNAPPY_BLOCK)
+      return ERR_RLP_EINVAL;
+    if(out) {
+      if(outCap - total < n)
+        return ERR_RLP_EMSGSIZE;
+      if(type == RLP_SNAPPY_CHUNK_RAW)
+        memcpy(out + total, data + 4, n);
+      else {
+        int err = rlp_snappy_decompress_elems(data + 4 + pre, data + chunkLen, out + total, n);
+        if(err < 0)
+          return err;
+      }
+      if(rlp_snappy_mask(rlp_crc32c(0, out + total, n)) != rlp_snappy_get_le(data, 4))
+        return ERR_RLP_EINVAL;
+    }
+    total += n;
+  }
+  *len = total;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Snappy Sink                                */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_snappy_sink_flush(RlpSink_t *sink)
+{
+  RlpSnappySink_t *s = (RlpSnappySink_t *) sink;
+  if(sink->len == 0)
+    return ERR_RLP_OK;
+  if(!s->started) {
+    int ret = rlp_sink_write(s->next, rlpSnappyStreamId, RLP_SNAPPY_STREAM_HDR);
+    if(ret < 0)
+      return ret;
+    s->started = true;
+  }
+  uint8_t *out = rlp_sink_reserve(s->next, RLP_SNAPPY_CHUNK_MAX);
+  if(out)
+    rlp_sink_commit(s->next, rlp_snappy_frame_chunk(sink->buff, sink->len, out, s->table));
+  else {
+    // The next window cannot take a whole chunk, stage it
+    if(s->staging == NULL && (s->staging = malloc(RLP_SNAPPY_CHUNK_MAX)) == NULL)
+      return ERR_RLP_ENOMEM;
+    size_t n = rlp_snappy_frame_chunk(sink->buff, sink->len, s->staging, s->table);
+    int ret = rlp_sink_write(s->next, s->staging, n);
+    if(ret < 0)
+      return ret;
+  }
+  sink->len = 0;
+  return ERR_RLP_OK;
+}
+
+static int rlp_snappy_sink_close(RlpSink_t *sink)
+{
+  RlpSnappySink_t *s = (RlpSnappySink_t *) sink;
+  int err = rlp_snappy_sink_flush(sink);
+  int closeErr = rlp_sink_close(s->next);
+  free(sink->buff);
+  free(s->table);
+  free(s->staging);
+  sink->buff = NULL;
+  s->table = NULL;
+  s->staging = NULL;
+  return err < 0 ? err : closeErr;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_snappy_compress(const void *in, size_t inLen, void *out, size_t outCap)
+{
+  if((in == NULL && inLen) || out == NULL)
+    return ERR_RLP_EBADARG;
+  if(inLen > UINT32_MAX || rlp_snappy_max_compressed_len(inLen) > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  if(outCap < rlp_snappy_max_compressed_len(inLen))
+    return ERR_RLP_EMSGSIZE;
+  uint16_t table[RLP_SNAPPY_TABLE];
+  const uint8_t *ip = in;
+  uint8_t *op = rlp_snappy_put_varint(out, (uint32_t) inLen);
+  for(size_t off = 0; off < inLen; off += RLP_SNAPPY_BLOCK) {
+    size_t n = inLen - off < RLP_SNAPPY_BLOCK ? inLen - off : RLP_SNAPPY_BLOCK;
+    op = rlp_snappy_compress_block(ip + off, n, op, table);
+  }
+  return (int) (op - (uint8_t *) out);
+}
+
+int rlp_snappy_uncompressed_len(const void *in, size_t inLen, size_t *len)
+{
+  if(in == NULL || len == NULL)
+    return ERR_RLP_EBADARG;
+  uint32_t n;
+  if(rlp_snappy_get_varint(in, inLen, &n) == 0)
+    return ERR_RLP_EINVAL;
+  *len = n;
+  return ERR_RLP_OK;
+}
+
+int rlp_snappy_decompress(const void *in, size_t inLen, void *out, size_t outCap)
+{
+  if(in == NULL || (out == NULL && outCap))
+    return ERR_RLP_EBADARG;
+  uint32_t n;
+  size_t pre = rlp_snappy_get_varint(in, inLen, &n);
+  if(pre == 0)
+    return ERR_RLP_EINVAL;
+  if(n > outCap || n > INT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  int err = rlp_snappy_decompress_elems((const uint8_t *) in + pre, (const uint8_t *) in + inLen, out, n);
+  return err < 0 ? err : (int) n;
+}
+
+int rlp_snappy_frame_compress(const void *in, size_t inLen, void *out, size_t outCap)
+{
+  if((in == NULL && inLen) || out == NULL)
+    return ERR_RLP_EBADARG;
+  if(rlp_snappy_frame_max_len(inLen) > INT32_MAX || outCap < rlp_snappy_frame_max_len(inLen))
+    return ERR_RLP_EMSGSIZE;
+  uint16_t table[RLP_SNAPPY_TABLE];
+  const uint8_t *ip = in;
+  uint8_t *op = out;
+  memcpy(op, rlpSnappyStreamId, RLP_SNAPPY_STREAM_HDR);
+  op += RLP_SNAPPY_STREAM_HDR;
+  for(size_t off = 0; off < inLen; off += RLP_SNAPPY_BLOCK) {
+    size_t n = inLen - off < RLP_SNAPPY_BLOCK ? inLen - off : RLP_SNAPPY_BLOCK;
+    op += rlp_snappy_frame_chunk(ip + off, n, op, table);
+  }
+  return (int) (op - (uint8_t *) out);
+}
+
+int rlp_snappy_frame_len(const void *in, size_t inLen, size_t *len)
+{
+  if((in == NULL && inLen) || len == NULL)
+    return ERR_RLP_EBADARG;
+  return rlp_snappy_frame_walk(in, inLen, NULL, 0, len);
+}
+
+int rlp_snappy_frame_decompress(const void *in, size_t inLen, void *out, size_t outCap)
+{
+  if((in == NULL && inLen) || (out == NULL && outCap))
+    return ERR_RLP_EBADARG;
+  size_t len;
+  int err = rlp_snappy_frame_walk(in, inLen, out ? out : (uint8_t *) "", outCap, &len);
+  if(err < 0)
+    return err;
+  return len > INT32_MAX ? ERR_RLP_EMSGSIZE : (int) len;
+}
+
+int rlp_snappy_sink_init(RlpSnappySink_t *s, RlpSink_t *next)
+{
+  if(s == NULL || next == NULL)
+    return ERR_RLP_EBADARG;
+  s->next = next;
+  s->started = false;
+  s->staging = NULL;
+  s->table = malloc(RLP_SNAPPY_TABLE * sizeof(*s->table));
+  s->sink.buff = malloc(RLP_SNAPPY_BLOCK);
+  if(s->table == NULL || s->sink.buff == NULL) {
+    free(s->table);
+    free(s->sink.buff);
+    return ERR_RLP_ENOMEM;
+  }
+  s->sink.len = 0;
+  s->sink.cap = RLP_SNAPPY_BLOCK;
+  s->sink.flush = rlp_snappy_sink_flush;
+  s->sink.close = rlp_snappy_sink_close;
+  return ERR_RLP_OK;
+}
@@ -0,0 +1,107 @@
+/**
+ * RLP Serializer - Snappy Compression
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Self-contained Snappy raw and framed formats. The sink stage takes encoder output
+ * in its window and compresses it straight into the window of the next sink, and
+ * framed input decompresses into one buffer that the decoder then views in place.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SNAPPY_H_
+#define __RLP_SNAPPY_H_
+
+#include "rlp_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_SNAPPY_BLOCK        65536   // matches never reach back past a block; also the framed chunk size
+#define RLP_SNAPPY_STREAM_HDR   10      // stream identifier chunk opening every framed stream
+#define RLP_SNAPPY_CHUNK_MAX    (8 + 32 + RLP_SNAPPY_BLOCK + RLP_SNAPPY_BLOCK / 6) // one framed chunk, worst case
+
+// Worst case raw compressed size of n input bytes
+static inline size_t rlp_snappy_max_compressed_len(size_t n) {
+  return 32 + n + n / 6;
+}
+
+// Worst case framed size of n input bytes, stream identifier included
+static inline size_t rlp_snappy_frame_max_len(size_t n) {
+  size_t chunks = n ? (n + RLP_SNAPPY_BLOCK - 1) / RLP_SNAPPY_BLOCK : 0;
+  return RLP_SNAPPY_STREAM_HDR + chunks * RLP_SNAPPY_CHUNK_MAX;
+}
+
+// Compresses into the raw Snappy format (length preamble and one element stream)
+// Returns length of output in bytes, or a negative error value
+int rlp_snappy_compress(const void *in, size_t inLen, void *out, size_t outCap);
+
+// Reads the uncompressed length from the preamble of raw Snappy data
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_snappy_uncompressed_len(const void *in, size_t inLen, size_t *len);
+
+// Decompresses raw Snappy data; every copy is bounds checked against the output written so far
+// Returns length of output in bytes, or a negative error value
+int rlp_snappy_decompress(const void *in, size_t inLen, void *out, size_t outCap);
+
+// Compresses into the framing format: stream identifier, then one checksummed chunk per block.
+// Blocks that do not compress go out as uncompressed chunks.
+// Returns length of output in bytes, or a negative error value
+int rlp_snappy_frame_compress(const void *in, size_t inLen, void *out, size_t outCap);
+
+// Total uncompressed length of a framed stream, from the chunk headers and preambles only
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_snappy_frame_len(const void *in, size_t inLen, size_t *len);
+
+// Decompresses a framed stream into one contiguous buffer and verifies every chunk checksum,
+// so decoded items can point straight into out. Padding and skippable chunks are ignored.
+// Returns length of output in bytes, or a negative error value
+int rlp_snappy_frame_decompress(const void *in, size_t inLen, void *out, size_t outCap);
+
+// CRC-32C (Castagnoli) of data, continuing from crc (0 to start)
+uint32_t rlp_crc32c(uint32_t crc, const void *data, size_t len);
+
+// Sink stage writing the framing format to another sink. Its window is one block: encoders
+// write into it and a flush compresses the block directly into the next sink's window.
+typedef struct rlpSnappySink {
+  RlpSink_t    sink;      // must stay first
+  RlpSink_t    *next;
+  bool         started;   // stream identifier written
+  uint16_t     *table;    // hash table of the matcher
+  uint8_t      *staging;  // compressed chunk when the next window is too small to take one
+} RlpSnappySink_t;
+
+// Allocates the block window and matcher table. rlp_sink_close() flushes, closes next and frees them.
+// Chunks are compressed in place when next can reserve RLP_SNAPPY_CHUNK_MAX bytes, so give it a window
+// of at least twice that; smaller windows cost a copy per chunk.
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_snappy_sink_init(RlpSnappySink_t *s, RlpSink_t *next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * RLP Serializer - Snappy Benchmark
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Measures the copy saved by compressing in the sink chain. The same receipt logs are
+ * encoded into a buffer and then compressed, and encoded straight into a Snappy sink
+ * whose chunks land in the output buffer. Decompression then feeds the decoder in place.
+ * Build: cc -O2 rlp_snappy_bench.c rlp_snappy.c rlp_sink.c rlp_serializer.c -lpthread
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_snappy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_LOGS        32768
+#define BENCH_ADDRESSES   64      // contracts emitting the logs, so addresses and topics repeat
+#define BENCH_TOPICS      48
+
+typedef struct {
+  RlpElement_t  fields[6];
+  size_t        fieldsCnt;
+  size_t        payloadLen;
+  uint8_t       data[96];
+} BenchLog_t;
+
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static void fill(uint8_t *out, size_t len) {
+  for(size_t i = 0; i < len; i++)
+    out[i] = (uint8_t) rng();
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Window that slides over one output buffer, so both paths end in the same place
+typedef struct {
+  RlpSink_t  sink;
+  size_t     window;
+  uint8_t    *end;
+} BenchMemSink_t;
+
+static int bench_mem_flush(RlpSink_t *sink) {
+  BenchMemSink_t *m = (BenchMemSink_t *) sink;
+  sink->buff += sink->len;
+  sink->len = 0;
+  sink->cap = (size_t) (m->end - sink->buff) < m->window ? (size_t) (m->end - sink->buff) : m->window;
+  return sink->cap ? ERR_RLP_OK : ERR_RLP_EMSGSIZE;
+}
+
+static int bench_mem_close(RlpSink_t *sink) {
+  return bench_mem_flush(sink);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 20;
+  if(rounds <= 0) {
+    fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+    return 1;
+  }
+
+  static uint8_t addresses[BENCH_ADDRESSES][20], topics[BENCH_TOPICS][32];
+  fill(&addresses[0][0], sizeof(addresses));
+  fill(&topics[0][0], sizeof(topics));
+  BenchLog_t *logs = malloc(BENCH_LOGS * sizeof(*logs));
+  if(logs == NULL)
+    return 1;
+  size_t encodedLen = 0;
+  for(size_t i = 0; i < BENCH_LOGS; i++) {
+    BenchLog_t *l = &logs[i];
+    size_t topicsCnt = 1 + rng() % 4;
+    // ABI words: mostly left padded amounts and addresses
+    size_t words = rng() % 4;
+    memset(l->data, 0, sizeof(l->data));
+    for(size_t w = 0; w < words; w++)
+      for(size_t b = 24 + rng() % 8; b < 32; b++)
+        l->data[w * 32 + b] = (uint8_t) rng();
+    l->fields[0] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 20, .buff = addresses[rng() % BENCH_ADDRESSES] };
+    for(size_t t = 0; t < topicsCnt; t++)
+      l->fields[1 + t] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = topics[rng() % BENCH_TOPICS] };
+    l->fields[1 + topicsCnt] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = words * 32, .buff = l->data };
+    l->fieldsCnt = 2 + topicsCnt;
+    l->payloadLen = 0;
+    for(size_t f = 0; f < l->fieldsCnt; f++)
+      l->payloadLen += rlp_element_encoded_len(&l->fields[f]);
+    encodedLen += rlp_header_len(l->payloadLen) + l->payloadLen;
+  }
+
+  size_t outCap = rlp_snappy_frame_max_len(encodedLen);
+  uint8_t *plain = malloc(encodedLen), *out = malloc(outCap), *back = malloc(encodedLen);
+  if(!plain || !out || !back)
+    return 1;
+
+  double copyNs = 0, sinkNs = 0, decNs = 0;
+  int framedLen = 0;
+  size_t sinkLen = 0, items = 0;
+  for(int r = 0; r < rounds; r++) {
+    // Encode into a buffer, then compress it: the encoded bytes are written and read back once more
+    double t0 = now_ns();
+    size_t len = 0;
+    for(size_t i = 0; i < BENCH_LOGS; i++) {
+      const RlpElement_t *ptrs[6];
+      for(size_t f = 0; f < logs[i].fieldsCnt; f++)
+        ptrs[f] = &logs[i].fields[f];
+      len += rlp_encode_list(plain + len, encodedLen - len, ptrs, logs[i].fieldsCnt);
+    }
+    framedLen = rlp_snappy_frame_compress(plain, len, out, outCap);
+    double t1 = now_ns();
+
+    // Encode into the Snappy sink: each block is compressed from the window into the output
+    BenchMemSink_t mem = { { out, 0, 2 * RLP_SNAPPY_CHUNK_MAX, bench_mem_flush, bench_mem_close },
+                           2 * RLP_SNAPPY_CHUNK_MAX, out + outCap };
+    RlpSnappySink_t snappy;
+    if(framedLen < 0 || rlp_snappy_sink_init(&snappy, &mem.sink) < 0) {
+      fprintf(stderr, "compress error %d\n", framedLen);
+      return 1;
+    }
+    for(size_t i = 0; i < BENCH_LOGS; i++) {
+      rlp_sink_encode_header(&snappy.sink, logs[i].payloadLen, true);
+      for(size_t f = 0; f < logs[i].fieldsCnt; f++)
+        rlp_sink_encode_element(&snappy.sink, &logs[i].fields[f]);
+    }
+    int err = rlp_sink_close(&snappy.sink);
+    double t2 = now_ns();
+    sinkLen = (size_t) (mem.sink.buff - out);
+
+    // Decompress once, then decode views into the decompressed buffer
+    int backLen = rlp_snappy_frame_decompress(out, sinkLen, back, encodedLen);
+    const uint8_t *p = back, *end = back + (backLen < 0 ? 0 : backLen);
+    items = 0;
+    while(p < end) {
+      RlpItem_t item;
+      int n = rlp_decode_item(p, (size_t) (end - p), &item);
+      if(n < 0)
+        break;
+      p += n;
+      items++;
+    }
+    decNs += now_ns() - t2;
+    if(err < 0 || backLen != (int) len || memcmp(back, plain, len) != 0 || items != BENCH_LOGS) {
+      fprintf(stderr, "round trip failed: err %d, %d of %zu bytes\n", err, backLen, len);
+      return 1;
+    }
+    copyNs += t1 - t0;
+    sinkNs += t2 - t1;
+  }
+
+  double mb = (double) rounds * encodedLen / 1e6;
+  printf("%d rounds, %zu B encoded, %d B framed (%.1f%%)\n", rounds, encodedLen, framedLen, 100.0 * framedLen / encodedLen);
+  printf("encode then compress: %.0f MB/s\n", mb / (copyNs / 1e9));
+  printf("encode into sink:     %.0f MB/s\n", mb / (sinkNs / 1e9));
+  printf("decompress + decode:  %.0f MB/s\n", mb / (decNs / 1e9));
+
+  free(back);
+  free(out);
+  free(plain);
+  free(logs);
+  return 0;
+}
@@ -0,0 +1,462 @@
+/**
+ * RLP Serializer - External Sort
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Sorts RLP records by a key field found with a path query, over inputs larger
+ * than memory. Runs are sorted with a parallel radix sort on (key, offset) pairs,
+ * spilled to memory mapped temporary files and merged through a loser tree.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_sort.h"
+#include "rlp_diff.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RLP_SORT_KEY_LEN        (RLP_SORT_KEY_MAX + 1)  // compared bytes: key, then its length
+#define RLP_SORT_SMALL          32                      // ranges this short are insertion sorted
+#define RLP_SORT_PARALLEL_MIN   65536                   // runs this short are sorted on one thread
+
+typedef struct rlpSortJob {
+  RlpSorter_t  *s;
+  pthread_t    thread;
+  bool         joinable;
+  size_t       from;          // entries [from, to) for the prefix, count and scatter passes
+  size_t       to;
+  size_t       common;        // key bytes all entries of the slice share with the first one
+  size_t       digit;
+  size_t       hist[256];     // counts, then scatter positions
+  size_t       *bucketStart;  // shared, 257 entries
+  size_t       *nextBucket;   // shared
+} RlpSortJob_t;
+
+typedef struct rlpSortSource {
+  const uint8_t         *base;      // mapped run, or the buffer of the run still in memory
+  size_t                pos;
+  size_t                len;
+  const RlpSortEntry_t  *entries;   // sorted entries of the run in memory, NULL for a mapped run
+  size_t                next;
+  size_t                cnt;
+  const uint8_t         *rec;       // current record
+  size_t                recLen;
+  const uint8_t         *key;
+  uint8_t               keyBuff[RLP_SORT_KEY_LEN];
+  bool                  done;
+} RlpSortSource_t;
+
+/* -------------------------------------------------------------------------- */
+/*                                    Keys                                    */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_sort_key(const RlpSorter_t *s, const uint8_t *rec, size_t len, uint8_t key[RLP_SORT_KEY_LEN]) {
+  RlpItem_t item;
+  int err = rlp_path_get(rec, len, s->path, s->depth, &item);
+  if(err < 0)
+    return err;
+  if(item.isList)
+    return ERR_RLP_EBADARG;
+  if(item.payloadLen > RLP_SORT_KEY_MAX)
+    return ERR_RLP_EMSGSIZE;
+  memset(key, 0, RLP_SORT_KEY_LEN);
+  memcpy(key + (s->flags & RLP_SORT_NUMERIC ? RLP_SORT_KEY_MAX - item.payloadLen : 0), item.payload, item.payloadLen);
+  key[RLP_SORT_KEY_MAX] = (uint8_t) item.payloadLen;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 Radix Sort                                 */
+/* -------------------------------------------------------------------------- */
+
+// Entries keep their input order on equal keys: the scatters are stable and the
+// insertion sort breaks ties by offset
+static void rlp_sort_insertion(RlpSortEntry_t *e, size_t n, size_t digit) {
+  for(size_t i = 1; i < n; i++) {
+    RlpSortEntry_t v = e[i];
+    size_t j = i;
+    for(; j > 0; j--) {
+      int c = memcmp(e[j - 1].key + digit, v.key + digit, RLP_SORT_KEY_LEN - digit);
+      if(c < 0 || (c == 0 && e[j - 1].off < v.off))
+        break;
+      e[j] = e[j - 1];
+    }
+    e[j] = v;
+  }
+}
+
+// Most significant digit first, one key byte per level; tmp is scratch of n entries
+static void rlp_sort_msd(RlpSortEntry_t *e, RlpSortEntry_t *tmp, size_t n, size_t digit) {
+  while(digit < RLP_SORT_KEY_LEN && n > RLP_SORT_SMALL) {
+    size_t cnt[256] = {0}, pos[256], sum = 0;
+    for(size_t i = 0; i < n; i++)
+      cnt[e[i].key[digit]]++;
+    if(cnt[e[0].key[digit]] == n) {
+      digit++; // every key has the same byte here
+      continue;
+    }
+    for(int c = 0; c < 256; c++) {
+      pos[c] = sum;
+      sum += cnt[c];
+    }
+    for(size_t i = 0; i < n; i++)
+      tmp[pos[e[i].key[digit]]++] = e[i];
+    memcpy(e, tmp, n * sizeof(*e));
+    sum = 0;
+    for(int c = 0; c < 256; sum += cnt[c++])
+      if(cnt[c] > 1)
+        rlp_sort_msd(e + sum, tmp + sum, cnt[c], digit + 1);
+    return;
+  }
+  if(digit < RLP_SORT_KEY_LEN)
+    rlp_sort_insertion(e, n, digit);
+}
+
+static void *rlp_sort_job_prefix(void *arg) {
+  RlpSortJob_t *job = arg;
+  const uint8_t *first = job->s->entries[0].key;
+  size_t common = RLP_SORT_KEY_LEN;
+  for(size_t i = job->from; i < job->to && common; i++) {
+    const uint8_t *key = job->s->entries[i].key;
+    size_t d = 0;
+    while(d < common && key[d] == first[d])
+      d++;
+    common = d;
+  }
+  job->common = common;
+  return NULL;
+}
+
+static void *rlp_sort_job_count(void *arg) {
+  RlpSortJob_t *job = arg;
+  memset(job->hist, 0, sizeof(job->hist));
+  for(size_t i = job->from; i < job->to; i++)
+    job->hist[job->s->entries[i].key[job->digit]]++;
+  return NULL;
+}
+
+static void *rlp_sort_job_scatter(void *arg) {
+  RlpSortJob_t *job = arg;
+  const RlpSortEntry_t *e = job->s->entries;
+  for(size_t i = job->from; i < job->to; i++)
+    job->s->scratch[job->hist[e[i].key[job->digit]]++] = e[i];
+  return NULL;
+}
+
+// Takes buckets off the shared counter until none are left, moves each back and sorts it
+static void *rlp_sort_job_buckets(void *arg) {
+  RlpSortJob_t *job = arg;
+  RlpSortEntry_t *e = job->s->entries, *tmp = job->s->scratch;
+  for(;;) {
+    size_t b = __atomic_fetch_add(job->nextBucket, 1, __ATOMIC_RELAXED);
+    if(b >= 256)
+      break;
+    size_t start = job->bucketStart[b], cnt = job->bucketStart[b + 1] - start;
+    memcpy(e + start, tmp + start, cnt * sizeof(*e));
+    if(cnt > 1)
+      rlp_sort_msd(e + start, tmp + start, cnt, job->digit + 1);
+  }
+  return NULL;
+}
+
+static void rlp_sort_parallel(RlpSortJob_t *jobs, unsigned cnt, void *(*fn)(void *)) {
+  for(unsigned i = 1; i < cnt; i++) {
+    jobs[i].joinable = pthread_create(&jobs[i].thread, NULL, fn, &jobs[i]) == 0;
+    if(!jobs[i].joinable)
+      fn(&jobs[i]);
+  }
+  fn(&jobs[0]);
+  for(unsigned i = 1; i < cnt; i++)
+    if(jobs[i].joinable)
+      pthread_join(jobs[i].thread, NULL);
+}
+
+// The first level runs on all threads: find the first key byte that differs, count and
+// scatter slices in parallel, then hand out the 256 buckets to be sorted independently.
+static void rlp_sort_entries(RlpSorter_t *s) {
+  size_t n = s->entriesCnt;
+  unsigned threads = s->threads;
+  if(threads < 2 || n < RLP_SORT_PARALLEL_MIN) {
+    rlp_sort_msd(s->entries, s->scratch, n, 0);
+    return;
+  }
+
+  RlpSortJob_t jobs[RLP_SORT_MAX_THREADS];
+  size_t bucketStart[257], nextBucket = 0, digit = RLP_SORT_KEY_LEN;
+  for(unsigned i = 0; i < threads; i++)
+    jobs[i] = (RlpSortJob_t) { .s = s, .from = n * i / threads, .to = n * (i + 1) / threads,
+                               .bucketStart = bucketStart, .nextBucket = &nextBucket };
+  rlp_sort_parallel(jobs, threads, rlp_sort_job_prefix);
+  for(unsigned i = 0; i < threads; i++)
+    digit = jobs[i].common < digit ? jobs[i].common : digit;
+  if(digit == RLP_SORT_KEY_LEN)
+    return; // all keys equal, input order already is the result
+
+  for(unsigned i = 0; i < threads; i++)
+    jobs[i].digit = digit;
+  rlp_sort_parallel(jobs, threads, rlp_sort_job_count);
+  // Bucket major, slice minor positions keep the scatter stable
+  size_t sum = 0;
+  for(int c = 0; c < 256; c++) {
+    bucketStart[c] = sum;
+    for(unsigned i = 0; i < threads; i++) {
+      size_t cnt = jobs[i].hist[c];
+      jobs[i].hist[c] = sum;
+      sum += cnt;
+    }
+  }
+  bucketStart[256] = n;
+  rlp_sort_parallel(jobs, threads, rlp_sort_job_scatter);
+  rlp_sort_parallel(jobs, threads, rlp_sort_job_buckets);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+// Sorts the run in memory and writes its records in order to an unlinked temporary file
+static int rlp_sort_spill(RlpSorter_t *s) {
+  if(s->entriesCnt == 0)
+    return ERR_RLP_OK;
+  if(s->runsCnt == s->runsCap) {
+    size_t cap = s->runsCap ? 2 * s->runsCap : 16;
+    RlpSortRun_t *runs = realloc(s->runs, cap * sizeof(*runs));
+    if(runs == NULL)
+      return ERR_RLP_ENOMEM;
+    s->runs = runs;
+    s->runsCap = cap;
+  }
+  rlp_sort_entries(s);
+
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/rlp-sort-XXXXXX", s->tmpDir ? s->tmpDir : "/tmp");
+  int fd = mkstemp(path);
+  if(fd < 0)
+    return ERR_RLP_EIO;
+  unlink(path);
+  uint8_t *out = MAP_FAILED;
+  if(ftruncate(fd, s->buffLen) == 0)
+    out = mmap(NULL, s->buffLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(out == MAP_FAILED) {
+    close(fd);
+    return ERR_RLP_EIO;
+  }
+  uint8_t *p = out;
+  for(size_t i = 0; i < s->entriesCnt; i++) {
+    memcpy(p, s->buff + s->entries[i].off, s->entries[i].len);
+    p += s->entries[i].len;
+  }
+  munmap(out, s->buffLen);
+
+  s->runs[s->runsCnt++] = (RlpSortRun_t) { .fd = fd, .len = s->buffLen };
+  s->buffLen = 0;
+  s->entriesCnt = 0;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Merge                                   */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_sort_source_next(const RlpSorter_t *s, RlpSortSource_t *src) {
+  if(src->entries) {
+    if(src->next == src->cnt) {
+      src->done = true;
+      return ERR_RLP_OK;
+    }
+    const RlpSortEntry_t *e = &src->entries[src->next++];
+    src->rec = src->base + e->off;
+    src->recLen = e->len;
+    src->key = e->key;
+    return ERR_RLP_OK;
+  }
+  if(src->pos == src->len) {
+    src->done = true;
+    return ERR_RLP_OK;
+  }
+  RlpItem_t item;
+  int ret = rlp_decode_item(src->base + src->pos, src->len - src->pos, &item);
+  if(ret < 0)
+    return ret;
+  src->rec = src->base + src->pos;
+  src->recLen = ret;
+  src->pos += ret;
+  src->key = src->keyBuff;
+  return rlp_sort_key(s, src->rec, src->recLen, src->keyBuff);
+}
+
+// Sources are numbered in input order, so ties go to the lower index
+static inline bool rlp_sort_source_less(const RlpSortSource_t *src, unsigned a, unsigned b) {
+  if(src[a].done || src[b].done)
+    return !src[a].done;
+  int c = memcmp(src[a].key, src[b].key, RLP_SORT_KEY_LEN);
+  return c < 0 || (c == 0 && a < b);
+}
+
+// Loser tree: internal node i (1 to k - 1) holds the loser of the match between its children
+// 2i and 2i + 1; node k + j is source j. Returns the winner of the subtree at node.
+static unsigned rlp_sort_tree_build(const RlpSortSource_t *src, unsigned *tree, unsigned k, unsigned node) {
+  if(node >= k)
+    return node - k;
+  unsigned a = rlp_sort_tree_build(src, tree, k, 2 * node);
+  unsigned b = rlp_sort_tree_build(src, tree, k, 2 * node + 1);
+  bool aWins = rlp_sort_source_less(src, a, b);
+  tree[node] = aWins ? b : a;
+  return aWins ? a : b;
+}
+
+// Replays the matches on the path from source w, which has just advanced, to the root
+static inline unsigned rlp_sort_tree_replay(const RlpSortSource_t *src, unsigned *tree, unsigned k, unsigned w) {
+  for(unsigned node = (w + k) / 2; node > 0; node /= 2) {
+    if(rlp_sort_source_less(src, tree[node], w)) {
+      unsigned t = tree[node];
+      tree[node] = w;
+      w = t;
+    }
+  }
+  return w;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_sort_open(RlpSorter_t *s, const uint32_t *path, size_t depth, size_t memLimit,
+                  unsigned threads, const char *tmpDir, unsigned flags)
+{
+  if(s == NULL || (path == NULL && depth) || depth > RLP_SORT_MAX_DEPTH || memLimit < RLP_SORT_MIN_MEM)
+    return ERR_RLP_EBADARG;
+  memset(s, 0, sizeof(*s));
+  if(depth)
+    memcpy(s->path, path, depth * sizeof(*path));
+  s->depth = depth;
+  s->flags = flags;
+  s->threads = threads < 1 ? 1 : threads > RLP_SORT_MAX_THREADS ? RLP_SORT_MAX_THREADS : threads;
+  s->tmpDir = tmpDir;
+  // Half the budget for records, half for the entries and their scatter copy
+  s->buffCap = memLimit / 2;
+  s->entriesCap = memLimit / 2 / (2 * sizeof(RlpSortEntry_t));
+  s->buff = malloc(s->buffCap);
+  s->entries = malloc(s->entriesCap * sizeof(RlpSortEntry_t));
+  s->scratch = malloc(s->entriesCap * sizeof(RlpSortEntry_t));
+  if(s->buff == NULL || s->entries == NULL || s->scratch == NULL) {
+    rlp_sort_close(s);
+    return ERR_RLP_ENOMEM;
+  }
+  return ERR_RLP_OK;
+}
+
+int rlp_sort_add(RlpSorter_t *s, const void *records, size_t len)
+{
+  if(s == NULL || s->buff == NULL || (records == NULL && len))
+    return ERR_RLP_EBADARG;
+  const uint8_t *p = records;
+  for(size_t off = 0; off < len;) {
+    RlpItem_t item;
+    int ret = rlp_decode_item(p + off, len - off, &item);
+    if(ret < 0)
+      return ret;
+    size_t recLen = ret;
+    if(recLen > s->buffCap)
+      return ERR_RLP_EMSGSIZE;
+    int err;
+    if((s->buffLen + recLen > s->buffCap || s->entriesCnt == s->entriesCap) && (err = rlp_sort_spill(s)) < 0)
+      return err;
+    RlpSortEntry_t *e = &s->entries[s->entriesCnt];
+    if((err = rlp_sort_key(s, p + off, recLen, e->key)) < 0)
+      return err;
+    e->len = (uint32_t) recLen;
+    e->off = s->buffLen;
+    memcpy(s->buff + s->buffLen, p + off, recLen);
+    s->buffLen += recLen;
+    s->entriesCnt++;
+    s->recordsCnt++;
+    off += recLen;
+  }
+  return ERR_RLP_OK;
+}
+
+int rlp_sort_finish(RlpSorter_t *s, RlpSink_t *out)
+{
+  if(s == NULL || s->buff == NULL || out == NULL)
+    return ERR_RLP_EBADARG;
+  // The last run is merged straight from memory
+  rlp_sort_entries(s);
+  unsigned k = (unsigned) s->runsCnt + 1;
+  RlpSortSource_t *src = calloc(k, sizeof(*src));
+  unsigned *tree = calloc(k, sizeof(*tree));
+  int err = src && tree ? ERR_RLP_OK : ERR_RLP_ENOMEM;
+  for(unsigned i = 0; i + 1 < k && err == ERR_RLP_OK; i++) {
+    void *p = mmap(NULL, s->runs[i].len, PROT_READ, MAP_SHARED, s->runs[i].fd, 0);
+    if(p == MAP_FAILED) {
+      err = ERR_RLP_EIO;
+      break;
+    }
+    madvise(p, s->runs[i].len, MADV_SEQUENTIAL);
+    src[i].base = p;
+    src[i].len = s->runs[i].len;
+  }
+  if(err == ERR_RLP_OK) {
+    src[k - 1] = (RlpSortSource_t) { .base = s->buff, .entries = s->entries, .cnt = s->entriesCnt };
+    for(unsigned i = 0; i < k && err == ERR_RLP_OK; i++)
+      err = rlp_sort_source_next(s, &src[i]);
+  }
+
+  if(err == ERR_RLP_OK) {
+    tree[0] = rlp_sort_tree_build(src, tree, k, 1);
+    while(!src[tree[0]].done) {
+      unsigned w = tree[0];
+      if((err = rlp_sink_write(out, src[w].rec, src[w].recLen)) < 0 ||
+         (err = rlp_sort_source_next(s, &src[w])) < 0)
+        break;
+      tree[0] = rlp_sort_tree_replay(src, tree, k, w);
+    }
+  }
+  if(err == ERR_RLP_OK)
+    err = rlp_sink_flush(out);
+
+  for(unsigned i = 0; src && i + 1 < k; i++)
+    if(src[i].base)
+      munmap((void *) src[i].base, src[i].len);
+  free(src);
+  free(tree);
+  return err < 0 ? err : ERR_RLP_OK;
+}
+
+void rlp_sort_close(RlpSorter_t *s)
+{
+  if(s == NULL)
+    return;
+  for(size_t i = 0; i < s->runsCnt; i++)
+    close(s->runs[i].fd);
+  free(s->runs);
+  free(s->buff);
+  free(s->entries);
+  free(s->scratch);
+  memset(s, 0, sizeof(*s));
+}
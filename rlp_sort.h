@@ -0,0 +1,112 @@
+/**
+ * RLP Serializer - External Sort
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Sorts RLP records by a key field found with a path query, over inputs larger
+ * than memory. Runs are sorted with a parallel radix sort on (key, offset) pairs,
+ * spilled to memory mapped temporary files and merged through a loser tree.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SORT_H_
+#define __RLP_SORT_H_
+
+#include "rlp_serializer.h"
+#include "rlp_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_SORT_KEY_MAX     32            // longest key, in bytes
+#define RLP_SORT_MAX_DEPTH   16            // longest key path
+#define RLP_SORT_MAX_THREADS 64
+#define RLP_SORT_MIN_MEM     (1u << 20)
+#define RLP_SORT_NUMERIC     0x1           // keys are integers: order by value, not by bytes
+
+// Keys are compared in a fixed width form: the key bytes left aligned (right aligned with
+// RLP_SORT_NUMERIC) in RLP_SORT_KEY_MAX zero bytes, then the key length. Byte keys thus
+// sort like memcmp() with shorter keys first on a tie, integers sort by value.
+typedef struct rlpSortEntry {
+  uint8_t      key[RLP_SORT_KEY_MAX + 1];
+  uint32_t     len;       // record length
+  uint64_t     off;       // record offset in the run buffer
+} RlpSortEntry_t;
+
+typedef struct rlpSortRun {
+  int          fd;        // unlinked temporary file
+  size_t       len;
+} RlpSortRun_t;
+
+typedef struct rlpSorter {
+  uint32_t        path[RLP_SORT_MAX_DEPTH];
+  size_t          depth;
+  unsigned        flags;
+  unsigned        threads;
+  const char      *tmpDir;
+  // Current run
+  uint8_t         *buff;        // records in input order
+  size_t          buffLen;
+  size_t          buffCap;
+  RlpSortEntry_t  *entries;
+  RlpSortEntry_t  *scratch;     // radix sort scatter target
+  size_t          entriesCnt;
+  size_t          entriesCap;
+  // Spilled runs
+  RlpSortRun_t    *runs;
+  size_t          runsCnt;
+  size_t          runsCap;
+  size_t          recordsCnt;
+} RlpSorter_t;
+
+
+// Sets up a sort of records by the item at path (see rlp_path_get(), depth 0 is the record
+// itself), which must be a string of at most RLP_SORT_KEY_MAX bytes. memLimit bounds the
+// records and entries held in memory; each time it fills, the run is sorted with up to
+// threads threads and spilled to a temporary file in tmpDir (NULL for /tmp), which must
+// stay valid until close.
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_sort_open(RlpSorter_t *s, const uint32_t *path, size_t depth, size_t memLimit,
+                  unsigned threads, const char *tmpDir, unsigned flags);
+
+// Adds whole records, any number of them back to back; they are copied
+// Returns ERR_RLP_OK, ERR_RLP_ENOENT if a record has no item at the key path, ERR_RLP_EBADARG
+// if that item is a list, or a negative error value
+int rlp_sort_add(RlpSorter_t *s, const void *records, size_t len);
+
+// Writes every record added, sorted by key, to out. Records with equal keys keep their
+// input order. The sink is flushed, not closed; the sorter can only be closed afterwards.
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_sort_finish(RlpSorter_t *s, RlpSink_t *out);
+
+// Frees the buffers and removes the temporary files
+void rlp_sort_close(RlpSorter_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
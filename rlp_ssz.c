@@ -0,0 +1,371 @@
+/**
+ * RLP Serializer - SSZ Transcoder
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * One pass RLP <-> SSZ conversion over a precomputed container layout.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_ssz.h"
+#include "rlp_sidecar.h"
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                   Schemas                                  */
+/* -------------------------------------------------------------------------- */
+
+static const RlpSszField_t rlpSszWithdrawalFields[] = {
+  RLP_SSZ_FIELD_UINT(8),
+  RLP_SSZ_FIELD_UINT(8),
+  RLP_SSZ_FIELD_BYTES_VECTOR(RLP_ADDRESS_LEN),
+  RLP_SSZ_FIELD_UINT(8),
+};
+
+const RlpSszSchema_t rlpSszWithdrawalSchema = {
+  .fields = rlpSszWithdrawalFields,
+  .fieldsCnt = 4,
+  .fixedLen = 8 + 8 + RLP_ADDRESS_LEN + 8,
+  .isVariable = false,
+  .offsets = {0, 8, 16, 16 + RLP_ADDRESS_LEN},
+};
+
+static const RlpSszField_t rlpSszWithdrawal = RLP_SSZ_FIELD_CONTAINER(&rlpSszWithdrawalSchema);
+const RlpSszField_t rlpSszWithdrawals = RLP_SSZ_FIELD_LIST(&rlpSszWithdrawal, RLP_SSZ_MAX_WITHDRAWALS);
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+static inline uint32_t rlp_ssz_get_offset(const uint8_t *p) {
+  return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline void rlp_ssz_put_offset(uint8_t *p, size_t v) {
+  p[0] = (uint8_t) v;
+  p[1] = (uint8_t) (v >> 8);
+  p[2] = (uint8_t) (v >> 16);
+  p[3] = (uint8_t) (v >> 24);
+}
+
+static bool rlp_ssz_is_variable(const RlpSszField_t *f) {
+  return f->kind == RLP_SSZ_BYTES || f->kind == RLP_SSZ_LIST ||
+         (f->kind == RLP_SSZ_CONTAINER && f->schema->isVariable);
+}
+
+// Size of a fixed size type, or of its offset when variable
+static size_t rlp_ssz_fixed_len(const RlpSszField_t *f) {
+  if(rlp_ssz_is_variable(f))
+    return RLP_SSZ_OFFSET_LEN;
+  return f->kind == RLP_SSZ_CONTAINER ? f->schema->fixedLen : f->size;
+}
+
+// Span of variable field i: from its offset to the next variable field's offset, or the end
+static int rlp_ssz_var_span(const RlpSszSchema_t *s, const uint8_t *in, size_t len, size_t i, size_t *start, size_t *end) {
+  *start = rlp_ssz_get_offset(in + s->offsets[i]);
+  *end = len;
+  for(size_t j = i + 1; j < s->fieldsCnt; j++) {
+    if(rlp_ssz_is_variable(&s->fields[j])) {
+      *end = rlp_ssz_get_offset(in + s->offsets[j]);
+      break;
+    }
+  }
+  if(*start < s->fixedLen || *start > *end || *end > len)
+    return ERR_RLP_EINVAL;
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 RLP to SSZ                                 */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_ssz_put(const RlpSszField_t *f, const RlpItem_t *item, uint8_t *out, size_t cap);
+
+static int rlp_ssz_put_container(const RlpSszSchema_t *s, const RlpItem_t *list, uint8_t *out, size_t cap) {
+  RlpCursor_t cur;
+  if(!list->isList || rlp_cursor_init(&cur, list) < 0)
+    return ERR_RLP_EINVAL;
+  if(cap < s->fixedLen)
+    return ERR_RLP_EMSGSIZE;
+  size_t len = s->fixedLen;
+  for(size_t i = 0; i < s->fieldsCnt; i++) {
+    const RlpSszField_t *f = &s->fields[i];
+    RlpItem_t item;
+    int ret = rlp_cursor_next(&cur, &item);
+    if(ret <= 0)
+      return ret < 0 ? ret : ERR_RLP_EINVAL;
+    if(rlp_ssz_is_variable(f)) {
+      rlp_ssz_put_offset(out + s->offsets[i], len);
+      ret = rlp_ssz_put(f, &item, out + len, cap - len);
+      len += ret;
+    } else
+      ret = rlp_ssz_put(f, &item, out + s->offsets[i], rlp_ssz_fixed_len(f));
+    if(ret < 0)
+      return ret;
+  }
+  RlpItem_t extra;
+  if(rlp_cursor_next(&cur, &extra) != 0)
+    return ERR_RLP_EINVAL;
+  return (int) len;
+}
+
+static int rlp_ssz_put_list(const RlpSszField_t *f, const RlpItem_t *list, uint8_t *out, size_t cap) {
+  RlpCursor_t cur;
+  RlpItem_t item;
+  if(!list->isList || rlp_cursor_init(&cur, list) < 0)
+    return ERR_RLP_EINVAL;
+  // Count first, variable elements need the offset table in front of them
+  size_t cnt = 0;
+  int ret;
+  while((ret = rlp_cursor_next(&cur, &item)) == 1)
+    cnt++;
+  if(ret < 0)
+    return ret;
+  if(f->size && cnt > f->size)
+    return ERR_RLP_EINVAL;
+
+  const RlpSszField_t *e = f->elem;
+  bool variable = rlp_ssz_is_variable(e);
+  size_t elemLen = rlp_ssz_fixed_len(e);
+  size_t len = variable ? cnt * RLP_SSZ_OFFSET_LEN : 0;
+  if(cap < cnt * elemLen)
+    return ERR_RLP_EMSGSIZE;
+  rlp_cursor_init(&cur, list);
+  for(size_t i = 0; rlp_cursor_next(&cur, &item) == 1; i++) {
+    if(variable) {
+      rlp_ssz_put_offset(out + i * RLP_SSZ_OFFSET_LEN, len);
+      ret = rlp_ssz_put(e, &item, out + len, cap - len);
+      len += ret;
+    } else {
+      ret = rlp_ssz_put(e, &item, out + len, elemLen);
+      len += elemLen;
+    }
+    if(ret < 0)
+      return ret;
+  }
+  return (int) len;
+}
+
+// Writes the SSZ form of item; cap is exact for fixed size types
+static int rlp_ssz_put(const RlpSszField_t *f, const RlpItem_t *item, uint8_t *out, size_t cap) {
+  switch(f->kind) {
+  case RLP_SSZ_UINT:
+    // Canonical: no leading zero, so the byte count alone says whether it fits
+    if(item->isList || item->payloadLen > f->size || (item->payloadLen && item->payload[0] == 0))
+      return ERR_RLP_EINVAL;
+    for(size_t i = 0; i < f->size; i++)
+      out[i] = i < item->payloadLen ? item->payload[item->payloadLen - 1 - i] : 0;
+    return (int) f->size;
+  case RLP_SSZ_BYTES_VECTOR:
+    if(item->isList || item->payloadLen != f->size)
+      return ERR_RLP_EINVAL;
+    memcpy(out, item->payload, f->size);
+    return (int) f->size;
+  case RLP_SSZ_BYTES:
+    if(item->isList || (f->size && item->payloadLen > f->size))
+      return ERR_RLP_EINVAL;
+    if(item->payloadLen > cap)
+      return ERR_RLP_EMSGSIZE;
+    memcpy(out, item->payload, item->payloadLen);
+    return (int) item->payloadLen;
+  case RLP_SSZ_LIST:
+    return rlp_ssz_put_list(f, item, out, cap);
+  case RLP_SSZ_CONTAINER:
+    return rlp_ssz_put_container(f->schema, item, out, cap);
+  }
+  return ERR_RLP_EBADARG;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                 SSZ to RLP                                 */
+/* -------------------------------------------------------------------------- */
+
+// Writes the RLP form of in[0..len); out == NULL only measures it
+static int rlp_ssz_emit(const RlpSszField_t *f, const uint8_t *in, size_t len, uint8_t *out, size_t cap);
+
+static int rlp_ssz_emit_string(const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  size_t hdrLen = len == 1 && in[0] < 0x80 ? 0 : rlp_header_len(len);
+  if(out == NULL)
+    return (int) (hdrLen + len);
+  if(cap < hdrLen + len)
+    return ERR_RLP_EMSGSIZE;
+  if(hdrLen)
+    rlp_encode_header(out, hdrLen, len, false);
+  memcpy(out + hdrLen, in, len);
+  return (int) (hdrLen + len);
+}
+
+static int rlp_ssz_emit_uint(const uint8_t *in, size_t size, uint8_t *out, size_t cap) {
+  size_t n = size;
+  while(n && in[n - 1] == 0)
+    n--;
+  size_t hdrLen = n == 1 && in[0] < 0x80 ? 0 : 1;
+  if(out == NULL)
+    return (int) (hdrLen + n);
+  if(cap < hdrLen + n)
+    return ERR_RLP_EMSGSIZE;
+  if(hdrLen)
+    *out++ = (uint8_t) (0x80 + n);
+  for(size_t i = 0; i < n; i++)
+    out[i] = in[n - 1 - i];
+  return (int) (hdrLen + n);
+}
+
+static int rlp_ssz_emit_container(const RlpSszSchema_t *s, const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  if(len < s->fixedLen || (!s->isVariable && len != s->fixedLen))
+    return ERR_RLP_EINVAL;
+  size_t payloadLen = 0;
+  for(size_t i = 0; i < s->fieldsCnt; i++) {
+    const RlpSszField_t *f = &s->fields[i];
+    size_t start = s->offsets[i], end = start + rlp_ssz_fixed_len(f);
+    if(rlp_ssz_is_variable(f) && rlp_ssz_var_span(s, in, len, i, &start, &end) < 0)
+      return ERR_RLP_EINVAL;
+    int ret = rlp_ssz_emit(f, in + start, end - start, out ? out + payloadLen : NULL, cap - payloadLen);
+    if(ret < 0)
+      return ret;
+    payloadLen += ret;
+  }
+  return (int) payloadLen;
+}
+
+static int rlp_ssz_emit_list(const RlpSszField_t *f, const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  const RlpSszField_t *e = f->elem;
+  bool variable = rlp_ssz_is_variable(e);
+  size_t elemLen = rlp_ssz_fixed_len(e), cnt;
+  if(!variable)
+    cnt = elemLen ? len / elemLen : 0;
+  else
+    cnt = len >= RLP_SSZ_OFFSET_LEN ? rlp_ssz_get_offset(in) / RLP_SSZ_OFFSET_LEN : 0;
+  // Variable elements: the first offset ends the offset table, so it gives the count
+  if(variable && len && (cnt == 0 || rlp_ssz_get_offset(in) % RLP_SSZ_OFFSET_LEN || cnt * RLP_SSZ_OFFSET_LEN > len))
+    return ERR_RLP_EINVAL;
+  if((!variable && cnt * elemLen != len) || (f->size && cnt > f->size))
+    return ERR_RLP_EINVAL;
+
+  size_t payloadLen = 0;
+  for(size_t i = 0; i < cnt; i++) {
+    size_t start = i * elemLen, end = start + elemLen;
+    if(variable) {
+      start = rlp_ssz_get_offset(in + i * RLP_SSZ_OFFSET_LEN);
+      end = i + 1 < cnt ? rlp_ssz_get_offset(in + (i + 1) * RLP_SSZ_OFFSET_LEN) : len;
+      if(start > end || end > len)
+        return ERR_RLP_EINVAL;
+    }
+    int ret = rlp_ssz_emit(e, in + start, end - start, out ? out + payloadLen : NULL, cap - payloadLen);
+    if(ret < 0)
+      return ret;
+    payloadLen += ret;
+  }
+  return (int) payloadLen;
+}
+
+// Containers and lists: the payload is measured first, so its header can go out ahead of it
+static int rlp_ssz_emit_items(const RlpSszField_t *f, const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  int payloadLen = f->kind == RLP_SSZ_LIST ? rlp_ssz_emit_list(f, in, len, NULL, 0)
+                                           : rlp_ssz_emit_container(f->schema, in, len, NULL, 0);
+  if(payloadLen < 0)
+    return payloadLen;
+  size_t hdrLen = rlp_header_len(payloadLen);
+  if(out == NULL)
+    return (int) (hdrLen + payloadLen);
+  if(cap < hdrLen + payloadLen)
+    return ERR_RLP_EMSGSIZE;
+  rlp_encode_header(out, hdrLen, payloadLen, true);
+  int ret = f->kind == RLP_SSZ_LIST ? rlp_ssz_emit_list(f, in, len, out + hdrLen, payloadLen)
+                                    : rlp_ssz_emit_container(f->schema, in, len, out + hdrLen, payloadLen);
+  return ret < 0 ? ret : (int) (hdrLen + payloadLen);
+}
+
+static int rlp_ssz_emit(const RlpSszField_t *f, const uint8_t *in, size_t len, uint8_t *out, size_t cap) {
+  switch(f->kind) {
+  case RLP_SSZ_UINT:
+    if(len != f->size)
+      return ERR_RLP_EINVAL;
+    return rlp_ssz_emit_uint(in, len, out, cap);
+  case RLP_SSZ_BYTES_VECTOR:
+  case RLP_SSZ_BYTES:
+    if((f->kind == RLP_SSZ_BYTES_VECTOR && len != f->size) || (f->kind == RLP_SSZ_BYTES && f->size && len > f->size))
+      return ERR_RLP_EINVAL;
+    return rlp_ssz_emit_string(in, len, out, cap);
+  case RLP_SSZ_LIST:
+  case RLP_SSZ_CONTAINER:
+    return rlp_ssz_emit_items(f, in, len, out, cap);
+  }
+  return ERR_RLP_EBADARG;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_ssz_schema_init(RlpSszSchema_t *s, const RlpSszField_t *fields, size_t fieldsCnt)
+{
+  if(s == NULL || fields == NULL || fieldsCnt == 0 || fieldsCnt > RLP_SSZ_MAX_FIELDS)
+    return ERR_RLP_EBADARG;
+  s->fields = fields;
+  s->fieldsCnt = fieldsCnt;
+  s->fixedLen = 0;
+  s->isVariable = false;
+  for(size_t i = 0; i < fieldsCnt; i++) {
+    const RlpSszField_t *f = &fields[i];
+    if((f->kind == RLP_SSZ_UINT && (f->size == 0 || f->size > 32)) ||
+       (f->kind == RLP_SSZ_LIST && f->elem == NULL) || (f->kind == RLP_SSZ_CONTAINER && f->schema == NULL) ||
+       f->kind < RLP_SSZ_UINT || f->kind > RLP_SSZ_CONTAINER)
+      return ERR_RLP_EBADARG;
+    s->offsets[i] = (uint32_t) s->fixedLen;
+    s->fixedLen += rlp_ssz_fixed_len(f);
+    s->isVariable |= rlp_ssz_is_variable(f);
+  }
+  return ERR_RLP_OK;
+}
+
+int rlp_ssz_from_rlp(const RlpSszField_t *type, const void *rlpEncoded, size_t rlpEncodedLen, void *ssz, size_t sszCap)
+{
+  if(type == NULL || rlpEncoded == NULL || (ssz == NULL && sszCap))
+    return ERR_RLP_EBADARG;
+  RlpItem_t item;
+  int ret = rlp_decode_item(rlpEncoded, rlpEncodedLen, &item);
+  if(ret >= 0 && (size_t) ret != rlpEncodedLen)
+    ret = ERR_RLP_EINVAL;
+  if(ret < 0)
+    return ret;
+  if(!rlp_ssz_is_variable(type) && sszCap < rlp_ssz_fixed_len(type))
+    return ERR_RLP_EMSGSIZE;
+  return rlp_ssz_put(type, &item, ssz, sszCap > INT32_MAX ? INT32_MAX : sszCap);
+}
+
+int rlp_ssz_rlp_len(const RlpSszField_t *type, const void *ssz, size_t sszLen)
+{
+  if(type == NULL || (ssz == NULL && sszLen))
+    return ERR_RLP_EBADARG;
+  return rlp_ssz_emit(type, ssz, sszLen, NULL, 0);
+}
+
+int rlp_ssz_to_rlp(const RlpSszField_t *type, const void *ssz, size_t sszLen, void *rlpEncoded, size_t rlpEncodedCap)
+{
+  if(type == NULL || (ssz == NULL && sszLen) || rlpEncoded == NULL)
+    return ERR_RLP_EBADARG;
+  return rlp_ssz_emit(type, ssz, sszLen, rlpEncoded, rlpEncodedCap > INT32_MAX ? INT32_MAX : rlpEncodedCap);
+}
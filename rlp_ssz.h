@@ -0,0 +1,105 @@
+/**
+ * RLP Serializer - SSZ Transcoder
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Schema driven conversion between RLP and SSZ. RLP is read with the zero copy decoder
+ * and SSZ written directly: fixed size fields at offsets precomputed in the schema,
+ * variable size parts appended behind them. The reverse direction reads SSZ in place.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_SSZ_H_
+#define __RLP_SSZ_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_SSZ_MAX_FIELDS       32
+#define RLP_SSZ_OFFSET_LEN       4      // SSZ offsets are little endian uint32
+#define RLP_SSZ_MAX_WITHDRAWALS  16     // MAX_WITHDRAWALS_PER_PAYLOAD
+
+typedef enum {
+  RLP_SSZ_UINT = 1,     // uintN: trimmed big endian RLP string <-> size bytes little endian
+  RLP_SSZ_BYTES_VECTOR, // ByteVector[size]: RLP string of exactly size bytes
+  RLP_SSZ_BYTES,        // ByteList[size]: RLP string, variable size in SSZ
+  RLP_SSZ_LIST,         // List[elem, size]: RLP list, variable size in SSZ
+  RLP_SSZ_CONTAINER,    // Container: RLP list of the fields in order
+} RlpSszKind_e;
+
+struct rlpSszSchema;
+
+// One SSZ type. size is the width of a uint (1 to 32 bytes), the length of a byte vector,
+// or the limit of a byte list or list (0 for none).
+typedef struct rlpSszField {
+  RlpSszKind_e                kind;
+  uint32_t                    size;
+  const struct rlpSszField    *elem;     // RLP_SSZ_LIST: element type
+  const struct rlpSszSchema   *schema;   // RLP_SSZ_CONTAINER: fields
+} RlpSszField_t;
+#define RLP_SSZ_FIELD_UINT(bytes)         { .kind = RLP_SSZ_UINT, .size = (bytes) }
+#define RLP_SSZ_FIELD_BYTES_VECTOR(len)   { .kind = RLP_SSZ_BYTES_VECTOR, .size = (len) }
+#define RLP_SSZ_FIELD_BYTES(limit)        { .kind = RLP_SSZ_BYTES, .size = (limit) }
+#define RLP_SSZ_FIELD_LIST(e, limit)      { .kind = RLP_SSZ_LIST, .size = (limit), .elem = (e) }
+#define RLP_SSZ_FIELD_CONTAINER(s)        { .kind = RLP_SSZ_CONTAINER, .schema = (s) }
+
+// Container layout, computed once by rlp_ssz_schema_init()
+typedef struct rlpSszSchema {
+  const RlpSszField_t  *fields;
+  size_t               fieldsCnt;
+  size_t               fixedLen;                     // fixed fields inline plus an offset per variable field
+  bool                 isVariable;
+  uint32_t             offsets[RLP_SSZ_MAX_FIELDS];  // where each field, or its offset, sits in the fixed part
+} RlpSszSchema_t;
+
+// EIP-4895 withdrawal: Container(index: uint64, validator_index: uint64, address: Bytes20, amount: uint64)
+extern const RlpSszSchema_t rlpSszWithdrawalSchema;
+// List[Withdrawal, MAX_WITHDRAWALS_PER_PAYLOAD], the RLP side is rlp_encode_withdrawals() output
+extern const RlpSszField_t rlpSszWithdrawals;
+
+
+// Lays out a container; nested container schemas must be initialised first
+// Returns ERR_RLP_OK, or a negative error value
+int rlp_ssz_schema_init(RlpSszSchema_t *s, const RlpSszField_t *fields, size_t fieldsCnt);
+
+// Converts one RLP item of the given type to SSZ. Integers must be canonical and fit their width.
+// Returns length of output in bytes, or a negative error value
+int rlp_ssz_from_rlp(const RlpSszField_t *type, const void *rlpEncoded, size_t rlpEncodedLen, void *ssz, size_t sszCap);
+
+// Returns the exact number of bytes rlp_ssz_to_rlp() produces for ssz, or a negative error value
+int rlp_ssz_rlp_len(const RlpSszField_t *type, const void *ssz, size_t sszLen);
+
+// Converts an SSZ value of the given type to RLP; offsets are checked as they are read
+// Returns length of output in bytes, or a negative error value
+int rlp_ssz_to_rlp(const RlpSszField_t *type, const void *ssz, size_t sszLen, void *rlpEncoded, size_t rlpEncodedCap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
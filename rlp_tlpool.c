@@ -0,0 +1,222 @@
+/**
+ * RLP Serializer - Thread Local Pools
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Per-thread size class free lists with lock-free remote frees.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_tlpool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/*                             Internal Constants                             */
+/* -------------------------------------------------------------------------- */
+
+#define RLP_TL_CLASSES       6       // 64, 256, 1K, 4K, 16K, 64K
+#define RLP_TL_MIN_SHIFT     6
+#define RLP_TL_SLAB_SIZE     (256 * 1024)
+
+/* -------------------------------------------------------------------------- */
+/*                                  Utilities                                 */
+/* -------------------------------------------------------------------------- */
+
+struct rlpTlCache;
+
+// Sits in front of every block; keeps the user pointer 16 byte aligned.
+// While a block is free, the free list link lives in its body.
+typedef struct rlpTlHdr {
+  struct rlpTlCache  *owner;
+  size_t             cls;
+} RlpTlHdr_t;
+
+static inline RlpTlHdr_t **rlp_tl_link(RlpTlHdr_t *h) {
+  return (RlpTlHdr_t **) (h + 1);
+}
+
+typedef struct rlpTlCache {
+  RlpTlHdr_t                    *freeList[RLP_TL_CLASSES];
+  // Other threads push here; the owner takes the whole stack with one exchange,
+  // so pops never race with each other and there is no ABA problem
+  _Atomic(RlpTlHdr_t *)         remoteFree;
+  struct rlpTlCache             *nextOrphan;
+} RlpTlCache_t;
+
+static _Thread_local RlpTlCache_t *tlCache;
+static atomic_size_t tlGlobalAllocs;
+
+// Caches of exited threads are kept for reuse by new threads, blocks they own
+// may still be out in other threads. Only touched on thread start and exit.
+static pthread_mutex_t tlOrphanLock = PTHREAD_MUTEX_INITIALIZER;
+static RlpTlCache_t *tlOrphans;
+static pthread_key_t tlExitKey;
+static pthread_once_t tlExitKeyOnce = PTHREAD_ONCE_INIT;
+
+static void rlp_tl_thread_exit(void *cache) {
+  RlpTlCache_t *c = cache;
+  pthread_mutex_lock(&tlOrphanLock);
+  c->nextOrphan = tlOrphans;
+  tlOrphans = c;
+  pthread_mutex_unlock(&tlOrphanLock);
+}
+
+static void rlp_tl_make_key(void) {
+  pthread_key_create(&tlExitKey, rlp_tl_thread_exit);
+}
+
+static RlpTlCache_t *rlp_tl_cache(void) {
+  if(tlCache)
+    return tlCache;
+  pthread_once(&tlExitKeyOnce, rlp_tl_make_key);
+  pthread_mutex_lock(&tlOrphanLock);
+  RlpTlCache_t *c = tlOrphans;
+  if(c)
+    tlOrphans = c->nextOrphan;
+  pthread_mutex_unlock(&tlOrphanLock);
+  if(c == NULL) {
+    c = calloc(1, sizeof(*c));
+    if(c == NULL)
+      return NULL;
+    atomic_init(&c->remoteFree, NULL);
+  }
+  pthread_setspecific(tlExitKey, c);
+  tlCache = c;
+  return c;
+}
+
+static inline int rlp_tl_class(size_t n) {
+  int cls = 0;
+  for(size_t sz = (size_t) 1 << RLP_TL_MIN_SHIFT; sz < n; sz <<= 2)
+    cls++;
+  return cls;
+}
+
+static inline size_t rlp_tl_class_size(int cls) {
+  return (size_t) 1 << (RLP_TL_MIN_SHIFT + 2 * cls);
+}
+
+// Moves blocks freed by other threads onto the local free lists
+static void rlp_tl_drain_remote(RlpTlCache_t *c) {
+  RlpTlHdr_t *h = atomic_exchange_explicit(&c->remoteFree, NULL, memory_order_acquire);
+  while(h) {
+    RlpTlHdr_t *next = *rlp_tl_link(h);
+    *rlp_tl_link(h) = c->freeList[h->cls];
+    c->freeList[h->cls] = h;
+    h = next;
+  }
+}
+
+// Carves a fresh slab into blocks of one class, the only path to the global allocator
+static bool rlp_tl_refill(RlpTlCache_t *c, int cls) {
+  size_t blockSz = sizeof(RlpTlHdr_t) + rlp_tl_class_size(cls);
+  size_t slabSz = RLP_TL_SLAB_SIZE;
+  if(slabSz < 4 * blockSz)
+    slabSz = 4 * blockSz;
+  uint8_t *slab = malloc(slabSz);
+  if(slab == NULL)
+    return false;
+  atomic_fetch_add_explicit(&tlGlobalAllocs, 1, memory_order_relaxed);
+  for(size_t off = 0; off + blockSz <= slabSz; off += blockSz) {
+    RlpTlHdr_t *h = (RlpTlHdr_t *) (slab + off);
+    h->owner = c;
+    h->cls = cls;
+    *rlp_tl_link(h) = c->freeList[cls];
+    c->freeList[cls] = h;
+  }
+  return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+void *rlp_tl_alloc(size_t n)
+{
+  if(n > RLP_TL_MAX_ALLOC)
+    return NULL;
+  RlpTlCache_t *c = rlp_tl_cache();
+  if(c == NULL)
+    return NULL;
+  int cls = rlp_tl_class(n);
+  if(c->freeList[cls] == NULL) {
+    if(atomic_load_explicit(&c->remoteFree, memory_order_relaxed))
+      rlp_tl_drain_remote(c);
+    if(c->freeList[cls] == NULL && !rlp_tl_refill(c, cls))
+      return NULL;
+  }
+  RlpTlHdr_t *h = c->freeList[cls];
+  c->freeList[cls] = *rlp_tl_link(h);
+  return h + 1;
+}
+
+void rlp_tl_free(void *p)
+{
+  if(p == NULL)
+    return;
+  RlpTlHdr_t *h = (RlpTlHdr_t *) p - 1;
+  RlpTlCache_t *owner = h->owner;
+  if(owner == tlCache) {
+    *rlp_tl_link(h) = owner->freeList[h->cls];
+    owner->freeList[h->cls] = h;
+    return;
+  }
+  // Remote free: push onto the owner's stack, it drains the stack when a class runs dry
+  RlpTlHdr_t *head = atomic_load_explicit(&owner->remoteFree, memory_order_relaxed);
+  do {
+    *rlp_tl_link(h) = head;
+  } while(!atomic_compare_exchange_weak_explicit(&owner->remoteFree, &head, h,
+                                                 memory_order_release, memory_order_relaxed));
+}
+
+RlpGather_t *rlp_tl_gather_new(size_t segsCap, size_t scratchCap)
+{
+  size_t segsOff = (sizeof(RlpGather_t) + 15) & ~(size_t) 15;
+  if(segsCap > (SIZE_MAX - segsOff) / sizeof(RlpGatherSeg_t))
+    return NULL;
+  size_t scratchOff = segsOff + segsCap * sizeof(RlpGatherSeg_t);
+  if(scratchCap > SIZE_MAX - scratchOff)
+    return NULL;
+  uint8_t *block = rlp_tl_alloc(scratchOff + scratchCap);
+  if(block == NULL)
+    return NULL;
+  RlpGather_t *g = (RlpGather_t *) block;
+  rlp_gather_init(g, (RlpGatherSeg_t *) (block + segsOff), segsCap, block + scratchOff, scratchCap);
+  return g;
+}
+
+RlpCursor_t *rlp_tl_cursors_new(size_t depth)
+{
+  if(depth > SIZE_MAX / sizeof(RlpCursor_t))
+    return NULL;
+  return rlp_tl_alloc(depth * sizeof(RlpCursor_t));
+}
+
+size_t rlp_tl_global_allocs(void)
+{
+  return atomic_load_explicit(&tlGlobalAllocs, memory_order_relaxed);
+}
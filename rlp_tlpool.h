@@ -0,0 +1,74 @@
+/**
+ * RLP Serializer - Thread Local Pools
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Per-thread free lists for encoder/decoder scratch state: gather contexts,
+ * cursor stacks for nested lists and output blocks. A block freed by another
+ * thread goes back to its owner through a lock-free remote free stack, so in
+ * steady state no call reaches the global allocator or takes a lock.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_TLPOOL_H_
+#define __RLP_TLPOOL_H_
+
+#include "rlp_serializer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Size classes are 64 B to 64 KB in powers of four; larger requests return NULL
+#define RLP_TL_MAX_ALLOC     (64 * 1024)
+#define RLP_TL_BLOCK_SIZE    (16 * 1024)   // rlp_tl_block_new()
+
+// Returns n bytes (16 byte aligned) from the calling thread's pool, or NULL
+void *rlp_tl_alloc(size_t n);
+
+// Returns a block to the thread that allocated it; callable from any thread
+void rlp_tl_free(void *p);
+
+// Gather context with segsCap segments and scratchCap bytes of scratch in one block,
+// initialized and ready for use. Release with rlp_tl_free().
+RlpGather_t *rlp_tl_gather_new(size_t segsCap, size_t scratchCap);
+
+// Cursor stack for walking lists nested up to depth levels. Release with rlp_tl_free().
+RlpCursor_t *rlp_tl_cursors_new(size_t depth);
+
+// Output block of RLP_TL_BLOCK_SIZE bytes. Release with rlp_tl_free().
+static inline uint8_t *rlp_tl_block_new(void) {
+  return (uint8_t *) rlp_tl_alloc(RLP_TL_BLOCK_SIZE);
+}
+
+// Number of slabs taken from the global allocator by all threads so far;
+// flat once every thread's pools are warm
+size_t rlp_tl_global_allocs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
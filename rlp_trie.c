@@ -0,0 +1,916 @@
+/**
+ * RLP Serializer - Disk Backed Trie
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Merkle Patricia trie whose nodes live as RLP in the node store. Decoded nodes are
+ * kept in a sharded LRU cache, and lookups walk the trie one level at a time for a
+ * whole batch of keys, prefetching every child of the next level before decoding it.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_trie.h"
+#include <string.h>
+
+#define RLP_TRIE_NIL UINT32_MAX
+
+static inline uint8_t rlp_trie_nibble(const uint8_t *key, size_t i) {
+  return (i & 1) ? key[i >> 1] & 0x0f : key[i >> 1] >> 4;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Cache                                   */
+/* -------------------------------------------------------------------------- */
+
+// Keys are Keccak outputs, any of their bytes is a good hash
+static inline RlpTrieCacheShard_t *rlp_trie_shard(RlpTrie_t *t, const uint8_t *key) {
+  return &t->shards[key[0] % RLP_TRIE_CACHE_SHARDS];
+}
+
+static inline uint32_t rlp_trie_bucket(const RlpTrieCacheShard_t *sh, const uint8_t *key) {
+  uint32_t h;
+  memcpy(&h, key + 1, sizeof(h));
+  return h & sh->bucketsMask;
+}
+
+static void rlp_trie_lru_unlink(RlpTrieCacheShard_t *sh, uint32_t i) {
+  RlpTrieCacheEntry_t *e = &sh->entries[i];
+  if(e->prev != RLP_TRIE_NIL)
+    sh->entries[e->prev].next = e->next;
+  else
+    sh->head = e->next;
+  if(e->next != RLP_TRIE_NIL)
+    sh->entries[e->next].prev = e->prev;
+  else
+    sh->tail = e->prev;
+}
+
+static void rlp_trie_lru_push(RlpTrieCacheShard_t *sh, uint32_t i) {
+  RlpTrieCacheEntry_t *e = &sh->entries[i];
+  e->prev = RLP_TRIE_NIL;
+  e->next = sh->head;
+  if(sh->head != RLP_TRIE_NIL)
+    sh->entries[sh->head].prev = i;
+  else
+    sh->tail = i;
+  sh->head = i;
+}
+
+static uint32_t rlp_trie_cache_find(const RlpTrieCacheShard_t *sh, const uint8_t *key) {
+  uint32_t i = sh->buckets[rlp_trie_bucket(sh, key)];
+  while(i != RLP_TRIE_NIL && memcmp(sh->entries[i].key, key, RLP_KECCAK256_LEN) != 0)
+    i = sh->entries[i].hnext;
+  return i;
+}
+
+static bool rlp_trie_cache_get(RlpTrie_t *t, const uint8_t *key, RlpTrieNode_t *node) {
+  RlpTrieCacheShard_t *sh = rlp_trie_shard(t, key);
+  if(sh->cap == 0)
+    return false;
+  pthread_mutex_lock(&sh->lock);
+  uint32_t i = rlp_trie_cache_find(sh, key);
+  if(i != RLP_TRIE_NIL) {
+    rlp_trie_lru_unlink(sh, i);
+    rlp_trie_lru_push(sh, i);
+    *node = sh->entries[i].node;
+  }
+  pthread_mutex_unlock(&sh->lock);
+  return i != RLP_TRIE_NIL;
+}
+
+static void rlp_trie_cache_put(RlpTrie_t *t, const uint8_t *key, const RlpTrieNode_t *node) {
+  RlpTrieCacheShard_t *sh = rlp_trie_shard(t, key);
+  if(sh->cap == 0)
+    return;
+  pthread_mutex_lock(&sh->lock);
+  // Another thread may have loaded the same node meanwhile
+  if(rlp_trie_cache_find(sh, key) != RLP_TRIE_NIL) {
+    pthread_mutex_unlock(&sh->lock);
+    return;
+  }
+  uint32_t i;
+  if(sh->cnt < sh->cap) {
+    i = sh->cnt++;
+  } else {
+    i = sh->tail;
+    rlp_trie_lru_unlink(sh, i);
+    uint32_t *link = &sh->buckets[rlp_trie_bucket(sh, sh->entries[i].key)];
+    while(*link != i)
+      link = &sh->entries[*link].hnext;
+    *link = sh->entries[i].hnext;
+  }
+  RlpTrieCacheEntry_t *e = &sh->entries[i];
+  uint32_t b = rlp_trie_bucket(sh, key);
+  memcpy(e->key, key, RLP_KECCAK256_LEN);
+  e->node = *node;
+  e->hnext = sh->buckets[b];
+  sh->buckets[b] = i;
+  rlp_trie_lru_push(sh, i);
+  pthread_mutex_unlock(&sh->lock);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Decoding                                 */
+/* -------------------------------------------------------------------------- */
+
+static int rlp_trie_ref_from_item(const RlpItem_t *item, RlpTrieRef_t *ref) {
+  if(!item->isList) {
+    if(item->payloadLen != 0 && item->payloadLen != RLP_KECCAK256_LEN)
+      return ERR_RLP_EINVAL;
+    *ref = (RlpTrieRef_t) { .buff = item->payload, .len = (uint8_t) item->payloadLen, .isHash = item->payloadLen != 0 };
+    return ERR_RLP_OK;
+  }
+  // Nodes shorter than a hash are embedded in their parent
+  if(item->encodedLen >= RLP_KECCAK256_LEN)
+    return ERR_RLP_EINVAL;
+  *ref = (RlpTrieRef_t) { .buff = item->payload - (item->encodedLen - item->payloadLen), .len = (uint8_t) item->encodedLen, .isHash = false };
+  return ERR_RLP_OK;
+}
+
+// Hex prefix encoded path into one nibble per byte; path holds 2 * RLP_TRIE_MAX_KEY nibbles
+static int rlp_trie_decode_path(const RlpItem_t *item, uint8_t *path, uint8_t *pathLen, bool *isLeaf) {
+  if(item->isList || item->payloadLen == 0)
+    return ERR_RLP_EINVAL;
+  uint8_t flag = item->payload[0] >> 4;
+  bool odd = flag & 1;
+  size_t len = 2 * (item->payloadLen - 1) + odd;
+  if(flag > 3 || len > 2 * RLP_TRIE_MAX_KEY || (!odd && (item->payload[0] & 0x0f)))
+    return ERR_RLP_EINVAL;
+  size_t o = 0;
+  if(odd)
+    path[o++] = item->payload[0] & 0x0f;
+  for(size_t i = 1; i < item->payloadLen; i++) {
+    path[o++] = item->payload[i] >> 4;
+    path[o++] = item->payload[i] & 0x0f;
+  }
+  *pathLen = (uint8_t) len;
+  *isLeaf = flag & 2;
+  return ERR_RLP_OK;
+}
+
+int rlp_trie_decode_node(const void *encoded, size_t len, RlpTrieNode_t *node)
+{
+  if(encoded == NULL || node == NULL)
+    return ERR_RLP_EBADARG;
+  RlpItem_t list, items[17];
+  RlpCursor_t cur;
+  int err = rlp_decode_item(encoded, len, &list);
+  if(err < 0)
+    return err;
+  if(list.encodedLen != len)
+    return ERR_RLP_EINVAL;
+  node->pathLen = 0;
+  node->value = (RlpItem_t) { 0 };
+  if(!list.isList) {
+    if(list.payloadLen != 0)
+      return ERR_RLP_EINVAL;
+    node->type = RLP_TRIE_EMPTY;
+    return ERR_RLP_OK;
+  }
+
+  size_t n = 0;
+  rlp_cursor_init(&cur, &list);
+  while(n < 17 && (err = rlp_cursor_next(&cur, &items[n])) > 0)
+    n++;
+  if(err < 0)
+    return err;
+  if(n == 17 && cur.pos != cur.end)
+    return ERR_RLP_EINVAL;
+
+  if(n == 17) {
+    node->type = RLP_TRIE_BRANCH;
+    for(int i = 0; i < 16; i++) {
+      if((err = rlp_trie_ref_from_item(&items[i], &node->children[i])) < 0)
+        return err;
+    }
+    if(items[16].isList)
+      return ERR_RLP_EINVAL;
+    if(items[16].payloadLen)
+      node->value = items[16];
+    return ERR_RLP_OK;
+  }
+  if(n != 2)
+    return ERR_RLP_EINVAL;
+
+  bool isLeaf;
+  if((err = rlp_trie_decode_path(&items[0], node->path, &node->pathLen, &isLeaf)) < 0)
+    return err;
+  if(isLeaf) {
+    if(items[1].isList)
+      return ERR_RLP_EINVAL;
+    node->type = RLP_TRIE_LEAF;
+    node->value = items[1];
+    return ERR_RLP_OK;
+  }
+  node->type = RLP_TRIE_EXTENSION;
+  if(node->pathLen == 0 || (err = rlp_trie_ref_from_item(&items[1], &node->children[0])) < 0)
+    return node->pathLen == 0 ? ERR_RLP_EINVAL : err;
+  return node->children[0].len ? ERR_RLP_OK : ERR_RLP_EINVAL;
+}
+
+// Embedded nodes are decoded in place, hashed ones read from the store and cached
+static int rlp_trie_load_uncached(RlpTrie_t *t, const RlpTrieRef_t *ref, RlpTrieNode_t *node) {
+  if(!ref->isHash)
+    return rlp_trie_decode_node(ref->buff, ref->len, node);
+  RlpItem_t item;
+  int err = rlp_node_store_get(t->store, ref->buff, &item);
+  if(err < 0)
+    return err;
+  const uint8_t *encoded = item.payload - (item.encodedLen - item.payloadLen);
+  if((err = rlp_trie_decode_node(encoded, item.encodedLen, node)) < 0)
+    return err;
+  rlp_trie_cache_put(t, ref->buff, node);
+  return ERR_RLP_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Building                                 */
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+  uint8_t  buff[RLP_KECCAK256_LEN];
+  uint8_t  len;
+  bool     isHash;
+} RlpTrieBuildRef_t;
+
+typedef struct {
+  const RlpTrieKv_t  *kvs;
+  uint8_t            *out;      // encodings of the hashed nodes, back to back
+  size_t             outLen;
+  size_t             outCap;
+  size_t             *ends;     // end offset of each node in out
+  size_t             endsCnt;
+  size_t             endsCap;
+} RlpTrieBuilder_t;
+
+static uint8_t *rlp_trie_build_reserve(RlpTrieBuilder_t *b, size_t n) {
+  if(b->outCap - b->outLen < n) {
+    size_t cap = b->outCap ? b->outCap : 4096;
+    while(cap - b->outLen < n)
+      cap *= 2;
+    uint8_t *out = realloc(b->out, cap);
+    if(out == NULL)
+      return NULL;
+    b->out = out;
+    b->outCap = cap;
+  }
+  uint8_t *p = b->out + b->outLen;
+  b->outLen += n;
+  return p;
+}
+
+static inline size_t rlp_trie_string_len(const uint8_t *s, size_t n) {
+  return n == 1 && s[0] < 0x80 ? 1 : rlp_header_len(n) + n;
+}
+
+static uint8_t *rlp_trie_put_string(uint8_t *p, const uint8_t *s, size_t n) {
+  if(!(n == 1 && s[0] < 0x80))
+    p += rlp_encode_header(p, 9, n, false);
+  memcpy(p, s, n);
+  return p + n;
+}
+
+static inline size_t rlp_trie_ref_len(const RlpTrieBuildRef_t *ref) {
+  return ref->isHash ? 1 + RLP_KECCAK256_LEN : ref->len ? ref->len : 1;
+}
+
+static uint8_t *rlp_trie_put_ref(uint8_t *p, const RlpTrieBuildRef_t *ref) {
+  if(ref->isHash)
+    return rlp_trie_put_string(p, ref->buff, RLP_KECCAK256_LEN);
+  if(ref->len == 0) {
+    *p = 0x80;
+    return p + 1;
+  }
+  memcpy(p, ref->buff, ref->len);
+  return p + ref->len;
+}
+
+// Hex prefix encoding of nibbles [from, to) of key
+static size_t rlp_trie_hp(uint8_t *out, const uint8_t *key, size_t from, size_t to, bool isLeaf) {
+  bool odd = (to - from) & 1;
+  size_t o = 1;
+  out[0] = (uint8_t) (((isLeaf ? 2 : 0) + odd) << 4);
+  if(odd)
+    out[0] |= rlp_trie_nibble(key, from++);
+  for(; from < to; from += 2)
+    out[o++] = (uint8_t) (rlp_trie_nibble(key, from) << 4 | rlp_trie_nibble(key, from + 1));
+  return o;
+}
+
+// Node at out[start..outLen) is complete: embed it in the parent or hash and keep it
+static int rlp_trie_build_finish(RlpTrieBuilder_t *b, size_t start, RlpTrieBuildRef_t *ref, bool isRoot) {
+  size_t len = b->outLen - start;
+  if(len < RLP_KECCAK256_LEN && !isRoot) {
+    memcpy(ref->buff, b->out + start, len);
+    ref->len = (uint8_t) len;
+    ref->isHash = false;
+    b->outLen = start;
+    return ERR_RLP_OK;
+  }
+  if(b->endsCnt == b->endsCap) {
+    size_t cap = b->endsCap ? 2 * b->endsCap : 256;
+    size_t *ends = realloc(b->ends, cap * sizeof(*ends));
+    if(ends == NULL)
+      return ERR_RLP_ENOMEM;
+    b->ends = ends;
+    b->endsCap = cap;
+  }
+  b->ends[b->endsCnt++] = b->outLen;
+  rlp_keccak256(b->out + start, len, ref->buff);
+  ref->len = RLP_KECCAK256_LEN;
+  ref->isHash = true;
+  return ERR_RLP_OK;
+}
+
+// Writes a list header for payloadLen bytes and returns where the payload goes
+static uint8_t *rlp_trie_build_list(RlpTrieBuilder_t *b, size_t payloadLen) {
+  uint8_t *p = rlp_trie_build_reserve(b, rlp_header_len(payloadLen) + payloadLen);
+  return p ? p + rlp_encode_header(p, 9, payloadLen, true) : NULL;
+}
+
+// Builds the node for kvs[lo, hi), whose keys all share their first depth nibbles
+static int rlp_trie_build_node(RlpTrieBuilder_t *b, size_t lo, size_t hi, size_t depth,
+                               RlpTrieBuildRef_t *ref, bool isRoot) {
+  const RlpTrieKv_t *kvs = b->kvs;
+  uint8_t hp[1 + RLP_TRIE_MAX_KEY];
+  uint8_t *p;
+  int err;
+
+  if(hi - lo == 1) {
+    const RlpTrieKv_t *kv = &kvs[lo];
+    size_t start = b->outLen;
+    size_t hpLen = rlp_trie_hp(hp, kv->key, depth, 2 * kv->keyLen, true);
+    if((p = rlp_trie_build_list(b, rlp_trie_string_len(hp, hpLen) + rlp_trie_string_len(kv->value, kv->valueLen))) == NULL)
+      return ERR_RLP_ENOMEM;
+    p = rlp_trie_put_string(p, hp, hpLen);
+    rlp_trie_put_string(p, kv->value, kv->valueLen);
+    return rlp_trie_build_finish(b, start, ref, isRoot);
+  }
+
+  // Keys are sorted, so the first and last share the prefix of them all
+  const RlpTrieKv_t *first = &kvs[lo], *last = &kvs[hi - 1];
+  size_t end = 2 * (first->keyLen < last->keyLen ? first->keyLen : last->keyLen);
+  size_t cp = depth;
+  while(cp < end && rlp_trie_nibble(first->key, cp) == rlp_trie_nibble(last->key, cp))
+    cp++;
+  if(cp > depth) {
+    RlpTrieBuildRef_t child;
+    if((err = rlp_trie_build_node(b, lo, hi, cp, &child, false)) < 0)
+      return err;
+    size_t start = b->outLen;
+    size_t hpLen = rlp_trie_hp(hp, first->key, depth, cp, false);
+    if((p = rlp_trie_build_list(b, rlp_trie_string_len(hp, hpLen) + rlp_trie_ref_len(&child))) == NULL)
+      return ERR_RLP_ENOMEM;
+    p = rlp_trie_put_string(p, hp, hpLen);
+    rlp_trie_put_ref(p, &child);
+    return rlp_trie_build_finish(b, start, ref, isRoot);
+  }
+
+  // Branch; only the first key can end here
+  RlpTrieBuildRef_t children[16];
+  const RlpTrieKv_t *value = NULL;
+  size_t i = lo;
+  memset(children, 0, sizeof(children));
+  if(2 * kvs[i].keyLen == depth)
+    value = &kvs[i++];
+  while(i < hi) {
+    uint8_t nib = rlp_trie_nibble(kvs[i].key, depth);
+    size_t j = i + 1;
+    while(j < hi && rlp_trie_nibble(kvs[j].key, depth) == nib)
+      j++;
+    if((err = rlp_trie_build_node(b, i, j, depth + 1, &children[nib], false)) < 0)
+      return err;
+    i = j;
+  }
+  size_t start = b->outLen;
+  size_t payloadLen = value ? rlp_trie_string_len(value->value, value->valueLen) : 1;
+  for(int c = 0; c < 16; c++)
+    payloadLen += rlp_trie_ref_len(&children[c]);
+  if((p = rlp_trie_build_list(b, payloadLen)) == NULL)
+    return ERR_RLP_ENOMEM;
+  for(int c = 0; c < 16; c++)
+    p = rlp_trie_put_ref(p, &children[c]);
+  if(value)
+    rlp_trie_put_string(p, value->value, value->valueLen);
+  else
+    *p = 0x80;
+  return rlp_trie_build_finish(b, start, ref, isRoot);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   Lookups                                  */
+/* -------------------------------------------------------------------------- */
+
+typedef struct {
+  RlpTrieRef_t  ref;
+  uint32_t      lo;         // keys [lo, hi) continue below ref
+  uint32_t      hi;
+  uint32_t      depth;      // nibbles consumed above ref
+  bool          loaded;
+} RlpTrieTask_t;
+
+static bool rlp_trie_path_matches(const RlpTrieNode_t *node, const RlpGatherSeg_t *key, size_t depth) {
+  if(2 * key->len < depth + node->pathLen)
+    return false;
+  for(size_t i = 0; i < node->pathLen; i++) {
+    if(rlp_trie_nibble(key->buff, depth + i) != node->path[i])
+      return false;
+  }
+  return true;
+}
+
+// Resolves task's keys against its node: values for keys ending here, tasks for the level below
+static void rlp_trie_descend(const RlpTrieNode_t *node, const RlpTrieTask_t *task, const RlpGatherSeg_t *keys,
+                             RlpItem_t *values, RlpTrieTask_t *next, size_t *nextCnt, int *found) {
+  size_t i = task->lo, depth = task->depth;
+  switch(node->type) {
+    case RLP_TRIE_EMPTY:
+      break;
+    case RLP_TRIE_LEAF:
+      for(; i < task->hi; i++) {
+        if(2 * keys[i].len == depth + node->pathLen && rlp_trie_path_matches(node, &keys[i], depth)) {
+          values[i] = node->value;
+          (*found)++;
+        }
+      }
+      break;
+    case RLP_TRIE_EXTENSION:
+      // Keys through the extension are contiguous in sorted order
+      while(i < task->hi && !rlp_trie_path_matches(node, &keys[i], depth))
+        i++;
+      if(i < task->hi) {
+        size_t j = i + 1;
+        while(j < task->hi && rlp_trie_path_matches(node, &keys[j], depth))
+          j++;
+        next[(*nextCnt)++] = (RlpTrieTask_t) { .ref = node->children[0], .lo = i, .hi = j, .depth = depth + node->pathLen };
+      }
+      break;
+    case RLP_TRIE_BRANCH:
+      for(; i < task->hi && 2 * keys[i].len == depth; i++) {
+        if(node->value.payload) {
+          values[i] = node->value;
+          (*found)++;
+        }
+      }
+      while(i < task->hi) {
+        uint8_t nib = rlp_trie_nibble(keys[i].buff, depth);
+        size_t j = i + 1;
+        while(j < task->hi && rlp_trie_nibble(keys[j].buff, depth) == nib)
+          j++;
+        if(node->children[nib].len)
+          next[(*nextCnt)++] = (RlpTrieTask_t) { .ref = node->children[nib], .lo = i, .hi = j, .depth = depth + 1 };
+        i = j;
+      }
+      break;
+  }
+}
+
+// Level by level walk; cur and next hold keysCnt tasks, nodes keysCnt nodes
+static int rlp_trie_lookup(RlpTrie_t *t, const uint8_t *root, const RlpGatherSeg_t *keys, size_t keysCnt,
+                           RlpItem_t *values, RlpTrieTask_t *cur, RlpTrieTask_t *next, RlpTrieNode_t *nodes) {
+  bool fromDisk = t->flags & RLP_TRIE_READAHEAD;
+  size_t curCnt = 1;
+  int found = 0, err;
+  for(size_t i = 0; i < keysCnt; i++)
+    values[i] = (RlpItem_t) { 0 };
+  cur[0] = (RlpTrieTask_t) { .ref = { root, RLP_KECCAK256_LEN, true }, .lo = 0, .hi = (uint32_t) keysCnt, .depth = 0 };
+
+  while(curCnt) {
+    // Read-ahead: every node of the level is requested before the first one is decoded
+    for(size_t k = 0; k < curCnt; k++) {
+      RlpTrieTask_t *task = &cur[k];
+      task->loaded = task->ref.isHash && rlp_trie_cache_get(t, task->ref.buff, &nodes[k]);
+      if(task->ref.isHash && !task->loaded)
+        rlp_node_store_prefetch(t->store, task->ref.buff, fromDisk);
+    }
+    for(size_t k = 0; k < curCnt; k++) {
+      if(!cur[k].loaded && (err = rlp_trie_load_uncached(t, &cur[k].ref, &nodes[k])) < 0)
+        return err;
+    }
+    size_t nextCnt = 0;
+    for(size_t k = 0; k < curCnt; k++)
+      rlp_trie_descend(&nodes[k], &cur[k], keys, values, next, &nextCnt, &found);
+    RlpTrieTask_t *tmp = cur;
+    cur = next;
+    next = tmp;
+    curCnt = nextCnt;
+  }
+  return found;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  Iteration                                 */
+/* -------------------------------------------------------------------------- */
+
+// Compares key nibbles [depth, depth + len) of the current path with the start key:
+// -1 if the subtree is entirely below start, 0 if the path is a proper prefix of
+// start, 1 if the subtree is entirely at or above start
+static int rlp_trie_iter_cmp(const RlpTrieIter_t *it, size_t depth, size_t len) {
+  for(size_t i = depth; i < depth + len; i++) {
+    if(i >= it->startLen)
+      return 1;
+    if(it->key[i] != it->start[i])
+      return it->key[i] < it->start[i] ? -1 : 1;
+  }
+  return depth + len >= it->startLen ? 1 : 0;
+}
+
+static inline uint32_t rlp_trie_iter_off(const uint8_t *enc, const RlpItem_t *item) {
+  return (uint32_t) (item->payload - (item->encodedLen - item->payloadLen) - enc);
+}
+
+static inline bool rlp_trie_iter_is_ref(const RlpItem_t *item) {
+  return item->isList ? item->encodedLen < RLP_KECCAK256_LEN : item->payloadLen == RLP_KECCAK256_LEN;
+}
+
+// Decodes the node at enc into a new frame at depth, its path going into it->key
+static int rlp_trie_iter_push(RlpTrieIter_t *it, const uint8_t *enc, size_t len, bool hashed, size_t depth, bool bounded) {
+  if(it->framesCnt == RLP_TRIE_ITER_MAX_DEPTH)
+    return ERR_RLP_EINVAL;
+  if(len > UINT32_MAX)
+    return ERR_RLP_EMSGSIZE;
+  RlpTrieIterFrame_t *f = &it->frames[it->framesCnt];
+  RlpItem_t list, items[17];
+  RlpCursor_t cur;
+  int err = rlp_decode_item(enc, len, &list);
+  if(err < 0)
+    return err;
+  if(list.encodedLen != len)
+    return ERR_RLP_EINVAL;
+  *f = (RlpTrieIterFrame_t) { .enc = enc, .encLen = (uint32_t) len, .depth = (uint8_t) depth, .hashed = hashed, .bounded = bounded };
+  if(!list.isList) {
+    if(list.payloadLen != 0)
+      return ERR_RLP_EINVAL;
+    f->type = RLP_TRIE_EMPTY;
+    it->framesCnt++;
+    return ERR_RLP_OK;
+  }
+
+  size_t n = 0;
+  rlp_cursor_init(&cur, &list);
+  while(n < 17 && (err = rlp_cursor_next(&cur, &items[n])) > 0)
+    n++;
+  if(err < 0)
+    return err;
+  if(n == 17 && cur.pos != cur.end)
+    return ERR_RLP_EINVAL;
+
+  if(n == 17) {
+    f->type = RLP_TRIE_BRANCH;
+    for(int i = 0; i < 16; i++) {
+      if(!items[i].isList && items[i].payloadLen == 0)
+        continue;
+      if(!rlp_trie_iter_is_ref(&items[i]))
+        return ERR_RLP_EINVAL;
+      f->mask |= 1u << i;
+      f->childOff[i] = rlp_trie_iter_off(enc, &items[i]);
+    }
+    if(items[16].isList)
+      return ERR_RLP_EINVAL;
+    if(items[16].payloadLen)
+      f->valueOff = rlp_trie_iter_off(enc, &items[16]);
+    // On the start key's path only children from its next nibble on hold keys >= start
+    f->next = bounded ? it->start[depth] : 0;
+  } else if(n == 2) {
+    uint8_t path[2 * RLP_TRIE_MAX_KEY], pathLen;
+    bool isLeaf;
+    if((err = rlp_trie_decode_path(&items[0], path, &pathLen, &isLeaf)) < 0)
+      return err;
+    if(depth + pathLen > sizeof(it->key))
+      return ERR_RLP_EINVAL;
+    memcpy(it->key + depth, path, pathLen);
+    f->pathLen = pathLen;
+    if(isLeaf) {
+      if(items[1].isList)
+        return ERR_RLP_EINVAL;
+      f->type = RLP_TRIE_LEAF;
+      f->valueOff = rlp_trie_iter_off(enc, &items[1]);
+    } else {
+      if(pathLen == 0 || !rlp_trie_iter_is_ref(&items[1]))
+        return ERR_RLP_EINVAL;
+      f->type = RLP_TRIE_EXTENSION;
+      f->childOff[0] = rlp_trie_iter_off(enc, &items[1]);
+    }
+    if(bounded) {
+      int c = rlp_trie_iter_cmp(it, depth, pathLen);
+      // Leaves emit only at or above start; extensions pass the bound on while on its path
+      f->visited = isLeaf ? c <= 0 : c < 0;
+      f->bounded = c == 0;
+    }
+  } else {
+    return ERR_RLP_EINVAL;
+  }
+  it->framesCnt++;
+  return ERR_RLP_OK;
+}
+
+// Enters the child item at off of frame f
+static int rlp_trie_iter_enter(RlpTrieIter_t *it, const RlpTrieIterFrame_t *f, uint32_t off, size_t depth, bool bounded) {
+  RlpItem_t item, node;
+  int err = rlp_decode_item(f->enc + off, f->encLen - off, &item);
+  if(err < 0)
+    return err;
+  if(item.isList)
+    return rlp_trie_iter_push(it, f->enc + off, item.encodedLen, false, depth, bounded);
+  if((err = rlp_node_store_get(it->store, item.payload, &node)) < 0)
+    return err;
+  return rlp_trie_iter_push(it, node.payload - (node.encodedLen - node.payloadLen), node.encodedLen, true, depth, bounded);
+}
+
+// Lowest child of f at or above from, 16 if none
+static inline uint8_t rlp_trie_iter_child(const RlpTrieIterFrame_t *f, unsigned from) {
+  while(from < 16 && !(f->mask & (1u << from)))
+    from++;
+  return (uint8_t) from;
+}
+
+// Enters child c of branch f, prefetching the sibling visited after its subtree
+static int rlp_trie_iter_enter_child(RlpTrieIter_t *it, RlpTrieIterFrame_t *f, uint8_t c) {
+  uint8_t sibling = rlp_trie_iter_child(f, c + 1);
+  if(sibling < 16) {
+    RlpItem_t item;
+    if(rlp_decode_item(f->enc + f->childOff[sibling], f->encLen - f->childOff[sibling], &item) >= 0 && !item.isList)
+      rlp_node_store_prefetch(it->store, item.payload, it->fromDisk);
+  }
+  bool bounded = f->bounded && c == it->start[f->depth] && f->depth + 1u < it->startLen;
+  f->next = c + 1;
+  it->key[f->depth] = c;
+  return rlp_trie_iter_enter(it, f, f->childOff[c], f->depth + 1, bounded);
+}
+
+// Key is the current path's first keyNibbles nibbles
+static int rlp_trie_iter_emit(const RlpTrieIter_t *it, const RlpTrieIterFrame_t *f, size_t keyNibbles,
+                              uint8_t *key, size_t *keyLen, RlpItem_t *value) {
+  if(keyNibbles & 1)
+    return ERR_RLP_EINVAL;
+  for(size_t i = 0; i < keyNibbles; i += 2)
+    key[i / 2] = (uint8_t) (it->key[i] << 4 | it->key[i + 1]);
+  *keyLen = keyNibbles / 2;
+  int err = rlp_decode_item(f->enc + f->valueOff, f->encLen - f->valueOff, value);
+  return err < 0 ? err : 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                             API Implementation                             */
+/* -------------------------------------------------------------------------- */
+
+int rlp_trie_init(RlpTrie_t *t, RlpNodeStore_t *store, size_t cacheNodes, unsigned flags)
+{
+  if(t == NULL || store == NULL || cacheNodes > (size_t) RLP_TRIE_CACHE_SHARDS * (RLP_TRIE_NIL / 2))
+    return ERR_RLP_EBADARG;
+  memset(t, 0, sizeof(*t));
+  t->store = store;
+  t->flags = flags;
+  size_t cap = (cacheNodes + RLP_TRIE_CACHE_SHARDS - 1) / RLP_TRIE_CACHE_SHARDS;
+  for(int i = 0; i < RLP_TRIE_CACHE_SHARDS; i++) {
+    RlpTrieCacheShard_t *sh = &t->shards[i];
+    pthread_mutex_init(&sh->lock, NULL);
+    sh->head = sh->tail = RLP_TRIE_NIL;
+    if(cap == 0)
+      continue;
+    uint32_t buckets = 1;
+    while(buckets < cap)
+      buckets *= 2;
+    sh->entries = malloc(cap * sizeof(*sh->entries));
+    sh->buckets = malloc(buckets * sizeof(*sh->buckets));
+    if(sh->entries == NULL || sh->buckets == NULL) {
+      rlp_trie_free(t);
+      return ERR_RLP_ENOMEM;
+    }
+    memset(sh->buckets, 0xff, buckets * sizeof(*sh->buckets));
+    sh->bucketsMask = buckets - 1;
+    sh->cap = (uint32_t) cap;
+  }
+  return ERR_RLP_OK;
+}
+
+void rlp_trie_free(RlpTrie_t *t)
+{
+  if(t == NULL || t->store == NULL)
+    return;
+  for(int i = 0; i < RLP_TRIE_CACHE_SHARDS; i++) {
+    pthread_mutex_destroy(&t->shards[i].lock);
+    free(t->shards[i].entries);
+    free(t->shards[i].buckets);
+  }
+  memset(t, 0, sizeof(*t));
+}
+
+int rlp_trie_build(RlpTrie_t *t, const RlpTrieKv_t *kvs, size_t kvsCnt, uint8_t root[RLP_KECCAK256_LEN])
+{
+  if(t == NULL || root == NULL || (kvs == NULL && kvsCnt != 0))
+    return ERR_RLP_EBADARG;
+  for(size_t i = 0; i < kvsCnt; i++) {
+    if(kvs[i].keyLen > RLP_TRIE_MAX_KEY || kvs[i].valueLen == 0 || (kvs[i].key == NULL && kvs[i].keyLen))
+      return ERR_RLP_EBADARG;
+    if(i == 0)
+      continue;
+    size_t n = kvs[i - 1].keyLen < kvs[i].keyLen ? kvs[i - 1].keyLen : kvs[i].keyLen;
+    int cmp = memcmp(kvs[i - 1].key, kvs[i].key, n);
+    if(cmp > 0 || (cmp == 0 && kvs[i - 1].keyLen >= kvs[i].keyLen))
+      return ERR_RLP_EINVAL;
+  }
+
+  RlpTrieBuilder_t b = { .kvs = kvs };
+  RlpTrieBuildRef_t ref;
+  int err;
+  if(kvsCnt == 0) {
+    uint8_t *p = rlp_trie_build_reserve(&b, 1);
+    if(p == NULL)
+      return ERR_RLP_ENOMEM;
+    *p = 0x80;
+    err = rlp_trie_build_finish(&b, 0, &ref, true);
+  } else {
+    err = rlp_trie_build_node(&b, 0, kvsCnt, 0, &ref, true);
+  }
+
+  RlpGatherSeg_t *nodes = NULL;
+  if(err >= 0 && (nodes = malloc(b.endsCnt * sizeof(*nodes))) == NULL)
+    err = ERR_RLP_ENOMEM;
+  if(err >= 0) {
+    for(size_t i = 0, start = 0; i < b.endsCnt; start = b.ends[i++])
+      nodes[i] = (RlpGatherSeg_t) { b.out + start, b.ends[i] - start };
+    err = rlp_node_store_put_batch(t->store, nodes, b.endsCnt, NULL);
+  }
+  if(err >= 0) {
+    memcpy(root, ref.buff, RLP_KECCAK256_LEN);
+    err = ERR_RLP_OK;
+  }
+  free(nodes);
+  free(b.ends);
+  free(b.out);
+  return err;
+}
+
+int rlp_trie_load(RlpTrie_t *t, const RlpTrieRef_t *ref, RlpTrieNode_t *node)
+{
+  if(t == NULL || ref == NULL || ref->len == 0 || node == NULL)
+    return ERR_RLP_EBADARG;
+  if(ref->isHash && rlp_trie_cache_get(t, ref->buff, node))
+    return ERR_RLP_OK;
+  return rlp_trie_load_uncached(t, ref, node);
+}
+
+int rlp_trie_get_batch(RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN],
+                       const RlpGatherSeg_t *keys, size_t keysCnt, RlpItem_t *values)
+{
+  if(t == NULL || root == NULL || keys == NULL || values == NULL || keysCnt > UINT32_MAX)
+    return ERR_RLP_EBADARG;
+  if(keysCnt == 0)
+    return 0;
+  for(size_t i = 0; i < keysCnt; i++) {
+    if(keys[i].len > RLP_TRIE_MAX_KEY)
+      return ERR_RLP_EBADARG;
+    if(i == 0)
+      continue;
+    size_t n = keys[i - 1].len < keys[i].len ? keys[i - 1].len : keys[i].len;
+    int cmp = memcmp(keys[i - 1].buff, keys[i].buff, n);
+    if(cmp > 0 || (cmp == 0 && keys[i - 1].len > keys[i].len))
+      return ERR_RLP_EINVAL;
+  }
+  RlpTrieTask_t *tasks = malloc(2 * keysCnt * sizeof(*tasks));
+  RlpTrieNode_t *nodes = malloc(keysCnt * sizeof(*nodes));
+  int ret = ERR_RLP_ENOMEM;
+  if(tasks && nodes)
+    ret = rlp_trie_lookup(t, root, keys, keysCnt, values, tasks, tasks + keysCnt, nodes);
+  free(nodes);
+  free(tasks);
+  return ret;
+}
+
+int rlp_trie_get(RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN], const void *key, size_t keyLen, RlpItem_t *value)
+{
+  if(t == NULL || root == NULL || (key == NULL && keyLen) || keyLen > RLP_TRIE_MAX_KEY || value == NULL)
+    return ERR_RLP_EBADARG;
+  RlpGatherSeg_t k = { key, keyLen };
+  RlpTrieTask_t cur, next;
+  RlpTrieNode_t node;
+  int ret = rlp_trie_lookup(t, root, &k, 1, value, &cur, &next, &node);
+  return ret < 0 ? ret : ret ? ERR_RLP_OK : ERR_RLP_ENOENT;
+}
+
+int rlp_trie_iter_init(RlpTrieIter_t *it, RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN],
+                       const void *start, size_t startLen)
+{
+  if(it == NULL || t == NULL || root == NULL || (start == NULL && startLen) || startLen > RLP_TRIE_MAX_KEY)
+    return ERR_RLP_EBADARG;
+  it->store = t->store;
+  it->fromDisk = t->flags & RLP_TRIE_READAHEAD;
+  it->framesCnt = 0;
+  it->startLen = (uint8_t) (2 * startLen);
+  for(size_t i = 0; i < it->startLen; i++)
+    it->start[i] = rlp_trie_nibble(start, i);
+
+  RlpItem_t node;
+  int err = rlp_node_store_get(it->store, root, &node);
+  if(err < 0 || (err = rlp_trie_iter_push(it, node.payload - (node.encodedLen - node.payloadLen), node.encodedLen,
+                                          true, 0, it->startLen > 0)) < 0)
+    return err;
+
+  // Seek: follow the start key down as far as the trie has it, leaving its path as the proof
+  while(it->framesCnt) {
+    RlpTrieIterFrame_t *f = &it->frames[it->framesCnt - 1];
+    if(f->type == RLP_TRIE_BRANCH) {
+      if(!f->bounded)
+        break;
+      uint8_t c = it->start[f->depth];
+      if(!(f->mask & (1u << c)))
+        break;
+      err = rlp_trie_iter_enter_child(it, f, c);
+    } else if(f->type == RLP_TRIE_EXTENSION) {
+      // Also through an extension ending exactly at the start key: the branch below holds its value
+      size_t end = f->depth + f->pathLen;
+      if(f->visited || end > it->startLen || memcmp(it->key + f->depth, it->start + f->depth, f->pathLen) != 0)
+        break;
+      f->visited = true;
+      err = rlp_trie_iter_enter(it, f, f->childOff[0], end, f->bounded);
+    } else {
+      break;
+    }
+    if(err < 0)
+      return err;
+  }
+  return ERR_RLP_OK;
+}
+
+int rlp_trie_iter_next(RlpTrieIter_t *it, uint8_t key[RLP_TRIE_MAX_KEY], size_t *keyLen, RlpItem_t *value)
+{
+  if(it == NULL || key == NULL || keyLen == NULL || value == NULL)
+    return ERR_RLP_EBADARG;
+  int err;
+  while(it->framesCnt) {
+    RlpTrieIterFrame_t *f = &it->frames[it->framesCnt - 1];
+    switch(f->type) {
+      case RLP_TRIE_LEAF:
+        if(!f->visited) {
+          f->visited = true;
+          return rlp_trie_iter_emit(it, f, f->depth + f->pathLen, key, keyLen, value);
+        }
+        break;
+      case RLP_TRIE_EXTENSION:
+        if(!f->visited) {
+          f->visited = true;
+          if((err = rlp_trie_iter_enter(it, f, f->childOff[0], f->depth + f->pathLen, f->bounded)) < 0)
+            return err;
+          continue;
+        }
+        break;
+      case RLP_TRIE_BRANCH: {
+        // A branch value's key is a prefix of every key below it, so it comes first
+        if(!f->visited) {
+          f->visited = true;
+          if(f->valueOff && !f->bounded)
+            return rlp_trie_iter_emit(it, f, f->depth, key, keyLen, value);
+        }
+        uint8_t c = rlp_trie_iter_child(f, f->next);
+        if(c < 16) {
+          if((err = rlp_trie_iter_enter_child(it, f, c)) < 0)
+            return err;
+          continue;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    it->framesCnt--;
+  }
+  return 0;
+}
+
+int rlp_trie_iter_proof(const RlpTrieIter_t *it, RlpGatherSeg_t *nodes, size_t nodesCap)
+{
+  if(it == NULL || (nodes == NULL && nodesCap))
+    return ERR_RLP_EBADARG;
+  size_t n = 0;
+  for(size_t i = 0; i < it->framesCnt; i++) {
+    if(!it->frames[i].hashed)
+      continue;
+    if(n == nodesCap)
+      return ERR_RLP_ENOMEM;
+    nodes[n++] = (RlpGatherSeg_t) { it->frames[i].enc, it->frames[i].encLen };
+  }
+  return (int) n;
+}
@@ -0,0 +1,184 @@
+/**
+ * RLP Serializer - Disk Backed Trie
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Merkle Patricia trie whose nodes live as RLP in the node store. Decoded nodes are
+ * kept in a sharded LRU cache, and lookups walk the trie one level at a time for a
+ * whole batch of keys, prefetching every child of the next level before decoding it.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __RLP_TRIE_H_
+#define __RLP_TRIE_H_
+
+#include "rlp_nodestore.h"
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RLP_TRIE_READAHEAD    0x1   // state larger than RAM: ask the kernel to read child nodes ahead
+#define RLP_TRIE_MAX_KEY      32    // key bytes, 64 nibbles
+#define RLP_TRIE_CACHE_SHARDS 16
+
+typedef enum {
+  RLP_TRIE_EMPTY,
+  RLP_TRIE_LEAF,
+  RLP_TRIE_EXTENSION,
+  RLP_TRIE_BRANCH,
+} RlpTrieNodeType_t;
+
+// Reference to a child: the Keccak-256 of its encoding, or the encoding itself when
+// shorter than 32 bytes. len is 0 for no child.
+typedef struct rlpTrieRef {
+  const uint8_t  *buff;
+  uint8_t        len;
+  bool           isHash;
+} RlpTrieRef_t;
+
+// Decoded node. Pointers reference the node store's mapping and stay valid while it is open.
+typedef struct rlpTrieNode {
+  RlpTrieNodeType_t  type;
+  uint8_t            pathLen;                   // leaf and extension path, in nibbles
+  uint8_t            path[2 * RLP_TRIE_MAX_KEY]; // one nibble per byte
+  RlpTrieRef_t       children[16];              // extension: children[0]
+  RlpItem_t          value;                     // leaf or branch value; payload NULL if none
+} RlpTrieNode_t;
+
+typedef struct rlpTrieCacheEntry {
+  uint8_t        key[RLP_KECCAK256_LEN];
+  uint32_t       hnext;       // bucket chain
+  uint32_t       prev;        // LRU order, most recent at head
+  uint32_t       next;
+  RlpTrieNode_t  node;
+} RlpTrieCacheEntry_t;
+
+typedef struct rlpTrieCacheShard {
+  pthread_mutex_t      lock;
+  RlpTrieCacheEntry_t  *entries;
+  uint32_t             *buckets;
+  uint32_t             bucketsMask;
+  uint32_t             cap;
+  uint32_t             cnt;
+  uint32_t             head;
+  uint32_t             tail;
+} RlpTrieCacheShard_t;
+
+// Thread safe for lookups; builds need an exclusive node store
+typedef struct rlpTrie {
+  RlpNodeStore_t       *store;
+  unsigned             flags;
+  RlpTrieCacheShard_t  shards[RLP_TRIE_CACHE_SHARDS];
+} RlpTrie_t;
+
+typedef struct rlpTrieKv {
+  const void   *key;
+  size_t       keyLen;      // up to RLP_TRIE_MAX_KEY
+  const void   *value;
+  size_t       valueLen;    // not 0, an empty value means the key is absent
+} RlpTrieKv_t;
+
+// cacheNodes decoded nodes are cached over all shards; 0 disables the cache
+// Returns 0 on success, or a negative error value
+int rlp_trie_init(RlpTrie_t *t, RlpNodeStore_t *store, size_t cacheNodes, unsigned flags);
+
+void rlp_trie_free(RlpTrie_t *t);
+
+// Builds the trie of kvs, sorted by key with no duplicates, and stores every node in one commit
+// Returns 0 on success, or a negative error value
+int rlp_trie_build(RlpTrie_t *t, const RlpTrieKv_t *kvs, size_t kvsCnt, uint8_t root[RLP_KECCAK256_LEN]);
+
+// Decodes one encoded node
+// Returns 0 on success, or a negative error value
+int rlp_trie_decode_node(const void *encoded, size_t len, RlpTrieNode_t *node);
+
+// Loads and decodes the node behind ref, through the cache for hashed nodes
+// Returns 0 on success, ERR_RLP_ENOENT if the node is not stored, or a negative error value
+int rlp_trie_load(RlpTrie_t *t, const RlpTrieRef_t *ref, RlpTrieNode_t *node);
+
+// Looks up every key of keys, sorted ascending; nodes on shared prefixes are visited once.
+// values[i].payload is the value, or NULL if the key is absent.
+// Returns the number of keys found, or a negative error value
+int rlp_trie_get_batch(RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN],
+                       const RlpGatherSeg_t *keys, size_t keysCnt, RlpItem_t *values);
+
+// Returns 0 on success, ERR_RLP_ENOENT if key is absent, or a negative error value
+int rlp_trie_get(RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN], const void *key, size_t keyLen, RlpItem_t *value);
+
+// Ordered iteration
+
+// Longest root to leaf path: one frame per nibble, plus the root and a leaf
+#define RLP_TRIE_ITER_MAX_DEPTH (2 * RLP_TRIE_MAX_KEY + 2)
+
+// A node on the iterator's path in compact form: offsets of its items into its
+// encoding instead of a full RlpTrieNode_t, decoded once when the node is entered
+typedef struct rlpTrieIterFrame {
+  const uint8_t      *enc;            // the node's encoding, in the store or in its parent
+  uint32_t           encLen;
+  uint32_t           childOff[16];    // branch: child items; extension: childOff[0]
+  uint32_t           valueOff;        // value item, 0 if none
+  uint16_t           mask;            // branch children present
+  uint8_t            type;            // RlpTrieNodeType_t
+  uint8_t            depth;           // key nibbles above the node
+  uint8_t            pathLen;         // leaf and extension path, stored in the iterator's key
+  uint8_t            next;            // branch: next child to visit, 16 when done
+  bool               hashed;          // stored under its hash, so part of proofs
+  bool               bounded;         // may still hold keys below the start key
+  bool               visited;
+} RlpTrieIterFrame_t;
+
+typedef struct rlpTrieIter {
+  RlpNodeStore_t      *store;
+  bool                fromDisk;       // RLP_TRIE_READAHEAD
+  uint8_t             start[2 * RLP_TRIE_MAX_KEY];  // nibbles
+  uint8_t             startLen;
+  uint8_t             key[2 * RLP_TRIE_MAX_KEY];    // nibbles of the current path
+  size_t              framesCnt;
+  RlpTrieIterFrame_t  frames[RLP_TRIE_ITER_MAX_DEPTH];
+} RlpTrieIter_t;
+
+// Positions it at the first key >= start of the trie under root. Nodes come straight
+// from the store, the decoded node cache is not used. t's flags apply.
+// Returns 0 on success, or a negative error value
+int rlp_trie_iter_init(RlpTrieIter_t *it, RlpTrie_t *t, const uint8_t root[RLP_KECCAK256_LEN],
+                       const void *start, size_t startLen);
+
+// Streams leaves in key order; value is a view into the store
+// Returns 1 for a leaf, 0 past the last one, or a negative error value
+int rlp_trie_iter_next(RlpTrieIter_t *it, uint8_t key[RLP_TRIE_MAX_KEY], size_t *keyLen, RlpItem_t *value);
+
+// Encodings of the stored nodes on the iterator's current path, root first. Right after
+// init this proves the start key (or its absence); after the last rlp_trie_iter_next()
+// it proves the last key returned. Both together are the boundary proof of a range.
+// Returns the number of nodes, or a negative error value
+int rlp_trie_iter_proof(const RlpTrieIter_t *it, RlpGatherSeg_t *nodes, size_t nodesCap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * RLP Serializer - io_uring Sink Benchmark
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Writes the same stream of transaction sized records to a file through stdio
+ * fwrite(), the blocking write(2) sink and the io_uring sink, buffered and O_DIRECT,
+ * and reports MB/s for each. Every run ends when the file is closed.
+ * Build: cc -O2 rlp_uring_bench.c rlp_sink_uring.c rlp_sink.c rlp_arena.c rlp_serializer.c
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_sink_uring.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_RECORDS     262144
+#define BENCH_WINDOW      (1 << 20)
+#define BENCH_BUFS        8
+
+// Legacy transaction shape: nonce, gas price, gas, to, value, data, v, r, s
+typedef struct {
+  RlpElement_t  fields[9];
+  size_t        payloadLen;
+} BenchTx_t;
+
+static uint64_t rngState = 0x9e3779b97f4a7c15ull;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static uint8_t benchBytes[4096];
+
+static void bench_tx(BenchTx_t *tx, uint64_t *ints) {
+  for(size_t i = 0; i < 4; i++)
+    ints[i] = rng() >> (rng() % 48);
+  size_t dataLen = rng() % 4 == 0 ? 0 : 36 + rng() % 600;
+  const uint8_t *b = benchBytes + rng() % (sizeof(benchBytes) - 1024);
+  tx->fields[0] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = &ints[0] };
+  tx->fields[1] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = &ints[1] };
+  tx->fields[2] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = &ints[2] };
+  tx->fields[3] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 20, .buff = b };
+  tx->fields[4] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = &ints[3] };
+  tx->fields[5] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = dataLen, .buff = b + 20 };
+  tx->fields[6] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 1, .buff = b + 700 };
+  tx->fields[7] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = b + 701 };
+  tx->fields[8] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = b + 733 };
+  tx->payloadLen = 0;
+  for(size_t f = 0; f < 9; f++)
+    tx->payloadLen += rlp_element_encoded_len(&tx->fields[f]);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+// Encodes every record into a small buffer and hands it to stdio
+static int bench_fwrite(const char *path, const BenchTx_t *txs) {
+  FILE *f = fopen(path, "wb");
+  if(f == NULL)
+    return -1;
+  setvbuf(f, NULL, _IOFBF, BENCH_WINDOW);
+  uint8_t rec[2048];
+  for(size_t i = 0; i < BENCH_RECORDS; i++) {
+    const RlpElement_t *ptrs[9];
+    for(size_t k = 0; k < 9; k++)
+      ptrs[k] = &txs[i].fields[k];
+    int len = rlp_encode_list(rec, sizeof(rec), ptrs, 9);
+    if(len < 0 || fwrite(rec, 1, (size_t) len, f) != (size_t) len) {
+      fclose(f);
+      return -1;
+    }
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+// Encodes straight into the sink window
+static int bench_sink(RlpSink_t *sink, const BenchTx_t *txs) {
+  for(size_t i = 0; i < BENCH_RECORDS; i++) {
+    if(rlp_sink_encode_header(sink, txs[i].payloadLen, true) < 0)
+      return -1;
+    for(size_t k = 0; k < 9; k++)
+      if(rlp_sink_encode_element(sink, &txs[i].fields[k]) < 0)
+        return -1;
+  }
+  return rlp_sink_close(sink) < 0 ? -1 : 0;
+}
+
+static int bench_write(const char *path, const BenchTx_t *txs) {
+  static uint8_t buff[BENCH_WINDOW];
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    return -1;
+  RlpFdSink_t s;
+  rlp_fd_sink_init(&s, fd, buff, sizeof(buff));
+  int err = bench_sink(&s.sink, txs);
+  return close(fd) < 0 ? -1 : err;
+}
+
+static int bench_uring(const char *path, const BenchTx_t *txs, unsigned flags) {
+  RlpUringSink_t s;
+  if(rlp_uring_sink_open(&s, path, BENCH_WINDOW, BENCH_BUFS, flags) < 0)
+    return 1;   // unavailable here, skipped
+  return bench_sink(&s.sink, txs);
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "rlp_uring_bench.out";
+  int rounds = argc > 2 ? atoi(argv[2]) : 5;
+  if(rounds <= 0) {
+    fprintf(stderr, "usage: %s [file] [rounds]\n", argv[0]);
+    return 1;
+  }
+
+  for(size_t i = 0; i < sizeof(benchBytes); i++)
+    benchBytes[i] = (uint8_t) rng();
+  BenchTx_t *txs = malloc(BENCH_RECORDS * sizeof(*txs));
+  uint64_t *ints = malloc(BENCH_RECORDS * 4 * sizeof(*ints));
+  if(!txs || !ints)
+    return 1;
+  size_t total = 0;
+  for(size_t i = 0; i < BENCH_RECORDS; i++) {
+    bench_tx(&txs[i], &ints[4 * i]);
+    total += rlp_header_len(txs[i].payloadLen) + txs[i].payloadLen;
+  }
+
+  static const char *names[] = { "fwrite", "write sink", "uring sink", "uring sink O_DIRECT" };
+  double ns[4] = { 0 };
+  bool skipped[4] = { false };
+  for(int r = 0; r < rounds; r++) {
+    for(int m = 0; m < 4; m++) {
+      if(skipped[m])
+        continue;
+      double t0 = now_ns();
+      int ret = m == 0 ? bench_fwrite(path, txs) : m == 1 ? bench_write(path, txs)
+              : bench_uring(path, txs, m == 3 ? RLP_URING_DIRECT : 0);
+      ns[m] += now_ns() - t0;
+      struct stat st;
+      if(ret == 0 && (stat(path, &st) < 0 || (size_t) st.st_size != total))
+        ret = -1;
+      if(ret < 0) {
+        fprintf(stderr, "%s failed\n", names[m]);
+        return 1;
+      }
+      skipped[m] = ret > 0;
+    }
+  }
+  unlink(path);
+
+  double mb = (double) rounds * total / 1e6;
+  printf("%d rounds, %zu records, %zu B per round\n", rounds, (size_t) BENCH_RECORDS, total);
+  for(int m = 0; m < 4; m++) {
+    if(skipped[m])
+      printf("%-20s unavailable\n", names[m]);
+    else
+      printf("%-20s %.0f MB/s\n", names[m], mb / (ns[m] / 1e9));
+  }
+  free(ints);
+  free(txs);
+  return 0;
+}
@@ -0,0 +1,259 @@
+/**
+ * RLP Serializer - Workload
+ * https://github.com/afkamalipour/simple-rlp
+ *
+ * Mainnet-like encode/decode mix used as the PGO training run and as the benchmark
+ * that compares plain and profile-optimized builds. Transactions and logs are
+ * generated from a fixed seed so every run exercises the same branch mix.
+ */
+
+/**
+ * MIT License
+ *
+ * Copyright (c) 2020 Aurash Kamalipour <afkamalipour@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rlp_serializer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* -------------------------------------------------------------------------- */
+/*                                  Workload                                  */
+/* -------------------------------------------------------------------------- */
+
+#define WORKLOAD_TXS          4096
+#define WORKLOAD_TX_FIELDS    11    // EIP-1559 fields minus the access list
+#define WORKLOAD_LOGS         4096
+#define WORKLOAD_LOG_TOPICS   4
+#define WORKLOAD_MAX_DATA     (48 * 1024)
+
+typedef struct {
+  RlpElement_t  fields[WORKLOAD_TX_FIELDS];
+  const RlpElement_t *ptrs[WORKLOAD_TX_FIELDS];
+  uint8_t       ints[7][8];     // chainId, nonce, tip, feeCap, gas, value, yParity
+  uint8_t       to[20];
+  uint8_t       r[32];
+  uint8_t       s[32];
+} WorkloadTx_t;
+
+typedef struct {
+  RlpElement_t  fields[2 + WORKLOAD_LOG_TOPICS];
+  const RlpElement_t *ptrs[2 + WORKLOAD_LOG_TOPICS];
+  size_t        fieldsCnt;
+  uint8_t       address[20];
+  uint8_t       topics[WORKLOAD_LOG_TOPICS][32];
+} WorkloadLog_t;
+
+static uint64_t rngState;
+
+static uint64_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return rngState;
+}
+
+static void put_be64(uint8_t out[8], uint64_t v) {
+  for(int i = 7; i >= 0; i--, v >>= 8)
+    out[i] = (uint8_t) v;
+}
+
+static void fill(uint8_t *out, size_t len) {
+  for(size_t i = 0; i < len; i++)
+    out[i] = (uint8_t) rng();
+}
+
+// Calldata sizes roughly as seen on mainnet: plain transfers, token calls, swaps, deployments
+static size_t workload_data_len(void) {
+  uint64_t p = rng() % 100;
+  if(p < 35)
+    return 0;
+  if(p < 65)
+    return 68;
+  if(p < 95)
+    return 100 + rng() % 900;
+  return 1024 + rng() % (WORKLOAD_MAX_DATA - 1024);
+}
+
+static void workload_tx_init(WorkloadTx_t *tx, uint8_t *data, size_t dataLen) {
+  uint64_t ints[7] = {
+    1,
+    rng() % 4 ? rng() % 1000 : rng() % 10000000,
+    rng() % 3000000000ull,
+    1000000000ull + rng() % 200000000000ull,
+    rng() % 2 ? 21000 : 21000 + rng() % 3000000,
+    rng() % 2 ? 0 : rng() % 10000000000000000000ull,
+    rng() % 2,
+  };
+  for(int i = 0; i < 7; i++)
+    put_be64(tx->ints[i], ints[i]);
+  fill(tx->to, sizeof(tx->to));
+  fill(tx->r, sizeof(tx->r));
+  fill(tx->s, sizeof(tx->s));
+  // About 1 in 256 signature values has a leading zero byte
+  tx->r[0] = rng() % 256 ? tx->r[0] | 1 : 0;
+  fill(data, dataLen);
+
+  RlpElement_t *f = tx->fields;
+  for(int i = 0; i < 5; i++)
+    f[i] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = tx->ints[i] };
+  // Contract creations have an empty recipient
+  f[5] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = rng() % 50 ? 20 : 0, .buff = tx->to };
+  f[6] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = tx->ints[5] };
+  f[7] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = dataLen, .buff = data };
+  f[8] = (RlpElement_t) { .type = RLP_TYPE_INT64, .len = 8, .buff = tx->ints[6] };
+  f[9] = (RlpElement_t) { .type = RLP_TYPE_INT256, .len = 32, .buff = tx->r };
+  f[10] = (RlpElement_t) { .type = RLP_TYPE_INT256, .len = 32, .buff = tx->s };
+  for(int i = 0; i < WORKLOAD_TX_FIELDS; i++)
+    tx->ptrs[i] = &f[i];
+}
+
+static void workload_log_init(WorkloadLog_t *log, uint8_t *data, size_t dataLen) {
+  size_t topicsCnt = 1 + rng() % WORKLOAD_LOG_TOPICS;
+  fill(log->address, sizeof(log->address));
+  fill(data, dataLen);
+  log->fields[0] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 20, .buff = log->address };
+  for(size_t i = 0; i < topicsCnt; i++) {
+    fill(log->topics[i], 32);
+    log->fields[1 + i] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = 32, .buff = log->topics[i] };
+  }
+  log->fields[1 + topicsCnt] = (RlpElement_t) { .type = RLP_TYPE_BYTE_ARRAY, .len = dataLen, .buff = data };
+  log->fieldsCnt = 2 + topicsCnt;
+  for(size_t i = 0; i < log->fieldsCnt; i++)
+    log->ptrs[i] = &log->fields[i];
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Runs                                    */
+/* -------------------------------------------------------------------------- */
+
+static double now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Walks every field of every encoded item, decoding the integers
+static int workload_decode(const uint8_t *buff, const size_t *offs, size_t cnt, uint64_t *sum) {
+  for(size_t i = 0; i < cnt; i++) {
+    RlpItem_t list, field;
+    RlpCursor_t cur;
+    int err = rlp_decode_item(buff + offs[i], offs[i + 1] - offs[i], &list);
+    if(err < 0 || (err = rlp_cursor_init(&cur, &list)) < 0)
+      return err;
+    while((err = rlp_cursor_next(&cur, &field)) > 0) {
+      uint64_t v;
+      if(field.payloadLen <= 8 && rlp_decode_uint64(&field, &v) == ERR_RLP_OK)
+        *sum += v;
+      else
+        *sum += field.payloadLen;
+    }
+    if(err < 0)
+      return err;
+  }
+  return ERR_RLP_OK;
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 100;
+  rngState = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x9e3779b97f4a7c15ull;
+  if(rounds <= 0 || rngState == 0) {
+    fprintf(stderr, "usage: %s [rounds] [seed]\n", argv[0]);
+    return 1;
+  }
+
+  WorkloadTx_t *txs = malloc(WORKLOAD_TXS * sizeof(*txs));
+  WorkloadLog_t *logs = malloc(WORKLOAD_LOGS * sizeof(*logs));
+  size_t dataCap = WORKLOAD_TXS * 2048 + WORKLOAD_LOGS * 256;
+  uint8_t *data = malloc(dataCap);
+  if(!txs || !logs || !data)
+    return 1;
+  size_t dataLen = 0;
+  for(size_t i = 0; i < WORKLOAD_TXS; i++) {
+    size_t len = workload_data_len();
+    if(dataLen + len > dataCap - WORKLOAD_LOGS * 256)
+      len = 68;
+    workload_tx_init(&txs[i], data + dataLen, len);
+    dataLen += len;
+  }
+  for(size_t i = 0; i < WORKLOAD_LOGS; i++) {
+    size_t len = 32 * (rng() % 8);
+    workload_log_init(&logs[i], data + dataLen, len);
+    dataLen += len;
+  }
+
+  size_t outCap = dataLen + (WORKLOAD_TXS + WORKLOAD_LOGS) * 512;
+  uint8_t *out = malloc(outCap);
+  size_t *offs = malloc((WORKLOAD_TXS + WORKLOAD_LOGS + 1) * sizeof(*offs));
+  if(!out || !offs)
+    return 1;
+
+  double encNs = 0, decNs = 0;
+  uint64_t sum = 0;
+  size_t outLen = 0;
+  for(int r = 0; r < rounds; r++) {
+    double t0 = now_ns();
+    size_t cnt = 0;
+    outLen = 0;
+    offs[0] = 0;
+    for(size_t i = 0; i < WORKLOAD_TXS; i++) {
+      int len = rlp_encode_list(out + outLen, outCap - outLen, txs[i].ptrs, WORKLOAD_TX_FIELDS);
+      if(len < 0) {
+        fprintf(stderr, "tx %zu: encode error %d\n", i, len);
+        return 1;
+      }
+      outLen += len;
+      offs[++cnt] = outLen;
+    }
+    for(size_t i = 0; i < WORKLOAD_LOGS; i++) {
+      int len = rlp_encode_list(out + outLen, outCap - outLen, logs[i].ptrs, logs[i].fieldsCnt);
+      if(len < 0) {
+        fprintf(stderr, "log %zu: encode error %d\n", i, len);
+        return 1;
+      }
+      outLen += len;
+      offs[++cnt] = outLen;
+    }
+    double t1 = now_ns();
+    int err = workload_decode(out, offs, cnt, &sum);
+    if(err < 0) {
+      fprintf(stderr, "decode error %d\n", err);
+      return 1;
+    }
+    encNs += t1 - t0;
+    decNs += now_ns() - t1;
+  }
+
+  double items = (double) rounds * (WORKLOAD_TXS + WORKLOAD_LOGS);
+  printf("%d rounds, %zu B per round\n", rounds, outLen);
+  printf("encode: %.1f ns/item\n", encNs / items);
+  printf("decode: %.1f ns/item\n", decNs / items);
+  printf("checksum: %llx\n", (unsigned long long) sum);
+
+  free(offs);
+  free(out);
+  free(data);
+  free(logs);
+  free(txs);
+  return 0;
+}